@@ -10,7 +10,16 @@
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/i2c.h"
+#include "lib/aquisicao.h"
+#include "lib/benchmark.h"
+#include "lib/config_flash.h"
+#include "lib/formatacao.h"
+#include "lib/gravador.h"
 #include "lib/leds.h"
+#include "lib/log_binario.h"
+#include "lib/mpu6050.h"
+#include "lib/prealocado.h"
+#include "lib/recuperacao.h"
 #include "lib/ssd1306.h"
 
 #include "ff.h"
@@ -31,18 +40,98 @@ volatile bool capturando_dados = false;
 volatile bool precisa_atualizar_display = true;
 volatile bool SW_button_pressed = false;
 volatile bool button_A_pressed = false;
+volatile bool button_B_pressed = false;
 
-static FIL g_log_file;
+static FIL g_espectro_file; // <sessão>_fft.csv, só com ESPECTRO_PONTOS > 0
+static FIL g_eventos_file;  // <sessão>_eventos.csv, só na captura por evento
+// As linhas de cada arquivo são montadas em blocos alinhados a setores (lib/gravador.c)
+static gravador_t g_grav_log, g_grav_espectro, g_grav_eventos;
 static volatile bool g_log_ativo = false;
-static volatile bool g_dados_prontos_para_gravar = false;
 
-// Estrutura para armazenar a média final que será gravada no arquivo
-static int16_t g_dados_medios[7]; // ax, ay, az, gx, gy, gz, temp
+// Registros gravados por volta do loop principal antes de dar vez ao display e ao terminal
+#define REGISTROS_POR_LOTE 32
+
+// Os blocos cheios vão para o cartão assim que o loop passa por eles; f_sync (FAT e
+// diretório) e o trecho que não completou um bloco, conforme a política de durabilidade:
+// GRAV_SYNC_REGISTROS a cada SYNC_LIMITE registros, GRAV_SYNC_TEMPO a cada SYNC_LIMITE ms,
+// GRAV_SYNC_BYTES a cada SYNC_LIMITE KiB, GRAV_SYNC_MANUAL só no botão B, no comando 'f'
+// e ao parar. Tudo o que foi gravado depois do último f_sync se perde num corte de energia.
+#ifndef SYNC_POLITICA
+#define SYNC_POLITICA GRAV_SYNC_TEMPO
+#endif
+#ifndef SYNC_LIMITE
+#define SYNC_LIMITE 1000
+#endif
+static const grav_politica_t g_politica_sync = {SYNC_POLITICA, SYNC_LIMITE};
+static uint32_t g_ultimo_sync_ms;
+static uint32_t g_registros_sem_sync; // Registros gravados depois do último f_sync
+static uint32_t g_maior_escrita_us; // Maior tempo de uma volta de gravação de blocos
+
+// Pré-alocação do arquivo principal: PREALOCAR_MB > 0 reserva, ao iniciar o log, essa
+// quantidade de MiB contíguos com f_expand e os blocos vão direto para os setores da
+// reserva (lib/prealocado.h). FAT e diretório só são tocados no f_sync da política
+// acima (checkpoint) e ao parar, quando o que sobrou da reserva é liberado. Como
+// f_expand exige um arquivo vazio, as partes são sempre arquivos novos (abaixo). Com a
+// reserva quase cheia a sessão continua na parte seguinte.
+#ifndef PREALOCAR_MB
+#define PREALOCAR_MB 0
+#endif
+static uint32_t g_folga_reserva; // Bytes que ainda podem chegar depois que a troca de parte é decidida
+
+// Sessões e rotação. Cada início de log é uma sessão nova, com um número (um a mais
+// que o da última linha do catálogo) e um nome-base: a data e a hora do RTC, se ele
+// foi acertado (setrtc), ou s<número>. O arquivo principal é gravado em partes,
+// <base>_NN.csv (ou .bin), e a parte seguinte começa quando a atual passa de ROTACAO_MB
+// MiB ou de ROTACAO_MIN minutos (0 desliga o critério) ou quando a reserva pré-alocada
+// acaba. Cada parte começa com o próprio cabeçalho. A parte seguinte é criada (e
+// reservada) antes da hora, numa volta do loop em que a fila já foi esvaziada, e a
+// troca só fecha uma e começa a outra. Os arquivos de espectro e de eventos são um por
+// sessão. O catálogo (CATALOGO) ganha uma linha por parte fechada.
+#ifndef ROTACAO_MB
+#define ROTACAO_MB 0
+#endif
+#ifndef ROTACAO_MIN
+#define ROTACAO_MIN 0
+#endif
+#define ROTACAO (ROTACAO_MB || ROTACAO_MIN || PREALOCAR_MB)
+#define CATALOGO "sessoes.csv"
+
+// Lista de recuperação: as partes e os arquivos de espectro e de eventos abertos
+// agora, com a reserva de cada parte. Regravada quando uma parte abre ou fecha e
+// apagada quando o log para; se ela existir na montagem, a placa desligou no meio de
+// uma sessão e esses arquivos passam por lib/recuperacao.c. Uma parte sai da lista
+// depois do último f_sync e antes do corte que devolve a reserva.
+#define PARTES_ABERTAS "abertas.txt"
 
-// Estrutura do nosso temporizador
-static repeating_timer_t g_repeating_timer;
-
-static char filename[20] = "adc_data15.csv";
+typedef struct
+{
+    FIL arquivo;
+    prealocado_t prealocado; // Só com PREALOCAR_MB
+    grav_destino_t destino;
+    char nome[32];
+    char inicio[20];           // Data e hora do RTC quando a parte começou, "-" sem RTC
+    uint32_t numero;
+    uint32_t inicio_ms;
+    uint32_t registros_inicio; // g_registros_gravados quando a parte começou
+    bool aberta;
+} parte_log_t;
+
+static parte_log_t g_partes[2];
+static parte_log_t *g_parte = &g_partes[0];   // Recebendo os registros
+static parte_log_t *g_proxima = &g_partes[1]; // Criada antes da hora para a próxima troca
+static bool g_proxima_falhou;                 // Não tenta de novo a cada volta do loop
+static uint32_t g_sessao;
+static char g_base_sessao[20];
+static char g_linha_catalogo[96];
+static bool g_catalogo_pendente;
+static FIL g_catalogo_file;
+static bool g_companheiros_abertos; // Espectro e eventos, na lista de recuperação
+
+// Contadores do gravador na sessão corrente; os da aquisição ficam em aquisicao.c
+static uint32_t g_registros_gravados;
+static uint32_t g_falhas_gravacao;    // Linhas, blocos ou f_sync com erro
+static uint32_t g_saltos_sequencia;   // Registros que faltaram entre dois gravados
+static uint32_t g_sequencia_esperada;
 
 void entrar_em_erro_fatal()
 {
@@ -169,6 +258,8 @@ static void run_format()
     if (FR_OK != fr)
         printf("f_mkfs error: %s (%d)\n", FRESULT_str(fr), fr);
 }
+static void recuperar_partes();
+
 static void run_mount()
 {
     const char *arg1 = strtok(NULL, " ");
@@ -194,6 +285,8 @@ static void run_mount()
     pSD->mounted = true;
     cartao_montado = true;
     printf("Processo de montagem do SD ( %s ) concluído\n", pSD->pcName);
+    if (!g_log_ativo)
+        recuperar_partes();
 }
 static void run_unmount()
 {
@@ -334,123 +427,1192 @@ static void run_cat()
     precisa_atualizar_display = true; // Restaura a interface ao final
 }
 
-// MPU6050 I2C address
+// Barramento dos MPU6050 (endereços e pino INT na tabela de sensores, em hw_config.c)
 #define I2C_PORT i2c0 // i2c0 pinos 0 e 1, i2c1 pinos 2 e 3
 #define I2C_SDA 0     // 0 ou 2
 #define I2C_SCL 1     // 1 ou 3
-// Oi, eu sou o display
+// Oi, eu sou o display. Sensores no i2c1 dividem estes pinos com ele.
 #define I2C_PORT_DISP i2c1
 #define I2C_SDA_DISP 14
 #define I2C_SCL_DISP 15
 #define endereco 0x3C
 
-static int addr = 0x68;
+// Taxa de amostragem do MPU6050. Cada linha do log é a média de um segundo de amostras.
+#ifndef TAXA_AMOSTRAGEM_HZ
+#define TAXA_AMOSTRAGEM_HZ 100
+#endif
 
-static void mpu6050_reset()
+// Configuração comum a todos os sensores da tabela: amostrados juntos, precisam do
+// mesmo ODR. ODR = 1 kHz / (1 + SMPLRT_DIV), com a banda do DLPF abaixo de metade do ODR.
+static void configurar_sensor(mpu6050_t *mpu)
 {
-    // Two byte reset. First byte register, second byte data
-    // There are a load more options to set up the device in different ways that could be added here
-    uint8_t buf[] = {0x6B, 0x80};
-    i2c_write_blocking(I2C_PORT, addr, buf, 2, false);
-    sleep_ms(100); // Allow device to reset and stabilize
+    mpu->smplrt_div = 1000 / TAXA_AMOSTRAGEM_HZ - 1;
+    mpu->dlpf = TAXA_AMOSTRAGEM_HZ >= 400   ? MPU6050_DLPF_184HZ
+                : TAXA_AMOSTRAGEM_HZ >= 200 ? MPU6050_DLPF_94HZ
+                                            : MPU6050_DLPF_44HZ;
+    mpu->accel_fs = MPU6050_ACCEL_2G;
+    mpu->gyro_fs = MPU6050_GYRO_250DPS;
+}
 
-    // Clear sleep mode (0x6B register, 0x00 value)
-    buf[1] = 0x00; // Clear sleep mode by writing 0x00 to the 0x6B register
-    i2c_write_blocking(I2C_PORT, addr, buf, 2, false);
-    sleep_ms(10); // Allow stabilization after waking up
+// Sensores que responderam no boot, na ordem da tabela. A posição é o ID gravado em
+// cada linha do log; o primeiro dá o ODR e as escalas dos metadados.
+static const mpu6050_t *g_sensores[AQ_MAX_SENSORES];
+static imu_t g_imus[AQ_MAX_SENSORES]; // Os mesmos sensores pela interface genérica (reset e leitura direta)
+static uint8_t g_num_sensores;
+static const mpu6050_t *g_mpu;
+
+// Algum sensor está no barramento do display: durante o log o quadro do display
+// disputaria o i2c1 com o DMA da aquisição, então a tela fica parada até o fim
+static bool g_display_compartilhado = false;
+
+// Acima de ~200 Hz uma leitura por tick ocupa o barramento e a CPU demais:
+// a FIFO do sensor passa a guardar as amostras e é esvaziada em rajadas.
+// Com o pino INT ligado, -DMODO_AQUISICAO=AQ_MODO_DRDY amostra no clock do próprio sensor.
+#ifndef MODO_AQUISICAO
+#define MODO_AQUISICAO (TAXA_AMOSTRAGEM_HZ > 200 ? AQ_MODO_FIFO : AQ_MODO_TIMER)
+#endif
+static const aq_modo_t g_modo_aquisicao = MODO_AQUISICAO;
+static const char *const nomes_modo_aquisicao[] = {"timer", "FIFO", "data-ready"};
+
+// Com LOG_AMOSTRAS_BRUTAS=1 cada amostra do ODR é gravada, em vez das estatísticas de cada janela
+// (no log contínuo; na captura por evento as amostras brutas só saem em volta dos disparos)
+#ifndef LOG_AMOSTRAS_BRUTAS
+#define LOG_AMOSTRAS_BRUTAS 0
+#endif
+
+// Amostras por janela de agregação; 0 = uma janela por segundo (o próprio ODR)
+#ifndef JANELA_AMOSTRAS
+#define JANELA_AMOSTRAS 0
+#endif
+
+// Estatísticas gravadas por janela (máscara de ag_estatistica_t). Mínimo e máximo
+// preservam os picos de choque que a média esconde.
+#ifndef ESTATISTICAS_LOG
+#define ESTATISTICAS_LOG (AG_MEDIA | AG_MIN | AG_MAX)
+#endif
+
+// Com LOG_AMOSTRAS_BRUTAS=1, grava a TAXA_SAIDA_HZ amostras filtradas em vez de todo o ODR.
+// Ex.: -DTAXA_AMOSTRAGEM_HZ=1000 -DTAXA_SAIDA_HZ=100 -DFILTRO_DECIMACAO=DEC_FIR
+#ifndef FILTRO_DECIMACAO
+#define FILTRO_DECIMACAO DEC_NENHUM
+#endif
+#ifndef TAXA_SAIDA_HZ
+#define TAXA_SAIDA_HZ TAXA_AMOSTRAGEM_HZ
+#endif
+// O fator de decimação é inteiro: uma taxa que não divide o ODR seria gravada em outra
+_Static_assert(TAXA_SAIDA_HZ > 0 && TAXA_SAIDA_HZ <= TAXA_AMOSTRAGEM_HZ && TAXA_AMOSTRAGEM_HZ % TAXA_SAIDA_HZ == 0,
+               "TAXA_SAIDA_HZ precisa ser um divisor de TAXA_AMOSTRAGEM_HZ");
+
+// Espectro de vibração de ax, ay e az em blocos de ESPECTRO_PONTOS amostras (potência de 2,
+// até 512), gravado em <arquivo>_fft.csv: energia de cada banda e frequência do pico.
+// 0 desliga. Bandas padrão: de ODR/50 a ODR/20, /10, /5 e /2 (a Nyquist).
+#ifndef ESPECTRO_PONTOS
+#define ESPECTRO_PONTOS 0
+#endif
+#ifndef ESPECTRO_BORDAS_HZ
+#define ESPECTRO_BORDAS_HZ {TAXA_AMOSTRAGEM_HZ / 50, TAXA_AMOSTRAGEM_HZ / 20, TAXA_AMOSTRAGEM_HZ / 10, \
+                            TAXA_AMOSTRAGEM_HZ / 5, TAXA_AMOSTRAGEM_HZ / 2}
+#endif
+
+// Orientação (quaternion e roll/pitch/yaw) estimada a cada amostra e gravada em
+// cada linha do log. Também aparece no display durante a captura.
+#ifndef ORIENTACAO
+#define ORIENTACAO 1
+#endif
+
+// Captura por evento: a amostragem roda o tempo todo, o arquivo principal recebe só
+// as estatísticas das janelas e cada disparo grava em <arquivo>_eventos.csv, em taxa
+// plena, GATILHO_PRE_MS antes e GATILHO_POS_MS depois. Com o log ativo o botão A
+// dispara um evento manual; o log para pelo 'p' ou ao desmontar o cartão.
+// GATILHO_TIPO=GAT_DESLIGADO volta ao log contínuo, iniciado e parado pelo botão A.
+#ifndef GATILHO_TIPO
+#define GATILHO_TIPO GAT_MAGNITUDE
+#endif
+// Canal avaliado (0..6 = ax..temp); na magnitude, 0 = vetor accel e 3 = vetor gyro
+#ifndef GATILHO_CANAL
+#define GATILHO_CANAL 0
+#endif
+// Em LSB do canal. Padrão: 0,5 g a ±2 g, ou seja, choques acima de 1,5 g ou queda livre abaixo de 0,5 g
+#ifndef GATILHO_LIMIAR
+#define GATILHO_LIMIAR 8192
+#endif
+#ifndef GATILHO_PRE_MS
+#define GATILHO_PRE_MS 500
+#endif
+#ifndef GATILHO_POS_MS
+#define GATILHO_POS_MS 2000
+#endif
+#define CAPTURA_POR_EVENTO (GATILHO_TIPO != GAT_DESLIGADO)
+// O anel é dividido entre os sensores: com vários, o início de sessão recusa um
+// GATILHO_PRE_MS que não caiba
+_Static_assert(GATILHO_PRE_MS * TAXA_AMOSTRAGEM_HZ / 1000 < GAT_AMOSTRAS_MAX,
+               "GATILHO_PRE_MS nao cabe no anel de pre-disparo (GAT_AMOSTRAS_MAX)");
+
+// Taxa adaptativa: com os sensores parados por TAXA_ADAPTATIVA_JANELAS janelas, eles
+// entram no modo cíclico (só o acelerômetro, a TAXA_REPOUSO) e cada janela passa a
+// cobrir mais tempo: menos linhas e menos f_sync com a máquina parada. Uma amostra
+// que se afaste MOVIMENTO_MG da média parada volta à taxa plena no tick seguinte.
+// Cada troca vira uma linha '# taxa_odr_mhz=...' no log. Só no modo timer e sem decimação.
+#ifndef TAXA_ADAPTATIVA
+#define TAXA_ADAPTATIVA 0
+#endif
+#ifndef TAXA_REPOUSO
+#define TAXA_REPOUSO MPU6050_CICLO_5HZ
+#endif
+#ifndef TAXA_ADAPTATIVA_JANELAS
+#define TAXA_ADAPTATIVA_JANELAS 5
+#endif
+// Desvio padrão por eixo de uma janela parada
+#define REPOUSO_DESVIO_ACCEL_MG 10
+#define REPOUSO_DESVIO_GYRO_CDPS 50
+#define MOVIMENTO_MG 50
+_Static_assert(!TAXA_ADAPTATIVA || (MODO_AQUISICAO == AQ_MODO_TIMER && FILTRO_DECIMACAO == DEC_NENHUM),
+               "TAXA_ADAPTATIVA exige o modo timer e FILTRO_DECIMACAO=DEC_NENHUM");
+
+// Amostras brutas no arquivo principal: só no log contínuo
+#define LOG_BRUTO_CONTINUO (LOG_AMOSTRAS_BRUTAS && !CAPTURA_POR_EVENTO)
+
+// Formato do arquivo principal: 0 = CSV, 1 = binário (lib/log_binario.h) em <base>.bin,
+// com ~22 bytes por amostra em vez de ~45 e sem formatação de texto no gravador. Os
+// arquivos de espectro e de eventos continuam em CSV. host/exportar converte para CSV.
+#ifndef LOG_BINARIO
+#define LOG_BINARIO 0
+#endif
+// Amostras do log binário comprimidas (diferenças em bits, ver lib/log_binario.h):
+// vale só com LOG_BINARIO e amostras brutas; as janelas ficam no tamanho fixo
+#ifndef LOG_COMPRIMIDO
+#define LOG_COMPRIMIDO 0
+#endif
+static lb_escritor_t g_log_binario;
+
+static const aq_config_t g_config_aquisicao = {
+    .modo = MODO_AQUISICAO,
+    .publicar_amostras = LOG_BRUTO_CONTINUO,
+    .publicar_janelas = !LOG_BRUTO_CONTINUO,
+    .janela_amostras = JANELA_AMOSTRAS,
+    .estatisticas = ESTATISTICAS_LOG,
+    .decimacao = {.tipo = FILTRO_DECIMACAO, .fator = TAXA_AMOSTRAGEM_HZ / TAXA_SAIDA_HZ},
+    .espectro = {.pontos = ESPECTRO_PONTOS,
+                 .num_bandas = sizeof((uint16_t[])ESPECTRO_BORDAS_HZ) / sizeof(uint16_t) - 1,
+                 .bordas_hz = ESPECTRO_BORDAS_HZ},
+    .orientacao = ORIENTACAO,
+    .gatilho = {.tipo = GATILHO_TIPO,
+                .canal = GATILHO_CANAL,
+                .limiar = GATILHO_LIMIAR,
+                .pre_amostras = GATILHO_PRE_MS * TAXA_AMOSTRAGEM_HZ / 1000,
+                .pos_amostras = GATILHO_POS_MS * TAXA_AMOSTRAGEM_HZ / 1000},
+    .adaptativa = {.habilitada = TAXA_ADAPTATIVA,
+                   .desvio_accel_mg = REPOUSO_DESVIO_ACCEL_MG,
+                   .desvio_gyro_cdps = REPOUSO_DESVIO_GYRO_CDPS,
+                   .movimento_mg = MOVIMENTO_MG,
+                   .janelas_repouso = TAXA_ADAPTATIVA_JANELAS,
+                   .ciclo = TAXA_REPOUSO}};
+
+static const char *const nomes_canais[AQ_NUM_CANAIS] = {"ax", "ay", "az", "gx", "gy", "gz", "temp"};
+
+// Calibração do giroscópio: bias medido em repouso e deriva com a temperatura do sensor.
+// O bias muda a cada vez que o sensor liga, então o boot o renova com CAL_BOOT_MS parado;
+// o coeficiente térmico vem da flash, ajustado pela calibração completa (atalho 'l').
+#ifndef CAL_BOOT_MS
+#define CAL_BOOT_MS 2000
+#endif
+#ifndef CAL_COMPLETA_S
+#define CAL_COMPLETA_S 60
+#endif
+
+// Grava o bias nos registradores de offset do MPU6050. Sem deriva térmica a correção
+// sai de graça: o próprio sensor já entrega o gyro corrigido.
+#ifndef CAL_OFFSETS_SENSOR
+#define CAL_OFFSETS_SENSOR 1
+#endif
+
+// Variação pico a pico aceita em cada eixo durante a medição (°/s); acima disso o sensor se moveu
+#define CAL_LIMITE_REPOUSO_DPS 3
+
+// "CAL2": muda se o formato de calibracao_salva_t mudar
+#define CAL_ASSINATURA 0x324C4143u
+
+// Calibrações na flash, uma por sensor, identificadas pelo barramento e endereço:
+// um sensor ausente num boot não desloca a calibração dos outros
+typedef struct
+{
+    uint16_t id[AQ_MAX_SENSORES]; // Índice do i2c << 8 | endereço; 0 = posição livre
+    cal_gyro_t cal[AQ_MAX_SENSORES];
+} calibracao_salva_t;
+
+static cal_gyro_t g_calibracao[AQ_MAX_SENSORES];
+static bool g_calibracao_valida[AQ_MAX_SENSORES];
+
+static uint16_t id_sensor(const mpu6050_t *mpu)
+{
+    return (uint16_t)(i2c_get_index(mpu->i2c) << 8 | mpu->addr);
 }
 
-static void mpu6050_read_raw(int16_t accel[3], int16_t gyro[3], int16_t *temp)
+// Lê os sensores por 'duracao_ms' e ajusta 'cal' de cada um. 'parado' diz quais ficaram
+// em repouso; os que se mexeram mantêm 'cal' como estava.
+static void medir_repouso(uint32_t duracao_ms, cal_gyro_t cal[], bool parado[])
 {
-    // For this particular device, we send the device the register we want to read
-    // first, then subsequently read from the device. The register is auto incrementing
-    // so we don't need to keep sending the register we want, just the first.
+    // Mede a saída crua: offsets de uma calibração anterior ficam fora da conta
+    static const int16_t sem_offsets[3] = {0, 0, 0};
+    cal_acumulador_t acc[AQ_MAX_SENSORES];
+    bool sem_offsets_ok[AQ_MAX_SENSORES];
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        cal_iniciar(&acc[i]);
+        sem_offsets_ok[i] = mpu6050_definir_offsets_gyro(g_sensores[i], sem_offsets);
+    }
 
-    uint8_t buffer[6];
+    uint16_t escala = mpu6050_escala_gyro_x10(g_mpu);
+    uint32_t periodo_ms = 1000 / mpu6050_taxa_amostragem_hz(g_mpu);
+    absolute_time_t fim = make_timeout_time_ms(duracao_ms);
+    while (absolute_time_diff_us(get_absolute_time(), fim) > 0)
+    {
+        for (uint8_t i = 0; i < g_num_sensores; i++)
+        {
+            imu_dados_t dados;
+            uint64_t timestamp_us = 0;
+            if (sem_offsets_ok[i] && imu_ler(&g_imus[i], &dados, &timestamp_us))
+                cal_acumular(&acc[i], dados.gyro, dados.temp);
+        }
+        sleep_ms(periodo_ms ? periodo_ms : 1);
+    }
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        printf("Calibracao do sensor %u: %lu amostras, temperatura de %.1f a %.1f C\n", i, acc[i].n,
+               acc[i].min_t / 340.0f + 36.53f, acc[i].max_t / 340.0f + 36.53f);
+        parado[i] = sem_offsets_ok[i] && cal_ajustar(&acc[i], escala, CAL_LIMITE_REPOUSO_DPS * escala / 10, &cal[i]);
+    }
+}
 
-    // Start reading acceleration registers from register 0x3B for 6 bytes
-    uint8_t val = 0x3B;
-    i2c_write_blocking(I2C_PORT, addr, &val, 1, true); // true to keep master control of bus
-    i2c_read_blocking(I2C_PORT, addr, buffer, 6, false);
+// Entrega a calibração de cada sensor à aquisição, pelos offsets do sensor quando possível
+static void aplicar_calibracao()
+{
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        if (!g_calibracao_valida[i])
+        {
+            aquisicao_definir_calibracao(i, NULL);
+            continue;
+        }
+        if (CAL_OFFSETS_SENSOR)
+        {
+            int16_t offsets[3];
+            cal_gyro_t residual;
+            cal_offsets_sensor(&g_calibracao[i], offsets, &residual);
+            if (mpu6050_definir_offsets_gyro(g_sensores[i], offsets))
+            {
+                // O resíduo é menor que meio passo do registrador (0,015 °/s): sem deriva
+                // térmica, nada resta a fazer por amostra
+                aquisicao_definir_calibracao(i, cal_sem_deriva(&residual) ? NULL : &residual);
+                continue;
+            }
+        }
+        aquisicao_definir_calibracao(i, &g_calibracao[i]);
+    }
+}
 
-    for (int i = 0; i < 3; i++)
+static void mostrar_calibracao()
+{
+    float lsb_dps = mpu6050_escala_gyro_x10(g_mpu) / 10.0f;
+    for (uint8_t s = 0; s < g_num_sensores; s++)
     {
-        accel[i] = (buffer[i * 2] << 8 | buffer[(i * 2) + 1]);
+        if (!g_calibracao_valida[s])
+            continue;
+        const cal_gyro_t *cal = &g_calibracao[s];
+        printf(" Sensor %u (i2c%d, 0x%02x):\n", s, i2c_get_index(g_sensores[s]->i2c), g_sensores[s]->addr);
+        for (int i = 0; i < 3; i++)
+            printf("  %s: bias %.3f dps a %.1f C, deriva %.4f dps/C\n", nomes_canais[3 + i],
+                   cal->bias_q8[i] / 256.0f / lsb_dps, cal->temp_ref / 340.0f + 36.53f,
+                   cal->coef_q16[i] / 65536.0f * 340.0f / lsb_dps);
     }
+}
 
-    // Now gyro data from reg 0x43 for 6 bytes
-    // The register is auto incrementing on each read
-    val = 0x43;
-    i2c_write_blocking(I2C_PORT, addr, &val, 1, true);
-    i2c_read_blocking(I2C_PORT, addr, buffer, 6, false); // False - finished with bus
+// Calibração gravada para o sensor, convertida para o fundo de escala atual
+static bool calibracao_da_flash(const calibracao_salva_t *salva, const mpu6050_t *mpu, cal_gyro_t *cal)
+{
+    for (int i = 0; i < AQ_MAX_SENSORES; i++)
+    {
+        if (salva->id[i] == id_sensor(mpu))
+        {
+            *cal = salva->cal[i];
+            cal_converter_escala(cal, mpu6050_escala_gyro_x10(mpu));
+            return true;
+        }
+    }
+    return false;
+}
+
+// No boot: coeficientes da flash e bias renovado nos sensores que estiverem parados
+static void iniciar_calibracao()
+{
+    calibracao_salva_t salva;
+    bool tem_flash = config_flash_ler(CAL_ASSINATURA, &salva, sizeof salva);
 
-    for (int i = 0; i < 3; i++)
+    cal_gyro_t nova[AQ_MAX_SENSORES];
+    bool da_flash[AQ_MAX_SENSORES], parado[AQ_MAX_SENSORES];
+    for (uint8_t i = 0; i < g_num_sensores; i++)
     {
-        gyro[i] = (buffer[i * 2] << 8 | buffer[(i * 2) + 1]);
+        da_flash[i] = tem_flash && calibracao_da_flash(&salva, g_sensores[i], &g_calibracao[i]);
+        if (!da_flash[i])
+            memset(&g_calibracao[i], 0, sizeof g_calibracao[i]);
+        nova[i] = g_calibracao[i];
     }
 
-    // Now temperature from reg 0x41 for 2 bytes
-    // The register is auto incrementing on each read
-    val = 0x41;
-    i2c_write_blocking(I2C_PORT, addr, &val, 1, true);
-    i2c_read_blocking(I2C_PORT, addr, buffer, 2, false); // False - finished with bus
+    medir_repouso(CAL_BOOT_MS, nova, parado);
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        if (parado[i])
+        {
+            g_calibracao[i] = nova[i];
+            g_calibracao_valida[i] = true;
+            printf("Calibracao do gyro %u: bias renovado%s\n", i, da_flash[i] ? ", deriva termica da flash" : "");
+        }
+        else
+        {
+            g_calibracao_valida[i] = da_flash[i];
+            printf("Calibracao do gyro %u: sensor em movimento, %s\n", i,
+                   da_flash[i] ? "usando o bias da flash" : "sem correcao");
+        }
+    }
+    mostrar_calibracao();
+    aplicar_calibracao();
+}
+
+// Calibração completa: CAL_COMPLETA_S em repouso (de preferência logo após ligar,
+// enquanto os sensores aquecem), ajuste do coeficiente térmico e gravação na flash
+static void run_calibrar()
+{
+    if (g_log_ativo)
+    {
+        printf("Pare o log antes de calibrar\n");
+        return;
+    }
+    printf("Calibrando o giroscopio por %d s. Nao mova o sensor...\n", CAL_COMPLETA_S);
+    ssd1306_fill(&ssd, false);
+    ssd1306_draw_string(&ssd, "Calibrando...", 16, 24);
+    ssd1306_draw_string(&ssd, "Nao mova", 32, 40);
+    ssd1306_send_data(&ssd);
+
+    cal_gyro_t nova[AQ_MAX_SENSORES];
+    bool parado[AQ_MAX_SENSORES];
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        nova[i] = g_calibracao[i];
+        if (!g_calibracao_valida[i])
+            memset(&nova[i], 0, sizeof nova[i]);
+    }
+    medir_repouso(CAL_COMPLETA_S * 1000, nova, parado);
+
+    // Quem se mexeu fica com a calibração anterior (os offsets são restaurados abaixo)
+    calibracao_salva_t salva = {0};
+    uint8_t calibrados = 0;
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        if (parado[i])
+        {
+            g_calibracao[i] = nova[i];
+            g_calibracao_valida[i] = true;
+            calibrados++;
+        }
+        else
+        {
+            printf("ERRO: o sensor %u se moveu durante a calibracao\n", i);
+        }
+        if (g_calibracao_valida[i])
+        {
+            salva.id[i] = id_sensor(g_sensores[i]);
+            salva.cal[i] = g_calibracao[i];
+        }
+    }
+    mostrar_calibracao();
+    aplicar_calibracao();
+    if (calibrados == 0)
+        return;
+    if (config_flash_gravar(CAL_ASSINATURA, &salva, sizeof salva))
+        printf("Calibracao gravada na flash\n");
+    else
+        printf("ERRO: nao foi possivel gravar a calibracao na flash\n");
+}
 
-    *temp = buffer[0] << 8 | buffer[1];
+// Mostra quanto da fila entre a aquisição e o gravador já foi usado
+static void mostrar_estado_fila()
+{
+    aq_estado_fila_t f;
+    aquisicao_obter_estado_fila(&f);
+    printf("Fila: %lu/%lu registros, maior ocupacao %lu, descartes %lu\n",
+           f.ocupacao, f.capacidade, f.maior_ocupacao, f.descartes);
 }
 
-// Funções para capturar log de forma contínua
-// Esta função é chamada pela interrupção do timer a cada 10ms.
-bool timer_callback(struct repeating_timer *t)
+// Mostra a dispersão do intervalo entre amostras, para comparar os modos timer e data-ready
+static void mostrar_jitter()
+{
+    aq_jitter_t j;
+    aquisicao_obter_jitter(&j);
+    if (j.intervalos == 0)
+    {
+        printf("Sem intervalos medidos (modo %s)\n", nomes_modo_aquisicao[g_modo_aquisicao]);
+        return;
+    }
+    printf("Jitter (%s, %lu intervalos, nominal %lu us): min %lu us, max %lu us, media %.2f us, desvio %.2f us\n",
+           nomes_modo_aquisicao[g_modo_aquisicao], j.intervalos, j.periodo_nominal_us,
+           j.min_us, j.max_us, j.media_us, j.desvio_padrao_us);
+}
+
+static uint32_t bytes_sem_sync();
+
+// Quanto um corte de energia agora levaria: o que foi gravado depois do último f_sync
+// e o que ainda está na fila. O limite vem da política; sem ela (manual), só o botão,
+// o comando 'f' ou o fim da captura fecham a conta.
+static void mostrar_durabilidade()
+{
+    const grav_politica_t *p = &g_politica_sync;
+    aq_estado_fila_t f;
+    aquisicao_obter_estado_fila(&f);
+    if (p->modo == GRAV_SYNC_MANUAL)
+        printf("Durabilidade: f_sync manual (botao B, 'f' ou parar); perda maxima: tudo desde o ultimo f_sync "
+               "+ %lu registros da fila\n", f.capacidade);
+    else
+        printf("Durabilidade: f_sync a cada %lu %s; perda maxima: %lu %s + %lu registros da fila\n", p->limite,
+               grav_unidade_sync(p->modo), p->limite, grav_unidade_sync(p->modo), f.capacidade);
+    if (g_log_ativo)
+        printf("Sem f_sync agora: %lu registros, %lu bytes, %lu ms; %lu registros na fila\n",
+               g_registros_sem_sync, bytes_sem_sync(), to_ms_since_boot(get_absolute_time()) - g_ultimo_sync_ms,
+               f.ocupacao);
+}
+
+// Balanço da sessão: o que foi adquirido, agregado, gravado e o que se perdeu em cada etapa
+static void mostrar_contadores()
+{
+    aq_contadores_t c;
+    aquisicao_obter_contadores(&c);
+    printf("Sessao: %lu amostras adquiridas, %lu agregadas, %lu registros gerados, %lu gravados\n",
+           c.amostras_adquiridas, c.amostras_agregadas, c.registros_gerados, g_registros_gravados);
+    printf("Perdas: %lu leituras I2C, %lu ressinc. FIFO, %lu lacunas (~%lu amostras), "
+           "%lu descartes na fila, %lu saltos de sequencia, %lu falhas de gravacao\n",
+           c.leituras_perdidas, c.ressincronizacoes_fifo, c.lacunas, c.amostras_faltando,
+           c.registros_descartados, g_saltos_sequencia, g_falhas_gravacao);
+    const gravador_t *g = &g_grav_log;
+    printf("Gravador: %llu bytes em %lu blocos de ate %u bytes, %lu trechos parciais, %lu f_sync, "
+           "%lu bytes so na RAM, maior escrita %lu us\n",
+           g->bytes, g->escritas, GRAV_BLOCO_BYTES, g->escritas_parciais, g->sincronizacoes,
+           gravador_bytes_na_ram(g), g_maior_escrita_us);
+    if (g_parte->nome[0])
+        printf("Arquivo: %s (sessao %lu, parte %lu)%s\n", g_parte->nome, g_sessao, g_parte->numero,
+               g_proxima->aberta ? ", proxima parte ja criada" : "");
+    const prealocado_t *r = &g_parte->prealocado;
+    if (PREALOCAR_MB)
+        printf("Reserva: %llu de %llu bytes usados, %llu no diretorio, %lu checkpoints, %lu erros de setor\n",
+               (unsigned long long)r->tamanho, (unsigned long long)r->reservado,
+               (unsigned long long)r->confirmado, r->checkpoints, r->erros);
+    mostrar_durabilidade();
+    if (ESPECTRO_PONTOS)
+        printf("Espectro: %lu blocos perdidos (FFT ocupada)\n", c.espectros_perdidos);
+    if (CAPTURA_POR_EVENTO)
+        printf("Eventos: %lu, %lu amostras de evento perdidas\n", c.eventos, c.amostras_evento_perdidas);
+    if (TAXA_ADAPTATIVA)
+        printf("Taxa adaptativa: %lu trocas, %lu s em repouso%s\n", c.trocas_taxa, c.tempo_repouso_ms / 1000,
+               aquisicao_em_repouso() ? " (em repouso agora)" : "");
+}
+
+static int gravar_fim_linha(gravador_t *arquivo)
+{
+    return gravador_escrever(arquivo, "\n", 1) ? 1 : -1;
+}
+
+// Cabeçalho de amostras brutas ou com uma coluna por canal de cada estatística
+// habilitada (ax_avg, ..., ax_min, ...)
+static void gravar_cabecalho(gravador_t *arquivo, bool amostras)
+{
+    if (amostras)
+    {
+        gravador_printf(arquivo, "seq;sensor;timestamp_us;ax;ay;az;gx;gy;gz;temp");
+    }
+    else
+    {
+        gravador_printf(arquivo, "seq;sensor;t_inicio_us;t_fim_us");
+        for (uint32_t e = 0; e < AG_NUM_ESTATISTICAS; e++)
+            if (ESTATISTICAS_LOG & (1u << e))
+                for (int c = 0; c < AQ_NUM_CANAIS; c++)
+                    gravador_printf(arquivo, ";%s_%s", nomes_canais[c], ag_nome_estatistica(e));
+    }
+    if (ORIENTACAO)
+        gravador_printf(arquivo, ";qw;qx;qy;qz;roll_cdeg;pitch_cdeg;yaw_cdeg");
+    gravar_fim_linha(arquivo);
+}
+
+// Quaternion (Q14) e ângulos (centésimos de grau) no fim da linha, se habilitados
+static char *formatar_orientacao(char *p, const aq_registro_t *r)
+{
+    if (!ORIENTACAO)
+        return p;
+    p = fmt_campos_i16(p, r->orientacao.q, 4);
+    return fmt_campos_i16(p, r->orientacao.rpy_cdeg, 3);
+}
+
+// Uma linha por amostra bruta: um instante só. Montada direto no bloco do gravador,
+// sem printf: ~140 bytes no pior caso, com a orientação.
+static int gravar_amostra(gravador_t *arquivo, const aq_registro_t *r)
+{
+    char reserva[GRAV_LINHA_MAX];
+    char *inicio = gravador_reservar(arquivo, GRAV_LINHA_MAX, reserva);
+    char *p = fmt_u32(inicio, r->sequencia);
+    *p++ = ';';
+    p = fmt_u32(p, r->sensor);
+    *p++ = ';';
+    p = fmt_u64(p, r->timestamp_fim_us);
+    p = fmt_campos_i16(p, r->canais, AQ_NUM_CANAIS);
+    p = formatar_orientacao(p, r);
+    *p++ = '\n';
+    uint32_t len = (uint32_t)(p - inicio);
+    return gravador_confirmar(arquivo, inicio, len) ? (int)len : -1;
+}
+
+// Marcador de evento, antes das amostras dele. 'condicao' é o gat_tipo_t (0 = manual)
+// e 'sensor', o que disparou; as amostras que seguem são de todos os sensores.
+static int gravar_evento(const aq_registro_t *r)
+{
+    const gat_evento_t *e = &r->evento;
+    return gravador_printf(&g_grav_eventos, "# evento=%lu;t_gatilho_us=%llu;condicao=%d;canal=%d;sensor=%u;valor=%ld;amostras_pre=%lu\n",
+                    e->numero, r->timestamp_fim_us, e->tipo, e->canal, e->sensor, e->valor, e->pre_amostras);
+}
+
+// Troca da taxa adaptativa: as linhas seguintes são da taxa nova. 'repouso' = 1 é o
+// modo cíclico, com o gyro desligado (lido como zero).
+static int gravar_taxa(const aq_registro_t *r)
+{
+    return gravador_printf(&g_grav_log, "# taxa_odr_mhz=%lu;t_taxa_us=%llu;repouso=%d\n",
+                    r->taxa.odr_mhz, r->timestamp_fim_us, r->taxa.repouso);
+}
+
+// Uma linha por janela, com as estatísticas na mesma ordem do cabeçalho. Montada em
+// dois trechos de até GRAV_LINHA_MAX: os tempos e as estatísticas de 16 bits (até
+// 56 + 4 x 49 bytes), depois a variância e a orientação.
+static int gravar_janela(const aq_registro_t *r)
+{
+    const ag_resultado_t *j = &r->janela;
+    char reserva[GRAV_LINHA_MAX];
+    char *inicio = gravador_reservar(&g_grav_log, GRAV_LINHA_MAX, reserva);
+    char *p = fmt_u32(inicio, r->sequencia);
+    *p++ = ';';
+    p = fmt_u32(p, r->sensor);
+    *p++ = ';';
+    p = fmt_u64(p, r->timestamp_inicio_us);
+    *p++ = ';';
+    p = fmt_u64(p, r->timestamp_fim_us);
+    if (ESTATISTICAS_LOG & AG_MEDIA)
+        p = fmt_campos_i16(p, j->media, AQ_NUM_CANAIS);
+    if (ESTATISTICAS_LOG & AG_MIN)
+        p = fmt_campos_i16(p, j->min, AQ_NUM_CANAIS);
+    if (ESTATISTICAS_LOG & AG_MAX)
+        p = fmt_campos_i16(p, j->max, AQ_NUM_CANAIS);
+    if (ESTATISTICAS_LOG & AG_RMS)
+        for (int c = 0; c < AQ_NUM_CANAIS; c++)
+        {
+            *p++ = ';';
+            p = fmt_u32(p, j->rms[c]);
+        }
+    uint32_t len = (uint32_t)(p - inicio);
+    bool ok = gravador_confirmar(&g_grav_log, inicio, len);
+
+    inicio = gravador_reservar(&g_grav_log, GRAV_LINHA_MAX, reserva);
+    p = inicio;
+    if (ESTATISTICAS_LOG & AG_VARIANCIA)
+        for (int c = 0; c < AQ_NUM_CANAIS; c++)
+        {
+            *p++ = ';';
+            p = fmt_i32(p, (int32_t)j->variancia[c]);
+        }
+    p = formatar_orientacao(p, r);
+    *p++ = '\n';
+    len += (uint32_t)(p - inicio);
+    ok = gravador_confirmar(&g_grav_log, inicio, (uint32_t)(p - inicio)) && ok;
+    return ok ? (int)len : -1;
+}
+
+// Bloco do log binário completo (ou fechado antes por um salto de sequência)
+static bool gravar_bloco_binario()
+{
+    bool ok = gravador_escrever(&g_grav_log, lb_fechar_bloco(&g_log_binario), LB_BLOCO);
+    lb_novo_bloco(&g_log_binario);
+    return ok;
+}
+
+// Amostra, janela ou troca de taxa no log binário
+static int gravar_binario(const aq_registro_t *r)
+{
+    lb_registro_t b = {.sensor = r->sensor,
+                       .timestamp_us = r->tipo == AQ_REGISTRO_JANELA ? r->timestamp_inicio_us : r->timestamp_fim_us,
+                       .timestamp_fim_us = r->timestamp_fim_us,
+                       .orientacao = r->orientacao};
+    if (r->tipo == AQ_REGISTRO_JANELA)
+        b.janela = r->janela;
+    else if (r->tipo == AQ_REGISTRO_AMOSTRA)
+        memcpy(b.canais, r->canais, sizeof b.canais);
+    else
+    {
+        b.sensor = LB_SENSOR_TAXA;
+        b.odr_mhz = r->taxa.odr_mhz;
+        b.repouso = r->taxa.repouso;
+    }
+
+    int escritos = g_log_binario.tamanho_registro;
+    if (!lb_cabe(&g_log_binario, r->sequencia, &b) && !gravar_bloco_binario())
+        escritos = -1;
+    lb_adicionar(&g_log_binario, r->sequencia, &b);
+    if (lb_bloco_cheio(&g_log_binario) && !gravar_bloco_binario())
+        escritos = -1;
+    return escritos;
+}
+
+// Colunas do arquivo de espectro: energia de cada banda (ax_10_50hz, ...) e pico de cada eixo
+static void gravar_cabecalho_espectro()
+{
+    const esp_config_t *esp = &g_config_aquisicao.espectro;
+    gravador_printf(&g_grav_espectro, "seq;sensor;t_inicio_us;t_fim_us");
+    for (int e = 0; e < ESP_NUM_EIXOS; e++)
+    {
+        for (int b = 0; b < esp->num_bandas; b++)
+            gravador_printf(&g_grav_espectro, ";%s_%u_%uhz", nomes_canais[e], esp->bordas_hz[b], esp->bordas_hz[b + 1]);
+        gravador_printf(&g_grav_espectro, ";%s_pico_dhz", nomes_canais[e]);
+    }
+    gravar_fim_linha(&g_grav_espectro);
+}
+
+static int gravar_espectro(const aq_registro_t *r)
+{
+    const esp_resultado_t *esp = &r->espectro;
+    int escritos = gravador_printf(&g_grav_espectro, "%lu;%u;%llu;%llu", r->sequencia, r->sensor,
+                            r->timestamp_inicio_us, r->timestamp_fim_us);
+    for (int e = 0; e < ESP_NUM_EIXOS && escritos >= 0; e++)
+    {
+        for (int b = 0; b < g_config_aquisicao.espectro.num_bandas && escritos >= 0; b++)
+            escritos = gravador_printf(&g_grav_espectro, ";%lu", esp->energia[e][b]);
+        if (escritos >= 0)
+            escritos = gravador_printf(&g_grav_espectro, ";%u", esp->pico_dhz[e]);
+    }
+    if (escritos >= 0)
+        escritos = gravar_fim_linha(&g_grav_espectro);
+    return escritos;
+}
+
+// Gravadores dos arquivos abertos na sessão
+static gravador_t *const g_gravadores[] = {&g_grav_log, &g_grav_espectro, &g_grav_eventos};
+static bool gravador_em_uso(const gravador_t *g)
+{
+    return g == &g_grav_log || (g == &g_grav_espectro && ESPECTRO_PONTOS) ||
+           (g == &g_grav_eventos && CAPTURA_POR_EVENTO);
+}
+
+// Bytes de todos os arquivos da sessão que ainda dependem de um f_sync
+static uint32_t bytes_sem_sync()
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < count_of(g_gravadores); i++)
+        if (gravador_em_uso(g_gravadores[i]))
+            total += gravador_bytes_sem_sync(g_gravadores[i]);
+    if (LOG_BINARIO)
+        total += lb_bytes_no_bloco(&g_log_binario);
+    return total;
+}
+
+static bool sync_vencido()
+{
+    uint32_t ms = to_ms_since_boot(get_absolute_time()) - g_ultimo_sync_ms;
+    return (g_registros_sem_sync || bytes_sem_sync()) &&
+           grav_politica_vencida(&g_politica_sync, g_registros_sem_sync, bytes_sem_sync(), ms);
+}
+
+// No log binário o bloco aberto vai junto, com o rodapé e o CRC do que já tem
+static bool sincronizar_gravador(gravador_t *g)
+{
+    if (!LOG_BINARIO || g != &g_grav_log)
+        return gravador_sincronizar(g);
+    if (!g_log_binario.registros)
+        return gravador_sincronizar(g);
+    return gravador_sincronizar_cauda(g, lb_fechar_bloco(&g_log_binario), LB_BLOCO);
+}
+
+// Leva ao cartão os blocos que encheram e, se 'sincronizar', chama f_sync em todos os arquivos
+static void gravar_blocos(bool sincronizar)
+{
+    uint32_t inicio = time_us_32();
+    for (size_t i = 0; i < count_of(g_gravadores); i++)
+    {
+        gravador_t *g = g_gravadores[i];
+        if (!gravador_em_uso(g))
+            continue;
+        if (!gravador_gravar_prontos(g, UINT32_MAX))
+            g_falhas_gravacao++;
+        if (sincronizar && !sincronizar_gravador(g))
+            g_falhas_gravacao++;
+    }
+    if (sincronizar)
+    {
+        g_ultimo_sync_ms = to_ms_since_boot(get_absolute_time());
+        g_registros_sem_sync = 0;
+    }
+    uint32_t tempo = time_us_32() - inicio;
+    if (tempo > g_maior_escrita_us)
+        g_maior_escrita_us = tempo;
+}
+
+// Grava até 'limite' registros da fila no arquivo. Retorna quantos foram gravados.
+static uint32_t gravar_registros_pendentes(uint32_t limite)
+{
+    aq_registro_t r;
+    uint32_t gravados = 0;
+    while (gravados < limite && aquisicao_obter_registro(&r))
+    {
+        // Um salto na sequência é um registro que a fila descartou antes de chegar aqui
+        g_saltos_sequencia += r.sequencia - g_sequencia_esperada;
+        g_sequencia_esperada = r.sequencia + 1;
+
+        // Timestamps da captura: atrasos do cartão ou do display não aparecem no log.
+        // Uma amostra bruta tem um instante só; uma janela, o início e o fim.
+        // Na captura por evento as amostras vão para o arquivo de eventos.
+        int escritos;
+        if (LOG_BINARIO && (r.tipo == AQ_REGISTRO_JANELA || r.tipo == AQ_REGISTRO_TAXA ||
+                            (r.tipo == AQ_REGISTRO_AMOSTRA && !CAPTURA_POR_EVENTO)))
+            escritos = gravar_binario(&r);
+        else if (r.tipo == AQ_REGISTRO_JANELA)
+            escritos = gravar_janela(&r);
+        else if (r.tipo == AQ_REGISTRO_ESPECTRO)
+            escritos = gravar_espectro(&r);
+        else if (r.tipo == AQ_REGISTRO_EVENTO)
+            escritos = gravar_evento(&r);
+        else if (r.tipo == AQ_REGISTRO_TAXA)
+            escritos = gravar_taxa(&r);
+        else
+            escritos = gravar_amostra(CAPTURA_POR_EVENTO ? &g_grav_eventos : &g_grav_log, &r);
+        if (escritos < 0)
+            g_falhas_gravacao++;
+        else
+            g_registros_gravados++;
+        gravados++;
+        g_registros_sem_sync++;
+
+        // Por registros ou bytes o limite vale no meio do lote, não só no fim dele
+        if (g_politica_sync.modo != GRAV_SYNC_TEMPO && sync_vencido())
+            gravar_blocos(true);
+    }
+    // Por tempo a verificação vale também sem registros novos (eventos esparsos)
+    gravar_blocos(sync_vencido());
+    return gravados;
+}
+
+// f_sync pedido pelo botão B ou pelo comando 'f', em qualquer política
+static void sincronizar_agora()
 {
-    // Se o log não estiver ativo, simplesmente para o timer e sai.
     if (!g_log_ativo)
     {
-        g_dados_prontos_para_gravar = false;
-        return false; // Retornar false cancela o timer
+        printf("Nenhum log ativo.\n");
+        return;
     }
+    uint32_t registros = g_registros_sem_sync, bytes = bytes_sem_sync();
+    gravar_blocos(true);
+    printf("f_sync: %lu registros e %lu bytes confirmados no cartao\n", registros, bytes);
+}
 
-    // Variáveis para acumular as 100 amostras. Usamos 32-bit para não estourar.
-    static int32_t acc_accum[3], gyro_accum[3], temp_accum;
-    static int sample_count = 0;
+// <sessão><sufixo>, ao lado das partes do arquivo principal (ex.: s0007_fft.csv)
+static void nome_companheiro(char nome[32], const char *sufixo)
+{
+    snprintf(nome, 32, "%s%s", g_base_sessao, sufixo);
+}
 
-    // Variáveis temporárias para a leitura do sensor
-    int16_t accel[3], gyro[3], temp_raw;
-    mpu6050_read_raw(accel, gyro, &temp_raw);
+static bool abrir_arquivo_companheiro(FIL *arquivo, const char *sufixo)
+{
+    char nome[32];
+    nome_companheiro(nome, sufixo);
+    FRESULT fr = f_open(arquivo, nome, FA_OPEN_APPEND | FA_WRITE);
+    if (fr != FR_OK)
+        printf("ERRO: Nao foi possivel abrir o arquivo '%s' (%s)\n", nome, FRESULT_str(fr));
+    return fr == FR_OK;
+}
 
-    // Acumula os valores
-    for (int i = 0; i < 3; i++)
+// Regrava a lista de recuperação: nome;sessão;parte;bytes reservados por arquivo aberto
+// (sessão 0 nos arquivos de espectro e de eventos, que só têm o fim conferido)
+static void anotar_abertas()
+{
+    FIL *f = &g_catalogo_file;
+    if (f_open(f, PARTES_ABERTAS, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
     {
-        acc_accum[i] += accel[i];
-        gyro_accum[i] += gyro[i];
+        printf("ERRO: Nao foi possivel atualizar %s\n", PARTES_ABERTAS);
+        return;
     }
-    temp_accum += temp_raw;
-    sample_count++;
+    char linha[64];
+    bool ok = true;
+    for (size_t i = 0; i < count_of(g_partes); i++)
+        if (g_partes[i].aberta)
+        {
+            snprintf(linha, sizeof linha, "%s;%lu;%lu;%llu\n", g_partes[i].nome, g_sessao, g_partes[i].numero,
+                     (uint64_t)PREALOCAR_MB << 20);
+            ok = f_puts(linha, f) >= 0 && ok;
+        }
+    static const char *const sufixos[] = {"_fft.csv", "_eventos.csv"};
+    const bool em_uso[] = {ESPECTRO_PONTOS, CAPTURA_POR_EVENTO};
+    for (size_t i = 0; i < count_of(sufixos) && g_companheiros_abertos; i++)
+        if (em_uso[i])
+        {
+            char nome[32];
+            nome_companheiro(nome, sufixos[i]);
+            snprintf(linha, sizeof linha, "%s;0;0;0\n", nome);
+            ok = f_puts(linha, f) >= 0 && ok;
+        }
+    if (f_close(f) != FR_OK || !ok)
+        printf("ERRO: Nao foi possivel atualizar %s\n", PARTES_ABERTAS);
+}
 
-    if (sample_count >= 100)
+// Grava o que restou nos blocos e fecha o arquivo
+static void fechar_arquivo(gravador_t *g)
+{
+    if (!gravador_finalizar(g))
+        g_falhas_gravacao++;
+    if (g == &g_grav_log)
+    {
+        // Os dados já estão confirmados: a parte sai da lista antes do corte
+        g_parte->aberta = false;
+        anotar_abertas();
+    }
+    if (PREALOCAR_MB && g == &g_grav_log)
     {
-        // Calcula a média de cada sensor
-        g_dados_medios[0] = acc_accum[0] / 100;
-        g_dados_medios[1] = acc_accum[1] / 100;
-        g_dados_medios[2] = acc_accum[2] / 100;
-        g_dados_medios[3] = gyro_accum[0] / 100;
-        g_dados_medios[4] = gyro_accum[1] / 100;
-        g_dados_medios[5] = gyro_accum[2] / 100;
-        g_dados_medios[6] = temp_accum / 100;
+        if (prealocado_fechar(&g_parte->prealocado) != FR_OK)
+            g_falhas_gravacao++;
+    }
+    else
+        f_close(g->arquivo);
+}
 
-        // Reseta os acumuladores e o contador para o próximo segundo
-        for (int i = 0; i < 3; i++)
+// Fecha o arquivo principal e os companheiros abertos
+static void fechar_arquivos_log()
+{
+    // Sai antes do arquivo principal, cujo fechamento regrava a lista
+    g_companheiros_abertos = false;
+    fechar_arquivo(&g_grav_log);
+    if (ESPECTRO_PONTOS)
+        fechar_arquivo(&g_grav_espectro);
+    if (CAPTURA_POR_EVENTO)
+        fechar_arquivo(&g_grav_eventos);
+}
+
+// Data e hora do RTC; false se ele nunca foi acertado (ano 0 depois de time_init)
+static bool data_hora(datetime_t *t)
+{
+    return rtc_get_datetime(t) && t->year;
+}
+
+// Número da última sessão: o primeiro campo da última linha do catálogo
+static uint32_t ultima_sessao()
+{
+    FIL *f = &g_catalogo_file;
+    if (f_open(f, CATALOGO, FA_READ) != FR_OK)
+        return 0;
+    char texto[128];
+    UINT n = 0;
+    FSIZE_t tamanho = f_size(f);
+    if (f_lseek(f, tamanho > sizeof texto - 1 ? tamanho - (sizeof texto - 1) : 0) != FR_OK ||
+        f_read(f, texto, sizeof texto - 1, &n) != FR_OK)
+        n = 0;
+    f_close(f);
+    while (n && (texto[n - 1] == '\n' || texto[n - 1] == '\r'))
+        n--;
+    texto[n] = '\0';
+    const char *linha = strrchr(texto, '\n');
+    return strtoul(linha ? linha + 1 : texto, NULL, 10);
+}
+
+// Acrescenta uma linha ao catálogo; o cabeçalho vai junto quando ele ainda não existe
+static bool anotar_catalogo(const char *linha)
+{
+    FIL *f = &g_catalogo_file;
+    if (f_open(f, CATALOGO, FA_OPEN_APPEND | FA_WRITE) != FR_OK)
+        return false;
+    bool ok = true;
+    if (f_size(f) == 0)
+        ok = f_puts("sessao;parte;arquivo;inicio;duracao_s;bytes;registros\n", f) >= 0;
+    ok = f_puts(linha, f) >= 0 && ok;
+    return f_close(f) == FR_OK && ok;
+}
+
+// Partes que ficaram abertas quando a placa desligou (PARTES_ABERTAS): o fim rasgado
+// é cortado, o que estava na reserva além do tamanho no diretório volta ao arquivo e
+// cada parte entra no catálogo, sem a duração e os registros, que só a placa sabia
+static void recuperar_partes()
+{
+    FIL *f = &g_catalogo_file;
+    if (f_open(f, PARTES_ABERTAS, FA_READ) != FR_OK)
+        return;
+    // A lista inteira antes: o catálogo usa o mesmo FIL
+    char linhas[4][64];
+    size_t n = 0;
+    while (n < count_of(linhas) && f_gets(linhas[n], sizeof linhas[n], f))
+        n++;
+    f_close(f);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        char nome[32];
+        unsigned long sessao, parte;
+        unsigned long long reservado;
+        if (sscanf(linhas[i], "%31[^;];%lu;%lu;%llu", nome, &sessao, &parte, &reservado) != 4)
+            continue;
+        rec_arquivo_t a = {.binario = strstr(nome, ".bin") != NULL,
+                           .sessao = sessao,
+                           .parte = parte,
+                           .reservado = reservado};
+        rec_resultado_t r;
+        FRESULT fr = rec_recuperar(nome, &a, &r);
+        if (fr != FR_OK)
+        {
+            printf("Recuperacao: '%s' (%s)\n", nome, FRESULT_str(fr));
+            continue;
+        }
+        if (r.removido)
+        {
+            printf("Recuperacao: '%s' vazio, removido\n", nome);
+            continue;
+        }
+        printf("Recuperacao: '%s' %llu -> %llu bytes (%lu setores lidos)%s\n", nome, r.tamanho_anterior,
+               r.tamanho, r.setores_lidos, a.sessao && !r.identificado ? ", cabecalho nao confere" : "");
+        if (a.sessao)
         {
-            acc_accum[i] = 0;
-            gyro_accum[i] = 0;
+            char linha[96];
+            snprintf(linha, sizeof linha, "%lu;%lu;%s;%s;;%llu;\n", sessao, parte, nome, r.inicio, r.tamanho);
+            if (!anotar_catalogo(linha))
+                printf("ERRO: Nao foi possivel atualizar %s\n", CATALOGO);
         }
-        temp_accum = 0;
-        sample_count = 0;
+    }
+    f_unlink(PARTES_ABERTAS);
+}
+
+// Linha do catálogo da parte atual, montada antes de fechá-la
+static void montar_linha_catalogo()
+{
+    snprintf(g_linha_catalogo, sizeof g_linha_catalogo, "%lu;%lu;%s;%s;%lu;%llu;%lu\n", g_sessao,
+             g_parte->numero, g_parte->nome, g_parte->inicio,
+             (to_ms_since_boot(get_absolute_time()) - g_parte->inicio_ms) / 1000, g_grav_log.bytes,
+             g_registros_gravados - g_parte->registros_inicio);
+}
 
-        // Sinaliza para o loop principal que há dados prontos para serem gravados no arquivo
-        g_dados_prontos_para_gravar = true;
+// Cria a parte 'numero' da sessão (sempre um arquivo novo), com a reserva se PREALOCAR_MB
+static FRESULT abrir_parte(parte_log_t *p, uint32_t numero)
+{
+    snprintf(p->nome, sizeof p->nome, "%s_%02lu%s", g_base_sessao, numero, LOG_BINARIO ? ".bin" : ".csv");
+    p->numero = numero;
+    FRESULT fr = PREALOCAR_MB ? prealocado_criar(&p->prealocado, &p->arquivo, p->nome, (FSIZE_t)PREALOCAR_MB << 20)
+                              : f_open(&p->arquivo, p->nome, FA_CREATE_NEW | FA_WRITE);
+    if (fr == FR_OK && PREALOCAR_MB)
+        prealocado_como_destino(&p->prealocado, &p->destino);
+    p->aberta = fr == FR_OK;
+    return fr;
+}
+
+// Remove a parte criada antes da hora que não chegou a ser usada
+static void descartar_parte(parte_log_t *p)
+{
+    if (!p->aberta)
+        return;
+    p->aberta = false;
+    anotar_abertas();
+    if (PREALOCAR_MB)
+        prealocado_fechar(&p->prealocado);
+    else
+        f_close(&p->arquivo);
+    f_unlink(p->nome);
+}
+
+// Desfaz uma sessão que não chegou a começar: a primeira parte e os arquivos ao lado
+// já abertos saem do cartão, e o próximo início pode usar o mesmo nome
+static void descartar_sessao(bool espectro_aberto, bool eventos_aberto)
+{
+    g_companheiros_abertos = false;
+    descartar_parte(g_parte);
+    g_parte->nome[0] = '\0';
+    char nome[32];
+    if (espectro_aberto)
+    {
+        f_close(&g_espectro_file);
+        nome_companheiro(nome, "_fft.csv");
+        f_unlink(nome);
+    }
+    if (eventos_aberto)
+    {
+        f_close(&g_eventos_file);
+        nome_companheiro(nome, "_eventos.csv");
+        f_unlink(nome);
+    }
+    // Nada ficou aberto: a próxima montagem não tem o que recuperar
+    f_unlink(PARTES_ABERTAS);
+    capturando_dados = false;
+    precisa_atualizar_display = true;
+}
+
+// Nome-base e primeira parte de uma sessão nova. Um nome que já existe (catálogo
+// apagado, duas sessões no mesmo segundo) passa para o número seguinte.
+static FRESULT abrir_sessao()
+{
+    datetime_t t;
+    bool rtc = data_hora(&t);
+    g_sessao = ultima_sessao();
+    g_proxima_falhou = false;
+    for (int tentativa = 0; tentativa < 100; tentativa++)
+    {
+        g_sessao++;
+        if (rtc && tentativa == 0)
+            snprintf(g_base_sessao, sizeof g_base_sessao, "%04d%02d%02d_%02d%02d%02d", t.year, t.month, t.day,
+                     t.hour, t.min, t.sec);
+        else
+            snprintf(g_base_sessao, sizeof g_base_sessao, "s%04lu", g_sessao);
+        FRESULT fr = abrir_parte(g_parte, 0);
+        if (fr != FR_EXIST)
+            return fr;
+    }
+    return FR_EXIST;
+}
+
+// Colunas e metadados da sessão no CSV: os scripts de análise usam estes fatores em vez de valores fixos
+static void gravar_cabecalho_csv(uint32_t odr, uint16_t escala_gyro_x10)
+{
+    gravar_cabecalho(&g_grav_log, LOG_BRUTO_CONTINUO);
+    // Logo no primeiro setor: a recuperação confere por ela que a reserva é desta parte
+    gravador_printf(&g_grav_log, "# sessao=%lu;parte=%lu;inicio=%s\n", g_sessao, g_parte->numero, g_parte->inicio);
+    gravador_printf(&g_grav_log, "# odr_hz=%lu;dlpf=%d;accel_lsb_g=%u;gyro_lsb_dps=%u.%u;janela_amostras=%lu;"
+                          "filtro_decimacao=%d;fator_decimacao=%lu;sensores=%u;sync=%s;sync_limite=%lu\n",
+             odr, (int)g_mpu->dlpf,
+             mpu6050_escala_accel(g_mpu), escala_gyro_x10 / 10, escala_gyro_x10 % 10,
+             JANELA_AMOSTRAS ? (uint32_t)JANELA_AMOSTRAS : odr,
+             (int)g_config_aquisicao.decimacao.tipo, g_config_aquisicao.decimacao.fator, g_num_sensores,
+             grav_nome_sync(g_politica_sync.modo), g_politica_sync.limite);
+    // Uma linha por sensor: o ID das linhas de dados é a posição nesta lista
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+        gravador_printf(&g_grav_log, "# sensor=%u;i2c=%d;endereco=%u;calibracao_gyro=%d\n", i,
+                 i2c_get_index(g_sensores[i]->i2c), g_sensores[i]->addr, g_calibracao_valida[i]);
+}
+
+// Cabeçalho binário da sessão, num setor próprio; o escritor começa o primeiro bloco
+static void gravar_cabecalho_binario(uint32_t odr)
+{
+    lb_cabecalho_t cab = {.tipo = LOG_BRUTO_CONTINUO ? LB_AMOSTRAS : LB_JANELAS,
+                          .estatisticas = ESTATISTICAS_LOG,
+                          .orientacao = ORIENTACAO,
+                          .num_sensores = g_num_sensores,
+                          .dlpf = (uint8_t)g_mpu->dlpf,
+                          .filtro_decimacao = (uint8_t)g_config_aquisicao.decimacao.tipo,
+                          .escala_accel = mpu6050_escala_accel(g_mpu),
+                          .escala_gyro_x10 = mpu6050_escala_gyro_x10(g_mpu),
+                          .odr_hz = odr,
+                          .janela_amostras = JANELA_AMOSTRAS ? (uint32_t)JANELA_AMOSTRAS : odr,
+                          .fator_decimacao = g_config_aquisicao.decimacao.fator,
+                          .comprimido = LOG_COMPRIMIDO && LOG_BRUTO_CONTINUO,
+                          .inicio_us = time_us_64(),
+                          .sessao = g_sessao,
+                          .parte = (uint16_t)g_parte->numero};
+    datetime_t t;
+    if (rtc_get_datetime(&t))
+    {
+        cab.ano = (uint16_t)t.year;
+        cab.mes = (uint8_t)t.month;
+        cab.dia = (uint8_t)t.day;
+        cab.hora = (uint8_t)t.hour;
+        cab.minuto = (uint8_t)t.min;
+        cab.segundo = (uint8_t)t.sec;
+    }
+    for (uint8_t i = 0; i < g_num_sensores && i < LB_MAX_SENSORES; i++)
+    {
+        cab.sensores[i].i2c = (uint8_t)i2c_get_index(g_sensores[i]->i2c);
+        cab.sensores[i].endereco_i2c = g_sensores[i]->addr;
+        cab.sensores[i].calibracao_gyro = g_calibracao_valida[i];
     }
 
-    return true; // Retornar true mantém o timer ativo
+    // Cada parte é um arquivo novo: o cabeçalho ocupa o primeiro setor
+    uint8_t *bloco = g_log_binario.bloco;
+    lb_montar_cabecalho(&cab, bloco);
+    gravador_escrever(&g_grav_log, bloco, LB_BLOCO);
+    lb_iniciar(&g_log_binario, &cab);
+}
+
+// A parte atual passa a receber os registros, a partir do próprio cabeçalho: cada
+// parte pode ser lida sozinha, sem as anteriores
+static void ativar_parte(uint32_t odr, uint16_t escala_gyro_x10)
+{
+    gravador_iniciar(&g_grav_log, &g_parte->arquivo);
+    if (PREALOCAR_MB)
+        gravador_usar_destino(&g_grav_log, &g_parte->destino);
+    datetime_t t;
+    if (data_hora(&t))
+        snprintf(g_parte->inicio, sizeof g_parte->inicio, "%04d-%02d-%02d %02d:%02d:%02d", t.year, t.month, t.day,
+                 t.hour, t.min, t.sec);
+    else
+        snprintf(g_parte->inicio, sizeof g_parte->inicio, "-");
+    g_parte->inicio_ms = to_ms_since_boot(get_absolute_time());
+    g_parte->registros_inicio = g_registros_gravados;
+    if (LOG_BINARIO)
+        gravar_cabecalho_binario(odr);
+    else
+        gravar_cabecalho_csv(odr, escala_gyro_x10);
+}
+
+// A parte atual já passou do limite de tamanho ou de tempo, ou a reserva está no fim
+static bool rotacao_vencida()
+{
+    if (ROTACAO_MB && g_grav_log.bytes >= ((uint64_t)ROTACAO_MB << 20))
+        return true;
+    if (ROTACAO_MIN && to_ms_since_boot(get_absolute_time()) - g_parte->inicio_ms >= ROTACAO_MIN * 60000u)
+        return true;
+    return PREALOCAR_MB &&
+           prealocado_livre(&g_parte->prealocado) < g_folga_reserva + gravador_bytes_na_ram(&g_grav_log);
+}
+
+// Troca de parte: fecha a atual e passa para a que já foi criada. Só se ela ainda
+// não existir (falhou antes da hora) a criação fica no caminho. Retorna false se não
+// houver como criar a parte seguinte; a atual continua aberta.
+static bool rotacionar()
+{
+    if (!g_proxima->aberta)
+    {
+        FRESULT fr = abrir_parte(g_proxima, g_parte->numero + 1);
+        if (fr != FR_OK)
+        {
+            printf("ERRO: Nao foi possivel criar '%s' (%s)\n", g_proxima->nome, FRESULT_str(fr));
+            return false;
+        }
+    }
+    if (LOG_BINARIO && g_log_binario.registros && !gravar_bloco_binario())
+        g_falhas_gravacao++;
+    montar_linha_catalogo();
+    fechar_arquivo(&g_grav_log);
+    g_catalogo_pendente = true;
+
+    parte_log_t *fechada = g_parte;
+    g_parte = g_proxima;
+    g_proxima = fechada;
+    g_proxima_falhou = false;
+    ativar_parte(mpu6050_taxa_amostragem_hz(g_mpu), mpu6050_escala_gyro_x10(g_mpu));
+    printf(">>> Parte %lu da sessao: %s\n", g_parte->numero, g_parte->nome);
+    return true;
+}
+
+// O resto da rotação, fora da troca: a linha do catálogo da parte fechada e a
+// criação da parte seguinte, um passo por chamada
+static void preparar_rotacao()
+{
+    if (g_catalogo_pendente)
+    {
+        g_catalogo_pendente = false;
+        if (!anotar_catalogo(g_linha_catalogo))
+            printf("ERRO: Nao foi possivel atualizar %s\n", CATALOGO);
+    }
+    else if (!g_proxima->aberta && !g_proxima_falhou)
+    {
+        FRESULT fr = abrir_parte(g_proxima, g_parte->numero + 1);
+        if (fr != FR_OK)
+        {
+            // Tenta de novo só na hora da troca
+            g_proxima_falhou = true;
+            printf("ERRO: Nao foi possivel criar '%s' antes da hora (%s)\n", g_proxima->nome, FRESULT_str(fr));
+        }
+        else
+            anotar_abertas();
+    }
 }
 
 // Função para INICIAR o processo de log
@@ -462,29 +1624,106 @@ void iniciar_log_robusto()
         return;
     }
 
-    // Abre o arquivo para adicionar dados no final
-    FRESULT fr = f_open(&g_log_file, filename, FA_OPEN_APPEND | FA_WRITE);
+    // Sessão nova: a primeira parte do arquivo principal é sempre um arquivo novo
+    FRESULT fr = abrir_sessao();
     if (fr != FR_OK)
     {
-        printf("ERRO: Nao foi possivel abrir o arquivo '%s' (%s)\n", filename, FRESULT_str(fr));
+        printf("ERRO: Nao foi possivel criar o arquivo '%s' (%s)\n", g_parte->nome, FRESULT_str(fr));
         entrar_em_erro_fatal(); // << CHAMA A FUNÇÃO DE ERRO AQUI
         // O código NUNCA passará desta linha
     }
+    if (PREALOCAR_MB)
+    {
+        // Folga para trocar de parte a tempo: o lote corrente, a fila inteira e o trailer
+        aq_estado_fila_t f;
+        aquisicao_obter_estado_fila(&f);
+        g_folga_reserva = (REGISTROS_POR_LOTE + f.capacidade + 2) * GRAV_LINHA_MAX + LB_BLOCO;
+    }
+    g_falhas_gravacao = 0;
+    g_registros_gravados = 0;
+    g_catalogo_pendente = false;
+
+    // Metadados da sessão; o cabeçalho abre cada parte
+    uint16_t escala_gyro_x10 = mpu6050_escala_gyro_x10(g_mpu);
+    uint32_t odr = mpu6050_taxa_amostragem_hz(g_mpu);
+    ativar_parte(odr, escala_gyro_x10);
+
+    // O espectro vai para um arquivo ao lado, com as próprias colunas
+    if (ESPECTRO_PONTOS)
+    {
+        if (!abrir_arquivo_companheiro(&g_espectro_file, "_fft.csv"))
+        {
+            descartar_sessao(false, false);
+            return;
+        }
+        gravador_iniciar(&g_grav_espectro, &g_espectro_file);
+        gravar_cabecalho_espectro();
+        gravador_printf(&g_grav_espectro, "# odr_hz=%lu;accel_lsb_g=%u;fft_pontos=%u\n",
+                 mpu6050_taxa_amostragem_hz(g_mpu), mpu6050_escala_accel(g_mpu), ESPECTRO_PONTOS);
+    }
 
-    // Se o arquivo estiver vazio, escreve o cabeçalho
-    if (f_tell(&g_log_file) == 0)
+    // As amostras de cada evento, em taxa plena, também vão para um arquivo ao lado
+    if (CAPTURA_POR_EVENTO)
     {
-        f_printf(&g_log_file, "timestamp_us;ax_avg;ay_avg;az_avg;gx_avg;gy_avg;gz_avg;temp_avg\n");
+        if (!abrir_arquivo_companheiro(&g_eventos_file, "_eventos.csv"))
+        {
+            descartar_sessao(ESPECTRO_PONTOS, false);
+            return;
+        }
+        const gat_config_t *gat = &g_config_aquisicao.gatilho;
+        gravador_iniciar(&g_grav_eventos, &g_eventos_file);
+        gravar_cabecalho(&g_grav_eventos, true);
+        gravador_printf(&g_grav_eventos, "# odr_hz=%lu;accel_lsb_g=%u;gyro_lsb_dps=%u.%u;gatilho=%d;canal=%d;limiar=%ld;"
+                                  "pre_amostras=%lu;pos_amostras=%lu\n",
+                 odr, mpu6050_escala_accel(g_mpu), escala_gyro_x10 / 10, escala_gyro_x10 % 10,
+                 (int)gat->tipo, gat->canal, gat->limiar, gat->pre_amostras, gat->pos_amostras);
+    }
+
+    // Daqui em diante, um desligamento no meio deixa a lista para a próxima montagem
+    g_companheiros_abertos = true;
+    anotar_abertas();
+
+    g_saltos_sequencia = 0;
+    g_ultimo_sync_ms = to_ms_since_boot(get_absolute_time());
+    g_registros_sem_sync = 0;
+    g_maior_escrita_us = 0;
+    g_sequencia_esperada = 0;
+
+    // A tela de captura é desenhada antes de a aquisição ocupar o barramento do display
+    if (g_display_compartilhado)
+    {
+        acender_led_rgb(255, 0, 0);
+        ssd1306_fill(&ssd, false);
+        ssd1306_draw_string(&ssd, "Capturando...", 16, 16);
+        ssd1306_draw_string(&ssd, "Display pausado", 4, 40);
+        ssd1306_send_data(&ssd);
+    }
+
+    // Inicia a amostragem no ODR dos sensores; os registros chegam ao loop principal pela fila
+    if (!aquisicao_iniciar(g_sensores, g_num_sensores, &g_config_aquisicao))
+    {
+        printf("ERRO: Nao foi possivel iniciar a aquisicao do MPU6050\n");
+        if (g_modo_aquisicao == AQ_MODO_DRDY && g_mpu->int_gpio == MPU6050_SEM_INT)
+            printf("O modo data-ready precisa do pino INT do primeiro sensor (0x%02x no i2c%d)\n", g_mpu->addr,
+                   i2c_get_index(g_mpu->i2c));
+        descartar_sessao(ESPECTRO_PONTOS, CAPTURA_POR_EVENTO);
+        return;
     }
 
     g_log_ativo = true;
     capturando_dados = true;
 
-    // Inicia um timer que chamará a 'timer_callback' a cada 10 milissegundos
-    // 10ms * 100 amostras = 1000ms = 1 segundo por linha de dados gravada.
-    add_repeating_timer_ms(-10, timer_callback, NULL, &g_repeating_timer);
-
-    printf(">>> LOG INICIADO. Coletando médias de 100 amostras por segundo...\n");
+    printf(">>> LOG INICIADO. Coletando %s de %lu amostras por segundo (%s)...\n",
+           LOG_BRUTO_CONTINUO ? "todas as" : "estatísticas", mpu6050_taxa_amostragem_hz(g_mpu),
+           nomes_modo_aquisicao[g_modo_aquisicao]);
+    printf(">>> Sessao %lu: %s", g_sessao, g_parte->nome);
+    if (PREALOCAR_MB)
+        printf(" (%u MiB contiguos reservados por parte)", PREALOCAR_MB);
+    printf("\n");
+    if (g_num_sensores > 1)
+        printf(">>> %u sensores amostrados juntos; a coluna 'sensor' identifica cada linha\n", g_num_sensores);
+    if (CAPTURA_POR_EVENTO)
+        printf(">>> Gatilho armado: eventos em taxa plena no arquivo _eventos.csv (botao A dispara)\n");
 }
 
 // Função para PARAR o processo de log
@@ -496,17 +1735,48 @@ void parar_log_robusto()
         return;
     }
 
-    // Sinaliza para a interrupção do timer parar
     g_log_ativo = false;
     capturando_dados = false;
 
-    // Cancela o timer explicitamente
-    cancel_repeating_timer(&g_repeating_timer);
+    // Para a amostragem e grava o que ainda estava na fila antes de fechar o arquivo
+    aquisicao_parar();
+    gravar_registros_pendentes(UINT32_MAX);
 
-    // Fecha o arquivo, salvando todos os dados restantes.
-    f_close(&g_log_file);
+    // Trailer da sessão: o balanço de perdas fica junto dos dados que ele descreve.
+    // No binário, o último bloco fecha o arquivo mesmo incompleto; o balanço fica no terminal.
+    aq_contadores_t c;
+    aquisicao_obter_contadores(&c);
+    if (LOG_BINARIO)
+    {
+        if (g_log_binario.registros && !gravar_bloco_binario())
+            g_falhas_gravacao++;
+    }
+    else
+        gravador_printf(&g_grav_log, "# adquiridas=%lu;agregadas=%lu;gerados=%lu;gravados=%lu;descartados=%lu;"
+                          "leituras_perdidas=%lu;ressinc_fifo=%lu;lacunas=%lu;amostras_faltando=%lu;"
+                          "falhas_gravacao=%lu;espectros_perdidos=%lu;eventos=%lu;amostras_evento_perdidas=%lu;"
+                          "trocas_taxa=%lu;repouso_ms=%lu\n",
+             c.amostras_adquiridas, c.amostras_agregadas, c.registros_gerados, g_registros_gravados,
+             c.registros_descartados, c.leituras_perdidas, c.ressincronizacoes_fifo, c.lacunas,
+             c.amostras_faltando, g_falhas_gravacao, c.espectros_perdidos, c.eventos,
+             c.amostras_evento_perdidas, c.trocas_taxa, c.tempo_repouso_ms);
+
+    // Fecha os arquivos, salvando todos os dados restantes. A última parte entra no
+    // catálogo e a que tinha sido criada para a próxima troca é removida.
+    bool catalogo_ok = !g_catalogo_pendente || anotar_catalogo(g_linha_catalogo);
+    g_catalogo_pendente = false;
+    montar_linha_catalogo();
+    fechar_arquivos_log();
+    descartar_parte(g_proxima);
+    if (!anotar_catalogo(g_linha_catalogo) || !catalogo_ok)
+        printf("ERRO: Nao foi possivel atualizar %s\n", CATALOGO);
+    f_unlink(PARTES_ABERTAS);
 
     printf(">>> LOG PARADO. Arquivo salvo com segurança.\n");
+    mostrar_contadores();
+    mostrar_estado_fila();
+    if (g_modo_aquisicao != AQ_MODO_FIFO)
+        mostrar_jitter();
 }
 
 // Função para ler o conteúdo de um arquivo e exibir no terminal
@@ -563,7 +1833,11 @@ void gpio_irq_handler(uint gpio, uint32_t events)
     }
     else if (gpio == button_B)
     {
-        reset_usb_boot(0, 0);
+        // Com a política manual, o B durante a captura confirma os dados no cartão
+        if (SYNC_POLITICA == GRAV_SYNC_MANUAL && g_log_ativo)
+            button_B_pressed = true;
+        else
+            reset_usb_boot(0, 0);
     }
 }
 
@@ -573,11 +1847,16 @@ static void run_help()
     printf("Digite 'a' para montar o cartão SD\n");
     printf("Digite 'b' para desmontar o cartão SD\n");
     printf("Digite 'c' para listar arquivos\n");
-    printf("Digite 'd' para mostrar conteúdo do arquivo\n");
+    printf("Digite 'd' para mostrar conteúdo do arquivo da sessão (a parte atual ou a última)\n");
     printf("Digite 'e' para obter espaço livre no cartão SD\n");
-    printf("Digite 'f' para capturar dados do ADC e salvar no arquivo\n");
+    printf("Digite 'f' para confirmar no cartao (f_sync) o que ja foi gravado\n");
     printf("Digite 'g' para formatar o cartão SD\n");
     printf("Digite 'h' para exibir os comandos disponíveis\n");
+    printf("Digite 'i' para mostrar as amostras adquiridas, gravadas e perdidas na sessão\n");
+    printf("Digite 'j' para mostrar o jitter da amostragem e o uso da fila\n");
+    printf("Digite 'k' para medir o custo de CPU da decimação, da FFT, da orientação, do CSV e da compressão do log binário\n");
+    printf("Digite 'n' para mostrar o catálogo de sessões (%s)\n", CATALOGO);
+    printf("Digite 'l' para calibrar o giroscópio (%d s parado) e gravar na flash\n", CAL_COMPLETA_S);
     printf("Digite 's' para iniciar a gravar dados no cartão sd\n");
     printf("Digite 'p' para parar de gravar dados no cartão\n");
     printf("\nEscolha o comando:  ");
@@ -680,11 +1959,39 @@ void atualizar_interface(ssd1306_t *ssd, bool cartao_montado, bool capturando_da
     {
         if (capturando_dados)
         {
-            // Estado: Capturando (VERMELHO)
+            // Estado: Capturando (VERMELHO). Na captura por evento, o título conta os disparos.
             acender_led_rgb(255, 0, 0);
-            ssd1306_draw_string(ssd, "Capturando...", 16, 16);
-            ssd1306_draw_string(ssd, "Aperte 'A'", 24, 32);
-            ssd1306_draw_string(ssd, "para Parar", 24, 48);
+            char titulo[20] = "Capturando...";
+            if (TAXA_ADAPTATIVA && aquisicao_em_repouso())
+                snprintf(titulo, sizeof titulo, "Repouso");
+            else if (CAPTURA_POR_EVENTO)
+            {
+                aq_contadores_t c;
+                aquisicao_obter_contadores(&c);
+                snprintf(titulo, sizeof titulo, "Eventos: %lu", c.eventos);
+            }
+            ori_saida_t o;
+            if (ORIENTACAO && aquisicao_obter_orientacao(&o))
+            {
+                // Ângulos em graus com uma casa: centésimos / 100, truncados para décimos
+                static const char *const rotulos[3] = {"Roll", "Pitch", "Yaw"};
+                char linha[20];
+                ssd1306_draw_string(ssd, titulo, 16, 0);
+                for (int i = 0; i < 3; i++)
+                {
+                    int decimos = o.rpy_cdeg[i] / 10;
+                    snprintf(linha, sizeof linha, "%-5s %s%d.%d", rotulos[i], decimos < 0 ? "-" : "",
+                             abs(decimos) / 10, abs(decimos) % 10);
+                    ssd1306_draw_string(ssd, linha, 8, 16 + 12 * i);
+                }
+                ssd1306_draw_string(ssd, CAPTURA_POR_EVENTO ? "'A' dispara" : "'A' para Parar", 8, 56);
+            }
+            else
+            {
+                ssd1306_draw_string(ssd, titulo, 16, 16);
+                ssd1306_draw_string(ssd, CAPTURA_POR_EVENTO ? "'A' dispara" : "Aperte 'A'", 24, 32);
+                ssd1306_draw_string(ssd, CAPTURA_POR_EVENTO ? "SW para Parar" : "para Parar", 24, 48);
+            }
         }
         else
         {
@@ -745,8 +2052,36 @@ int main()
     gpio_pull_up(I2C_SCL);
     bi_decl(bi_2pins_with_func(I2C_SDA, I2C_SCL, GPIO_FUNC_I2C));
 
+    // Lança o core 1 de aquisição (se habilitado) antes de qualquer sessão de log
+    aquisicao_init();
+
+    // Sensores da tabela (hw_config.c): os que não respondem ficam fora das sessões
     printf("Antes do reset MPU...\n");
-    mpu6050_reset();
+    for (size_t i = 0; i < mpu_get_num() && g_num_sensores < AQ_MAX_SENSORES; i++)
+    {
+        mpu6050_t *mpu = mpu_get_by_num(i);
+        configurar_sensor(mpu);
+        imu_t *imu = &g_imus[g_num_sensores];
+        mpu6050_como_imu(mpu, imu);
+        if (!imu_reset(imu))
+        {
+            printf("ERRO: MPU6050 nao respondeu no endereco 0x%02x do i2c%d\n", mpu->addr, i2c_get_index(mpu->i2c));
+            continue;
+        }
+        g_sensores[g_num_sensores++] = mpu;
+        if (mpu->i2c == I2C_PORT_DISP)
+            g_display_compartilhado = true;
+    }
+    g_mpu = g_num_sensores ? g_sensores[0] : mpu_get_by_num(0);
+
+    if (g_num_sensores)
+    {
+        ssd1306_fill(&ssd, false);
+        ssd1306_draw_string(&ssd, "Calibrando gyro", 4, 24);
+        ssd1306_draw_string(&ssd, "Nao mova", 32, 40);
+        ssd1306_send_data(&ssd);
+        iniciar_calibracao();
+    }
 
     printf("FatFS SPI example\n");
     printf("\033[2J\033[H"); // Limpa tela
@@ -759,24 +2094,36 @@ int main()
     ssd1306_fill(&ssd, false);
     ssd1306_send_data(&ssd);
 
+    uint32_t ultimo_quadro_ms = 0;
+
     // Loop principal
     while (true)
     {
-        // Tarefa 1: Verificar se a interrupção do timer sinalizou que há dados para gravar
-        if (g_dados_prontos_para_gravar)
+        // Tarefa 1: Gravar o que a aquisição deixou na fila. Se o loop atrasou
+        // (ls, cat, f_sync lento), os registros esperam na fila em vez de se perder.
+        uint32_t lote = g_log_ativo ? gravar_registros_pendentes(REGISTROS_POR_LOTE) : 0;
+        if (lote)
         {
-            g_dados_prontos_para_gravar = false;
-            // A escrita no cartão acontece aqui
-            f_printf(&g_log_file, "%llu;%d;%d;%d;%d;%d;%d;%d\n",
-                     time_us_64(),
-                     g_dados_medios[0], g_dados_medios[1], g_dados_medios[2],
-                     g_dados_medios[3], g_dados_medios[4], g_dados_medios[5],
-                     g_dados_medios[6]);
-            f_sync(&g_log_file); // Força a escrita física no cartão (importante!)
-
             precisa_atualizar_display = true; // <<< SINALIZA PARA A INTERFACE VOLTAR AO NORMAL
         }
 
+        // Rotação do arquivo principal: a troca de parte quando vence um limite; o
+        // catálogo e a criação da parte seguinte só quando a fila foi esvaziada
+        if (ROTACAO && g_log_ativo)
+        {
+            if (rotacao_vencida())
+            {
+                if (!rotacionar())
+                {
+                    printf(">>> Sem espaco para a proxima parte.\n");
+                    parar_log_robusto();
+                }
+                precisa_atualizar_display = true;
+            }
+            else if (lote < REGISTROS_POR_LOTE)
+                preparar_rotacao();
+        }
+
         if (SW_button_pressed)
         {
             SW_button_pressed = false;        // 1. "Consome" o evento para não repetir a ação
@@ -800,12 +2147,23 @@ int main()
             }
         }
 
+        if (button_B_pressed)
+        {
+            button_B_pressed = false;
+            sincronizar_agora();
+        }
+
         if (button_A_pressed)
         {
             button_A_pressed = false; // 1. "Consome" o evento
 
+            // Com o gatilho armado, o botão A só dispara um evento manual
+            if (cartao_montado && CAPTURA_POR_EVENTO && capturando_dados)
+            {
+                aquisicao_disparar();
+            }
             // Ação só ocorre se o cartão estiver montado
-            if (cartao_montado)
+            else if (cartao_montado)
             {
                 capturando_dados = !capturando_dados; // 2. Inverte o estado da captura
                 precisa_atualizar_display = true;     // 3. Sinaliza que a tela precisa mudar
@@ -821,7 +2179,15 @@ int main()
             }
         }
 
-        if (precisa_atualizar_display)
+        // Ângulos e eventos no display a ~5 Hz durante a captura (o envio do quadro leva ~25 ms)
+        uint32_t agora_ms = to_ms_since_boot(get_absolute_time());
+        if ((ORIENTACAO || CAPTURA_POR_EVENTO) && capturando_dados && agora_ms - ultimo_quadro_ms >= 200)
+        {
+            ultimo_quadro_ms = agora_ms;
+            precisa_atualizar_display = true;
+        }
+
+        if (precisa_atualizar_display && !(g_display_compartilhado && g_log_ativo))
         {
             atualizar_interface(&ssd, cartao_montado, capturando_dados);
             precisa_atualizar_display = false;
@@ -846,18 +2212,43 @@ int main()
                 run_ls();
                 break;
             case 'd':
-                read_file(filename);
+                read_file(g_parte->nome[0] ? g_parte->nome : CATALOGO);
                 precisa_atualizar_display = true;
                 break;
             case 'e':
                 run_getfree();
                 break;
+            case 'n':
+                read_file(CATALOGO);
+                precisa_atualizar_display = true;
+                break;
+            case 'f':
+                sincronizar_agora();
+                break;
             case 'g':
                 run_format();
                 break;
             case 'h':
                 run_help();
                 break;
+            case 'i':
+                mostrar_contadores();
+                break;
+            case 'j':
+                mostrar_jitter();
+                mostrar_estado_fila();
+                break;
+            case 'k':
+                benchmark_decimacao();
+                benchmark_espectro();
+                benchmark_orientacao();
+                benchmark_formatacao();
+                benchmark_compressao();
+                break;
+            case 'l':
+                run_calibrar();
+                precisa_atualizar_display = true;
+                break;
             case 's':
                 iniciar_log_robusto();
                 break; // START
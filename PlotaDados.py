@@ -4,6 +4,7 @@ import matplotlib.dates as mdates
 from matplotlib.ticker import AutoMinorLocator
 from datetime import datetime, timedelta
 import os
+import re
 
 # --- Configurações ---
 plt.style.use("seaborn-v0_8-whitegrid")
@@ -11,9 +12,175 @@ plt.style.use("seaborn-v0_8-whitegrid")
 # Nome do arquivo CSV
 arquivo_csv = "dados_pico.csv"
 
+# Com vários sensores no log (coluna "sensor"), os gráficos mostram este
+SENSOR_PLOTADO = 0
+
+# Fatores usados quando o arquivo não traz a linha de metadados (logs antigos, ±2 g / ±250 °/s)
+ACCEL_FACTOR_PADRAO = 16384.0
+GYRO_FACTOR_PADRAO = 131.0
+
+
+def valor_meta(v):
+    """Número quando o campo é numérico; texto nos demais (ex.: sync=tempo)."""
+    try:
+        return float(v)
+    except ValueError:
+        return v
+
+
+def carregar_csv(caminho):
+    """Lê o log do Pico, aplicando a cada linha os fatores de escala da sessão em que foi gravada.
+
+    Linhas iniciadas por '#' são metadados no formato chave=valor separados por ';'
+    (números, ou texto como a política de f_sync).
+    Cada sessão começa com o próprio cabeçalho; logs de médias (ax_avg, ...) e de
+    amostras brutas (ax, ...) viram as mesmas colunas. Os trailers de fim de sessão
+    (contadores de perdas) ficam em df.attrs["sessoes"], os marcadores de disparo
+    do arquivo de eventos em df.attrs["eventos"], a tabela de sensores (barramento
+    e endereço de cada ID) em df.attrs["sensores"], as trocas da taxa adaptativa
+    (instante, ODR em mHz e repouso) em df.attrs["taxas"] e a identificação de cada
+    parte (sessão, parte e início pelo RTC, ou "-") em df.attrs["partes"].
+    """
+    meta = {"accel_lsb_g": ACCEL_FACTOR_PADRAO, "gyro_lsb_dps": GYRO_FACTOR_PADRAO}
+    colunas = None
+    linhas = []
+    sessoes = []
+    eventos = []
+    sensores = {}
+    taxas = []
+    partes = []
+    with open(caminho, encoding="utf-8") as f:
+        for linha in f:
+            linha = linha.strip()
+            if not linha:
+                continue
+            if linha.startswith("#"):
+                campos = dict(
+                    c.strip().split("=", 1) for c in linha[1:].split(";") if "=" in c
+                )
+                if "adquiridas" in campos:
+                    sessoes.append({k: int(v) for k, v in campos.items()})
+                elif "t_gatilho_us" in campos:
+                    eventos.append({k: int(v) for k, v in campos.items()})
+                elif "t_taxa_us" in campos:
+                    taxas.append({k: int(v) for k, v in campos.items()})
+                elif "sessao" in campos:
+                    # O início é texto (data e hora do RTC, ou "-" sem o RTC acertado)
+                    partes.append(
+                        {"sessao": int(campos["sessao"]), "parte": int(campos["parte"]), "inicio": campos["inicio"]}
+                    )
+                elif "endereco" in campos:
+                    sensores[int(campos["sensor"])] = {k: int(v) for k, v in campos.items()}
+                else:
+                    meta.update({k: valor_meta(v) for k, v in campos.items()})
+                continue
+            if not linha.lstrip("-")[:1].isdigit():
+                colunas = [c[: -len("_avg")] if c.endswith("_avg") else c for c in linha.split(";")]
+                continue
+            registro = dict(zip(colunas, (int(v) for v in linha.split(";"))))
+            registro["accel_lsb_g"] = meta["accel_lsb_g"]
+            registro["gyro_lsb_dps"] = meta["gyro_lsb_dps"]
+            linhas.append(registro)
+    df = pd.DataFrame(linhas)
+    df.attrs["sessoes"] = sessoes
+    df.attrs["eventos"] = eventos
+    df.attrs["meta"] = meta
+    df.attrs["sensores"] = sensores
+    df.attrs["taxas"] = taxas
+    df.attrs["partes"] = partes
+    # Médias trazem o instante da primeira e da última amostra da janela (capturados
+    # na aquisição); o ponto de cada média fica no centro da janela
+    if "t_inicio_us" in df:
+        centro = (df["t_inicio_us"] + df["t_fim_us"]) // 2
+        df["timestamp_us"] = centro if "timestamp_us" not in df else df["timestamp_us"].fillna(centro)
+    return df
+
+
+def resumir_tempos(df):
+    """Intervalo entre registros consecutivos, a partir dos timestamps de captura."""
+    intervalos = df["timestamp_us"].diff()
+    intervalos = intervalos[intervalos > 0]  # Ignora a virada entre sessões
+    if not intervalos.empty:
+        print(
+            f"Intervalo entre registros: média {intervalos.mean():.1f} us, "
+            f"mín {intervalos.min():.0f} us, máx {intervalos.max():.0f} us"
+        )
+    if "t_inicio_us" in df:
+        janela = (df["t_fim_us"] - df["t_inicio_us"]).dropna()
+        print(f"Duração das janelas de média: {janela.min():.0f} a {janela.max():.0f} us")
+
+
+def plotar_envelope(eixos, canais, fator):
+    """Faixa entre o mínimo e o máximo de cada janela, quando o log traz essas estatísticas."""
+    for eixo, canal in zip(eixos, canais):
+        if f"{canal}_min" in df and f"{canal}_max" in df:
+            eixo.fill_between(
+                df["tempo_real"],
+                df[f"{canal}_min"] / df[fator],
+                df[f"{canal}_max"] / df[fator],
+                color="gray",
+                alpha=0.3,
+                label="Mín/máx da janela",
+            )
+
+
+def resumir_perdas(df):
+    """Mostra o balanço de cada sessão gravado no trailer e os saltos de sequência no arquivo."""
+    for p in df.attrs.get("partes", []):
+        inicio = f", início {p['inicio']}" if p["inicio"] != "-" else ""
+        print(f"Sessão {p['sessao']}, parte {p['parte']}{inicio}")
+    for i, s in enumerate(df.attrs.get("sessoes", []), 1):
+        print(
+            f"Sessão {i}: {s['adquiridas']} amostras adquiridas, {s['gravados']} registros gravados, "
+            f"{s['descartados']} descartados na fila, {s['leituras_perdidas']} leituras I2C perdidas, "
+            f"{s['lacunas']} lacunas (~{s['amostras_faltando']} amostras)"
+        )
+    taxas = df.attrs.get("taxas", [])
+    if taxas:
+        # Cada troca fecha a janela em andamento: nenhuma linha mistura duas taxas.
+        # Para reamostrar, use os timestamps de cada linha, não um período fixo.
+        repouso_s = sum(s.get("repouso_ms", 0) for s in df.attrs.get("sessoes", [])) / 1000
+        print(f"Taxa adaptativa: {len(taxas)} trocas de taxa, {repouso_s:.0f} s em repouso")
+    if "seq" in df:
+        # A sequência recomeça em 0 a cada sessão: só saltos para frente são perdas
+        saltos = df["seq"].diff()
+        faltando = int((saltos[saltos > 1] - 1).sum())
+        if faltando:
+            print(f"AVISO: {faltando} registros faltando pela sequência")
+
+
+def arquivo_companheiro(arquivo, sufixo):
+    """Arquivo de eventos ou de espectro da sessão de 'arquivo'.
+
+    Eles são um por sessão, sem o número da parte (s0007_00.csv -> s0007_eventos.csv).
+    Logs de antes das partes têm o sufixo logo depois do nome (dados_pico_eventos.csv).
+    """
+    base = os.path.splitext(arquivo)[0]
+    antigo = base + sufixo
+    if os.path.exists(antigo):
+        return antigo
+    return re.sub(r"_\d{2,}$", "", base) + sufixo
+
+
+def selecionar_sensor(df, sensor):
+    """Linhas de um sensor só; logs antigos (sem a coluna) voltam inteiros."""
+    if "sensor" not in df:
+        return df
+    ids = sorted(df["sensor"].unique())
+    if len(ids) > 1:
+        contagem = ", ".join(f"{i}: {(df['sensor'] == i).sum()}" for i in ids)
+        print(f"Sensores no log (registros): {contagem}; mostrando o sensor {sensor}")
+    selecionado = df[df["sensor"] == sensor].reset_index(drop=True)
+    selecionado.attrs = df.attrs
+    return selecionado
+
+
 # --- Leitura e Preparação dos Dados ---
 try:
-    df = pd.read_csv(arquivo_csv, sep=";")
+    df = carregar_csv(arquivo_csv)
+    # A sequência é uma só para todos os sensores: os saltos são contados antes da seleção
+    resumir_perdas(df)
+    df = selecionar_sensor(df, SENSOR_PLOTADO)
     # Lógica de tempo
     t_modificacao = os.path.getmtime(arquivo_csv)
     fim_da_coleta = datetime.fromtimestamp(t_modificacao)
@@ -26,17 +193,16 @@ try:
         for ts in df["timestamp_us"]
     ]
 
-    # Conversão para unidades físicas
-    ACCEL_FACTOR = 16384.0
-    GYRO_FACTOR = 131.0
-    df["ax_g"] = df["ax_avg"] / ACCEL_FACTOR
-    df["ay_g"] = df["ay_avg"] / ACCEL_FACTOR
-    df["az_g"] = df["az_avg"] / ACCEL_FACTOR
-    df["gx_dps"] = df["gx_avg"] / GYRO_FACTOR
-    df["gy_dps"] = df["gy_avg"] / GYRO_FACTOR
-    df["gz_dps"] = df["gz_avg"] / GYRO_FACTOR
+    # Conversão para unidades físicas com os fatores gravados pelo firmware
+    df["ax_g"] = df["ax"] / df["accel_lsb_g"]
+    df["ay_g"] = df["ay"] / df["accel_lsb_g"]
+    df["az_g"] = df["az"] / df["accel_lsb_g"]
+    df["gx_dps"] = df["gx"] / df["gyro_lsb_dps"]
+    df["gy_dps"] = df["gy"] / df["gyro_lsb_dps"]
+    df["gz_dps"] = df["gz"] / df["gyro_lsb_dps"]
 
     print("Dados carregados e convertidos com sucesso!")
+    resumir_tempos(df)
 
 except FileNotFoundError:
     print(f"ERRO: Arquivo '{arquivo_csv}' não encontrado na pasta.")
@@ -74,6 +240,7 @@ eixos_acel[2].plot(
     df["tempo_real"], df["az_g"], color="b", label=label_az, linewidth=1.5
 )
 
+plotar_envelope(eixos_acel, ("ax", "ay", "az"), "accel_lsb_g")
 
 for ax in eixos_acel:
     ax.set_ylabel("Aceleração (g)")
@@ -121,6 +288,7 @@ eixos_giro[2].plot(
     df["tempo_real"], df["gz_dps"], color="b", label=label_gz, linewidth=1.5
 )
 
+plotar_envelope(eixos_giro, ("gx", "gy", "gz"), "gyro_lsb_dps")
 
 for ax in eixos_giro:
     ax.set_ylabel("Velocidade Angular (°/s)")
@@ -139,4 +307,78 @@ plt.tight_layout(rect=[0, 0.03, 1, 0.95])
 plt.savefig("giroscopio_plot_tempo_real.png")
 print("Gráfico 'giroscopio_plot_tempo_real.png' salvo com sucesso.")
 
+
+# --- Orientação estimada no dispositivo (colunas roll/pitch/yaw, quando habilitadas) ---
+if "roll_cdeg" in df.columns:
+    fig_ori, eixos_ori = plt.subplots(3, 1, figsize=(15, 9), sharex=True)
+    fig_ori.suptitle(f"Orientação (filtro de Mahony) - Coleta de {data_coleta}", fontsize=16)
+    for eixo, coluna, nome, cor in zip(
+        eixos_ori, ("roll_cdeg", "pitch_cdeg", "yaw_cdeg"), ("Roll", "Pitch", "Yaw"), ("r", "g", "b")
+    ):
+        eixo.plot(df["tempo_real"], df[coluna] / 100, color=cor, label=nome, linewidth=1.5)
+        eixo.set_ylabel(f"{nome} (°)")
+        eixo.legend(loc="upper left")
+        eixo.grid(which="major", linestyle="-", linewidth="0.8")
+    eixos_ori[2].xaxis.set_major_formatter(mdates.DateFormatter("%H:%M:%S"))
+    plt.xlabel("Hora da Coleta (HH:MM:SS)")
+    plt.tight_layout(rect=[0, 0.03, 1, 0.95])
+    plt.savefig("orientacao_plot_tempo_real.png")
+    print("Gráfico 'orientacao_plot_tempo_real.png' salvo com sucesso.")
+
+# --- Eventos em taxa plena (arquivo _eventos.csv, na captura por evento) ---
+arquivo_eventos = arquivo_companheiro(arquivo_csv, "_eventos.csv")
+if os.path.exists(arquivo_eventos):
+    ev = carregar_csv(arquivo_eventos)
+    marcadores = ev.attrs["eventos"]
+    print(f"{len(marcadores)} eventos em '{arquivo_eventos}'")
+    if marcadores and not ev.empty:
+        # Um gráfico por evento (até 6), com o tempo relativo ao disparo
+        mostrados = marcadores[:6]
+        fig_ev, eixos_ev = plt.subplots(len(mostrados), 1, figsize=(15, 3 * len(mostrados)), squeeze=False)
+        fig_ev.suptitle("Eventos: aceleração em taxa plena em volta de cada disparo", fontsize=16)
+        meta_ev = ev.attrs["meta"]
+        periodo_us = 1e6 / meta_ev["odr_hz"]
+        for eixo, marcador in zip(eixos_ev[:, 0], mostrados):
+            # Janela nominal do evento; disparos dentro dela só a estendem
+            t0 = marcador["t_gatilho_us"]
+            ini = t0 - marcador["amostras_pre"] * periodo_us
+            fim = t0 + meta_ev["pos_amostras"] * periodo_us
+            trecho = ev[(ev["timestamp_us"] >= ini) & (ev["timestamp_us"] <= fim)]
+            # Com vários sensores, o gráfico é do que disparou
+            if "sensor" in trecho:
+                trecho = trecho[trecho["sensor"] == marcador.get("sensor", 0)]
+            tempo_ms = (trecho["timestamp_us"] - t0) / 1000
+            for canal, cor in zip(("ax", "ay", "az"), ("r", "g", "b")):
+                eixo.plot(tempo_ms, trecho[canal] / trecho["accel_lsb_g"], color=cor, label=canal, linewidth=1)
+            eixo.axvline(0, color="k", linestyle="--", linewidth=1)
+            eixo.set_ylabel(f"Evento {marcador['evento']}, sensor {marcador.get('sensor', 0)} (g)")
+            eixo.legend(loc="upper left")
+            eixo.grid(which="major", linestyle="-", linewidth="0.8")
+        eixos_ev[-1, 0].set_xlabel("Tempo desde o disparo (ms)")
+        plt.tight_layout(rect=[0, 0.03, 1, 0.95])
+        plt.savefig("eventos_plot.png")
+        print("Gráfico 'eventos_plot.png' salvo com sucesso.")
+
+# --- Espectro de vibração (arquivo _fft.csv gravado ao lado, quando habilitado) ---
+arquivo_fft = arquivo_companheiro(arquivo_csv, "_fft.csv")
+if os.path.exists(arquivo_fft):
+    esp = selecionar_sensor(carregar_csv(arquivo_fft), SENSOR_PLOTADO)
+    t0 = esp["t_inicio_us"].iloc[0]
+    tempo_s = (esp["t_fim_us"] - t0) / 1e6
+    fig3, eixos_esp = plt.subplots(3, 1, figsize=(15, 9), sharex=True)
+    fig3.suptitle("Vibração por banda (RMS de cada bloco da FFT)", fontsize=16)
+    for eixo, canal in zip(eixos_esp, ("ax", "ay", "az")):
+        # Energia em LSB² -> RMS da banda em g
+        for coluna in [c for c in esp.columns if c.startswith(canal + "_") and c.endswith("hz")]:
+            banda = coluna[len(canal) + 1 : -2].replace("_", "-")
+            eixo.plot(tempo_s, esp[coluna] ** 0.5 / esp["accel_lsb_g"], label=f"{banda} Hz")
+        pico = esp[f"{canal}_pico_dhz"] / 10
+        eixo.set_ylabel(f"{canal} (g RMS)")
+        eixo.legend(loc="upper left")
+        print(f"{canal}: frequência de pico mediana {pico.median():.1f} Hz")
+    eixos_esp[2].set_xlabel("Tempo desde o início (s)")
+    plt.tight_layout(rect=[0, 0.03, 1, 0.95])
+    plt.savefig("espectro_bandas.png")
+    print("Gráfico 'espectro_bandas.png' salvo com sucesso.")
+
 plt.show()
@@ -34,14 +34,15 @@ def buscar_dados_com_atalhos():
         print("Mensagens de montagem limpas.")
 
     # Passo 2: Enviar o atalho 'd' para ler o arquivo
-    # No seu código C, o comando 'd' chama a função read_file(filename)
-    # que lê o "adc_data1.csv" hardcoded. Perfeito!
+    # No seu código C, o comando 'd' chama a função read_file() com a parte
+    # atual (ou a última) da sessão; o catálogo sessoes.csv lista as outras.
     print("Enviando atalho 'd' para ler o conteúdo do arquivo...")
     pico.write(b"d")
     time.sleep(1)  # Dar um tempo para o Pico começar a enviar o arquivo
 
     # Passo 3: Ler a resposta (que será o conteúdo do arquivo)
     linhas_recebidas = []
+    cabecalho_visto = False
     print("Aguardando e recebendo dados do arquivo...")
     while True:
         try:
@@ -61,9 +62,10 @@ def buscar_dados_com_atalhos():
         ):
             continue
 
-        # Se a linha contiver o cabeçalho do CSV, começamos a salvar
-        if "timestamp_us;ax;ay;az" in linha:
+        # No primeiro cabeçalho do CSV começamos a salvar (cada sessão repete o cabeçalho)
+        if ";ax" in linha and not cabecalho_visto:
             linhas_recebidas.clear()  # Limpa qualquer lixo que possa ter vindo antes
+            cabecalho_visto = True
 
         print(f"Recebido: {linha}")
         linhas_recebidas.append(linha)
@@ -0,0 +1,248 @@
+// Compressão das amostras do log binário (LOG_COMPRIMIDO): bytes por amostra e custo
+// por amostra para comprimir e descomprimir, comparados com os registros de tamanho
+// fixo. Confere antes que tudo volta igual, inclusive nas cópias provisórias do bloco
+// (lb_fechar_bloco antes de encher, como no f_sync) e com vários sensores.
+//
+//   bench_compressao [amostras] [sensores]     (padrão 1000000 e 1)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_binario.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CICLOS() __rdtsc()
+#else
+#define CICLOS() 0ull
+#endif
+
+#define TABELA 65536
+
+static lb_registro_t g_amostras[TABELA];
+
+// Passeio aleatório de ±32 LSB por amostra em cada canal (um IMU parado ou em
+// movimento lento, com ruído) e timestamps a 1 kHz com alguns µs de atraso
+static void gerar_amostras(uint8_t sensores)
+{
+    uint32_t semente = 12345;
+    int32_t canais[LB_MAX_SENSORES][AG_NUM_CANAIS] = {{0}};
+    uint64_t t = 5000000000ull;
+    for (int i = 0; i < TABELA; i++)
+    {
+        lb_registro_t *r = &g_amostras[i];
+        memset(r, 0, sizeof *r);
+        r->sensor = (uint8_t)(i % sensores);
+        if (r->sensor == 0)
+            t += 1000;
+        semente = semente * 1664525u + 1013904223u;
+        r->timestamp_us = t + r->sensor * 150u + (semente >> 29);
+        for (int c = 0; c < AG_NUM_CANAIS; c++)
+        {
+            semente = semente * 1664525u + 1013904223u;
+            int32_t v = canais[r->sensor][c] + (int32_t)(semente >> 26) - 32;
+            canais[r->sensor][c] = v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v;
+            r->canais[c] = (int16_t)canais[r->sensor][c];
+        }
+    }
+}
+
+static lb_cabecalho_t cabecalho(uint8_t sensores, bool comprimido)
+{
+    return (lb_cabecalho_t){.tipo = LB_AMOSTRAS, .num_sensores = sensores, .odr_hz = 1000,
+                            .fator_decimacao = 1, .comprimido = comprimido};
+}
+
+// Um bloco de dados pronto, como iria ao cartão
+typedef void (*saida_bloco_t)(const uint8_t *bloco, void *contexto);
+
+static uint32_t comprimir(lb_escritor_t *e, uint32_t amostras, saida_bloco_t saida, void *contexto)
+{
+    uint32_t blocos = 0;
+    for (uint32_t seq = 0; seq < amostras; seq++)
+    {
+        const lb_registro_t *r = &g_amostras[seq % TABELA];
+        if (!lb_cabe(e, seq, r))
+        {
+            saida(lb_fechar_bloco(e), contexto);
+            lb_novo_bloco(e);
+            blocos++;
+        }
+        lb_adicionar(e, seq, r);
+        if (lb_bloco_cheio(e))
+        {
+            saida(lb_fechar_bloco(e), contexto);
+            lb_novo_bloco(e);
+            blocos++;
+        }
+    }
+    if (e->registros)
+    {
+        saida(lb_fechar_bloco(e), contexto);
+        blocos++;
+    }
+    return blocos;
+}
+
+static bool iguais(const lb_registro_t *a, const lb_registro_t *b)
+{
+    return a->sensor == b->sensor && a->timestamp_us == b->timestamp_us &&
+           memcmp(a->canais, b->canais, sizeof a->canais) == 0;
+}
+
+// Confere um bloco contra as amostras a partir da sua sequência
+static bool conferir_bloco(const lb_cabecalho_t *cab, const uint8_t *bloco, uint16_t esperados)
+{
+    uint32_t seq;
+    uint16_t registros;
+    if (!lb_ler_bloco(bloco, &seq, &registros) || registros != esperados)
+        return false;
+    lb_leitor_t l;
+    lb_registro_t r;
+    lb_leitor_iniciar(&l, cab, bloco, registros);
+    for (uint16_t i = 0; i < registros; i++)
+        if (!lb_ler_proximo(&l, &r) || !iguais(&r, &g_amostras[(seq + i) % TABELA]))
+            return false;
+    return !lb_ler_proximo(&l, &r);
+}
+
+typedef struct
+{
+    const lb_cabecalho_t *cab;
+    uint32_t proxima; // Sequência esperada no próximo bloco
+    bool ok;
+} conferencia_t;
+
+static void conferir_saida(const uint8_t *bloco, void *contexto)
+{
+    conferencia_t *c = contexto;
+    uint32_t seq;
+    uint16_t registros;
+    c->ok = c->ok && lb_ler_bloco(bloco, &seq, &registros) && seq == c->proxima &&
+            conferir_bloco(c->cab, bloco, registros);
+    c->proxima = seq + registros;
+}
+
+// Ida e volta de 'amostras' amostras; a cada 7 registros o bloco aberto também é
+// fechado provisoriamente e tem de decodificar só o que já entrou
+static bool conferir(uint8_t sensores, uint32_t amostras)
+{
+    lb_cabecalho_t cab = cabecalho(sensores, true);
+    static lb_escritor_t e;
+    lb_iniciar(&e, &cab);
+    conferencia_t c = {.cab = &cab, .ok = true};
+    for (uint32_t seq = 0; seq < amostras && c.ok; seq++)
+    {
+        const lb_registro_t *r = &g_amostras[seq % TABELA];
+        if (!lb_cabe(&e, seq, r))
+        {
+            conferir_saida(lb_fechar_bloco(&e), &c);
+            lb_novo_bloco(&e);
+        }
+        lb_adicionar(&e, seq, r);
+        if (seq % 7 == 0)
+            c.ok = c.ok && conferir_bloco(&cab, lb_fechar_bloco(&e), e.registros);
+        if (lb_bloco_cheio(&e))
+        {
+            conferir_saida(lb_fechar_bloco(&e), &c);
+            lb_novo_bloco(&e);
+        }
+    }
+    if (e.registros)
+        conferir_saida(lb_fechar_bloco(&e), &c);
+    return c.ok && c.proxima == amostras;
+}
+
+static double agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+typedef struct
+{
+    uint8_t (*blocos)[LB_BLOCO];
+    uint32_t n, max;
+} memoria_t;
+
+static void guardar(const uint8_t *bloco, void *contexto)
+{
+    memoria_t *m = contexto;
+    if (m->n < m->max)
+        memcpy(m->blocos[m->n++], bloco, LB_BLOCO);
+}
+
+static void medir(const char *nome, uint8_t sensores, bool comprimido, uint32_t amostras)
+{
+    lb_cabecalho_t cab = cabecalho(sensores, comprimido);
+    static lb_escritor_t e;
+    lb_iniciar(&e, &cab);
+    memoria_t m = {.max = amostras / 8 + 16};
+    m.blocos = malloc((size_t)m.max * LB_BLOCO);
+
+    double inicio = agora_ns();
+    uint64_t c0 = CICLOS();
+    uint32_t blocos = comprimir(&e, amostras, guardar, &m);
+    uint64_t ciclos_escrita = CICLOS() - c0;
+    double tempo_escrita = agora_ns() - inicio;
+
+    lb_registro_t r;
+    uint32_t lidos = 0;
+    inicio = agora_ns();
+    c0 = CICLOS();
+    for (uint32_t b = 0; b < m.n; b++)
+    {
+        uint32_t seq;
+        uint16_t registros;
+        lb_leitor_t l;
+        if (!lb_ler_bloco(m.blocos[b], &seq, &registros))
+            continue;
+        lb_leitor_iniciar(&l, &cab, m.blocos[b], registros);
+        while (lb_ler_proximo(&l, &r))
+            lidos++;
+    }
+    uint64_t ciclos_leitura = CICLOS() - c0;
+    double tempo_leitura = agora_ns() - inicio;
+    free(m.blocos);
+
+    double bytes = (double)blocos * LB_BLOCO / amostras;
+    printf("%-10s %5.2f bytes/amostra (%.2fx)  escrita %6.1f ns", nome, bytes,
+           lb_tamanho_registro(&cab) / bytes, tempo_escrita / amostras);
+    if (ciclos_escrita)
+        printf(" %6.1f ciclos", (double)ciclos_escrita / amostras);
+    printf("  leitura %6.1f ns", tempo_leitura / amostras);
+    if (ciclos_leitura)
+        printf(" %6.1f ciclos", (double)ciclos_leitura / amostras);
+    printf("%s\n", lidos == amostras && m.n == blocos ? "" : "  (ERRO: amostras perdidas)");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t amostras = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000u;
+    uint8_t sensores = argc > 2 ? (uint8_t)strtoul(argv[2], NULL, 0) : 1;
+    if (amostras == 0)
+        amostras = 1;
+    if (sensores < 1 || sensores > LB_MAX_SENSORES)
+    {
+        fprintf(stderr, "sensores: 1 a %d\n", LB_MAX_SENSORES);
+        return 2;
+    }
+
+    for (uint8_t s = 1; s <= LB_MAX_SENSORES; s++)
+    {
+        gerar_amostras(s);
+        if (!conferir(s, 3 * TABELA))
+        {
+            fprintf(stderr, "ERRO: a compressao nao voltou as mesmas amostras com %u sensor(es)\n", s);
+            return 1;
+        }
+    }
+
+    gerar_amostras(sensores);
+    printf("%u amostras de %u sensor(es), passeio aleatorio de +-32 LSB a 1 kHz (por amostra):\n", amostras,
+           sensores);
+    medir("fixo", sensores, false, amostras);
+    medir("comprimido", sensores, true, amostras);
+    return 0;
+}
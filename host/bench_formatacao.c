@@ -0,0 +1,189 @@
+// Custo por registro das duas formas de montar as linhas do CSV: o printf (caminho
+// antigo, gravador_printf) e lib/formatacao.c, direto no bloco do gravador. Confere
+// antes que as duas geram os mesmos bytes, inclusive nos extremos de cada tipo.
+//
+//   bench_formatacao [registros]     (padrão 1000000)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "formatacao.h"
+#include "gravador.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CICLOS() __rdtsc()
+#else
+#define CICLOS() 0ull
+#endif
+
+#define NUM_CANAIS 7
+#define TABELA 256
+
+typedef struct
+{
+    uint32_t seq;
+    uint64_t timestamp_us;
+    int16_t canais[NUM_CANAIS];
+    int16_t orientacao[7];
+} registro_t;
+
+static registro_t g_registros[TABELA];
+
+static void gerar_registros(void)
+{
+    uint32_t semente = 12345;
+    uint64_t t = 5000000000ull; // ~83 min depois do boot: o timestamp já passa de 32 bits
+    for (int i = 0; i < TABELA; i++)
+    {
+        g_registros[i].seq = 1000000u + (uint32_t)i;
+        g_registros[i].timestamp_us = t += 1000;
+        for (int c = 0; c < NUM_CANAIS; c++)
+        {
+            semente = semente * 1664525u + 1013904223u;
+            g_registros[i].canais[c] = (int16_t)(semente >> 16);
+        }
+        for (int c = 0; c < 7; c++)
+        {
+            semente = semente * 1664525u + 1013904223u;
+            g_registros[i].orientacao[c] = (int16_t)((int32_t)(semente >> 16) % 18000);
+        }
+    }
+}
+
+// Linha de amostra com orientação, como gravar_amostra na placa
+static void gravar_printf(gravador_t *g, const registro_t *r)
+{
+    gravador_printf(g, "%lu;%u;%llu;%d;%d;%d;%d;%d;%d;%d", (unsigned long)r->seq, 0u,
+                    (unsigned long long)r->timestamp_us, r->canais[0], r->canais[1], r->canais[2],
+                    r->canais[3], r->canais[4], r->canais[5], r->canais[6]);
+    const int16_t *o = r->orientacao;
+    gravador_printf(g, ";%d;%d;%d;%d;%d;%d;%d", o[0], o[1], o[2], o[3], o[4], o[5], o[6]);
+    gravador_escrever(g, "\n", 1);
+}
+
+static void gravar_rapido(gravador_t *g, const registro_t *r)
+{
+    char reserva[GRAV_LINHA_MAX];
+    char *inicio = gravador_reservar(g, GRAV_LINHA_MAX, reserva);
+    char *p = fmt_u32(inicio, r->seq);
+    *p++ = ';';
+    p = fmt_u32(p, 0);
+    *p++ = ';';
+    p = fmt_u64(p, r->timestamp_us);
+    p = fmt_campos_i16(p, r->canais, NUM_CANAIS);
+    p = fmt_campos_i16(p, r->orientacao, 7);
+    *p++ = '\n';
+    gravador_confirmar(g, inicio, (uint32_t)(p - inicio));
+}
+
+// Extremos e vizinhanças das potências de 10, comparados com o printf
+static bool conferir_conversoes(void)
+{
+    char esperado[32], obtido[32];
+    uint64_t v = 1;
+    for (int d = 0; d < 20; d++, v *= 10)
+    {
+        const uint64_t casos[] = {v - 1, v, v + 1, v * 5, UINT64_MAX - v};
+        for (size_t i = 0; i < sizeof casos / sizeof casos[0]; i++)
+        {
+            snprintf(esperado, sizeof esperado, "%llu", (unsigned long long)casos[i]);
+            *fmt_u64(obtido, casos[i]) = '\0';
+            if (strcmp(esperado, obtido) != 0)
+            {
+                fprintf(stderr, "ERRO: u64 %s -> %s\n", esperado, obtido);
+                return false;
+            }
+        }
+    }
+    const int32_t i32[] = {0, -1, 1, 9, -10, 99, -100, INT16_MIN, INT16_MAX, INT32_MIN, INT32_MAX, 1073741824};
+    for (size_t i = 0; i < sizeof i32 / sizeof i32[0]; i++)
+    {
+        snprintf(esperado, sizeof esperado, "%ld", (long)i32[i]);
+        *fmt_i32(obtido, i32[i]) = '\0';
+        if (strcmp(esperado, obtido) != 0)
+        {
+            fprintf(stderr, "ERRO: i32 %s -> %s\n", esperado, obtido);
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct
+{
+    FIL arquivo;
+    gravador_t gravador;
+} saida_t;
+
+static void abrir(saida_t *s, FILE *arquivo)
+{
+    memset(&s->arquivo, 0, sizeof s->arquivo);
+    s->arquivo.arquivo = arquivo;
+    gravador_iniciar(&s->gravador, &s->arquivo);
+}
+
+static double agora_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static void medir(const char *nome, void (*gravar)(gravador_t *, const registro_t *), uint32_t registros)
+{
+    static saida_t s;
+    abrir(&s, fopen("/dev/null", "wb"));
+    double inicio = agora_ns();
+    uint64_t c0 = CICLOS();
+    for (uint32_t i = 0; i < registros; i++)
+        gravar(&s.gravador, &g_registros[i % TABELA]);
+    uint64_t ciclos = CICLOS() - c0;
+    double tempo = agora_ns() - inicio;
+    gravador_finalizar(&s.gravador);
+    fclose(s.arquivo.arquivo);
+    printf("%-8s %7.1f ns/registro", nome, tempo / registros);
+    if (ciclos)
+        printf(", %7.1f ciclos (TSC)/registro", (double)ciclos / registros);
+    printf(", %.1f bytes/registro\n", (double)s.gravador.bytes / registros);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t registros = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000u;
+    if (registros == 0)
+        registros = 1;
+    gerar_registros();
+    if (!conferir_conversoes())
+        return 1;
+
+    // As duas formas precisam dar o mesmo arquivo
+    static saida_t a, b;
+    FILE *fa = tmpfile(), *fb = tmpfile();
+    abrir(&a, fa);
+    abrir(&b, fb);
+    for (int i = 0; i < 5000; i++)
+    {
+        gravar_printf(&a.gravador, &g_registros[i % TABELA]);
+        gravar_rapido(&b.gravador, &g_registros[i % TABELA]);
+    }
+    gravador_finalizar(&a.gravador);
+    gravador_finalizar(&b.gravador);
+    bool iguais = a.gravador.bytes == b.gravador.bytes;
+    rewind(fa);
+    rewind(fb);
+    for (int ca, cb; iguais && (ca = fgetc(fa)) != EOF;)
+        iguais = (cb = fgetc(fb)) == ca;
+    fclose(fa);
+    fclose(fb);
+    if (!iguais)
+    {
+        fprintf(stderr, "ERRO: as duas formas geraram arquivos diferentes\n");
+        return 1;
+    }
+
+    printf("%u linhas de amostra com orientacao (timestamp de 64 bits):\n", registros);
+    medir("printf", gravar_printf, registros);
+    medir("rapido", gravar_rapido, registros);
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Converte o log binário da placa (LOG_BINARIO, lib/log_binario.h) no CSV que ela
+// gravaria com LOG_BINARIO=0: mesmas colunas, linhas '#' de metadados e de troca de
+// taxa. Blocos com CRC errado são pulados e contados.
+//
+//   exportar <log.bin> [saida.csv]     (sem saída: terminal)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_binario.h"
+
+static const char *const nomes_canais[AG_NUM_CANAIS] = {"ax", "ay", "az", "gx", "gy", "gz", "temp"};
+
+static void escrever_cabecalho(FILE *f, const lb_cabecalho_t *cab)
+{
+    if (cab->tipo == LB_AMOSTRAS)
+    {
+        fprintf(f, "seq;sensor;timestamp_us;ax;ay;az;gx;gy;gz;temp");
+    }
+    else
+    {
+        fprintf(f, "seq;sensor;t_inicio_us;t_fim_us");
+        for (uint32_t e = 0; e < AG_NUM_ESTATISTICAS; e++)
+            if (cab->estatisticas & (1u << e))
+                for (int c = 0; c < AG_NUM_CANAIS; c++)
+                    fprintf(f, ";%s_%s", nomes_canais[c], ag_nome_estatistica(e));
+    }
+    if (cab->orientacao)
+        fprintf(f, ";qw;qx;qy;qz;roll_cdeg;pitch_cdeg;yaw_cdeg");
+    fprintf(f, "\n");
+    if (cab->sessao)
+        fprintf(f, "# sessao=%u;parte=%u\n", cab->sessao, cab->parte);
+    fprintf(f, "# odr_hz=%u;dlpf=%u;accel_lsb_g=%u;gyro_lsb_dps=%u.%u;janela_amostras=%u;"
+               "filtro_decimacao=%u;fator_decimacao=%u;sensores=%u\n",
+            cab->odr_hz, cab->dlpf, cab->escala_accel, cab->escala_gyro_x10 / 10, cab->escala_gyro_x10 % 10,
+            cab->janela_amostras, cab->filtro_decimacao, cab->fator_decimacao, cab->num_sensores);
+    for (int i = 0; i < cab->num_sensores && i < LB_MAX_SENSORES; i++)
+        fprintf(f, "# sensor=%d;i2c=%u;endereco=%u;calibracao_gyro=%d\n", i, cab->sensores[i].i2c,
+                cab->sensores[i].endereco_i2c, cab->sensores[i].calibracao_gyro);
+    if (cab->ano)
+        fprintf(f, "# inicio=%04u-%02u-%02uT%02u:%02u:%02u;inicio_us=%llu\n", cab->ano, cab->mes, cab->dia,
+                cab->hora, cab->minuto, cab->segundo, (unsigned long long)cab->inicio_us);
+}
+
+static void escrever_registro(FILE *f, const lb_cabecalho_t *cab, uint32_t seq, const lb_registro_t *r)
+{
+    if (r->sensor == LB_SENSOR_TAXA)
+    {
+        fprintf(f, "# taxa_odr_mhz=%u;t_taxa_us=%llu;repouso=%d\n", r->odr_mhz,
+                (unsigned long long)r->timestamp_us, r->repouso);
+        return;
+    }
+    if (cab->tipo == LB_AMOSTRAS)
+    {
+        fprintf(f, "%u;%u;%llu", seq, r->sensor, (unsigned long long)r->timestamp_us);
+        for (int c = 0; c < AG_NUM_CANAIS; c++)
+            fprintf(f, ";%d", r->canais[c]);
+    }
+    else
+    {
+        const ag_resultado_t *j = &r->janela;
+        fprintf(f, "%u;%u;%llu;%llu", seq, r->sensor, (unsigned long long)r->timestamp_us,
+                (unsigned long long)r->timestamp_fim_us);
+        for (uint32_t e = 0; e < AG_NUM_ESTATISTICAS; e++)
+        {
+            if (!(cab->estatisticas & (1u << e)))
+                continue;
+            for (int c = 0; c < AG_NUM_CANAIS; c++)
+            {
+                switch (1u << e)
+                {
+                case AG_MEDIA:
+                    fprintf(f, ";%d", j->media[c]);
+                    break;
+                case AG_MIN:
+                    fprintf(f, ";%d", j->min[c]);
+                    break;
+                case AG_MAX:
+                    fprintf(f, ";%d", j->max[c]);
+                    break;
+                case AG_RMS:
+                    fprintf(f, ";%u", j->rms[c]);
+                    break;
+                default:
+                    fprintf(f, ";%ld", (long)(int32_t)j->variancia[c]);
+                    break;
+                }
+            }
+        }
+    }
+    if (cab->orientacao)
+        fprintf(f, ";%d;%d;%d;%d;%d;%d;%d", r->orientacao.q[0], r->orientacao.q[1], r->orientacao.q[2],
+                r->orientacao.q[3], r->orientacao.rpy_cdeg[0], r->orientacao.rpy_cdeg[1], r->orientacao.rpy_cdeg[2]);
+    fputc('\n', f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "uso: %s <log.bin> [saida.csv]\n", argv[0]);
+        return 2;
+    }
+    FILE *entrada = fopen(argv[1], "rb");
+    FILE *saida = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!entrada || !saida)
+    {
+        fprintf(stderr, "ERRO: nao foi possivel abrir os arquivos\n");
+        return 1;
+    }
+
+    static uint8_t bloco[LB_BLOCO];
+    lb_cabecalho_t cab;
+    bool sessao = false;
+    uint32_t sessoes = 0, blocos = 0, invalidos = 0, saltos = 0, proxima = 0;
+    uint64_t registros = 0;
+    while (fread(bloco, 1, LB_BLOCO, entrada) == LB_BLOCO)
+    {
+        if (lb_ler_cabecalho(bloco, &cab))
+        {
+            escrever_cabecalho(saida, &cab);
+            sessao = true;
+            sessoes++;
+            proxima = 0;
+            continue;
+        }
+        uint32_t seq;
+        uint16_t n;
+        if (!sessao || !lb_ler_bloco(bloco, &seq, &n) || n > lb_capacidade(&cab))
+        {
+            invalidos++;
+            continue;
+        }
+        if (seq != proxima)
+            saltos++;
+        lb_leitor_t leitor;
+        lb_registro_t r;
+        uint16_t i = 0;
+        lb_leitor_iniciar(&leitor, &cab, bloco, n);
+        while (lb_ler_proximo(&leitor, &r))
+            escrever_registro(saida, &cab, seq + i++, &r);
+        if (i < n)
+            invalidos++; // Bloco comprimido mal formado: vale o que foi decodificado antes do erro
+        proxima = seq + n;
+        registros += i;
+        blocos++;
+    }
+
+    fprintf(stderr, "%u sessao(oes), %u blocos, %llu registros, %u blocos invalidos, %u saltos de sequencia\n",
+            sessoes, blocos, (unsigned long long)registros, invalidos, saltos);
+    fclose(entrada);
+    if (saida != stdout)
+        fclose(saida);
+    return invalidos ? 1 : 0;
+}
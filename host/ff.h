@@ -0,0 +1,50 @@
+// ff.h (PC)
+#ifndef FF_H
+#define FF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// O pedaço da API do FatFs que lib/gravador.c usa, sobre stdio. No PC o gravador
+// escreve num arquivo comum, nos mesmos blocos que mandaria ao cartão.
+
+typedef unsigned int UINT;
+typedef uint64_t FSIZE_t;
+
+typedef enum
+{
+    FR_OK = 0,
+    FR_DISK_ERR = 1
+} FRESULT;
+
+typedef struct
+{
+    FILE *arquivo;
+    FSIZE_t fptr;
+    uint32_t escritas; // Chamadas de f_write, para comparar com o caminho antigo
+} FIL;
+
+#define f_tell(fp) ((fp)->fptr)
+
+static inline FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    *bw = (UINT)fwrite(buff, 1, btw, fp->arquivo);
+    fp->fptr += *bw;
+    fp->escritas++;
+    return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+static inline FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    if (fseeko(fp->arquivo, (off_t)ofs, SEEK_SET) != 0)
+        return FR_DISK_ERR;
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+static inline FRESULT f_sync(FIL *fp)
+{
+    return fflush(fp->arquivo) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+#endif // FF_H
@@ -0,0 +1,349 @@
+#include "imu_replay.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Índices de imu_replay_t.colunas
+enum
+{
+    COL_TIMESTAMP = 0,
+    COL_CANAIS = 1, // ax, ay, az, gx, gy, gz, temp
+    COL_SENSOR = 8
+};
+
+static const char *const nomes_canais[7] = {"ax", "ay", "az", "gx", "gy", "gz", "temp"};
+
+// Linhas usadas para estimar a taxa quando o arquivo não a informa
+#define AMOSTRAS_ESTIMATIVA 16
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static void escrever_le(uint8_t *p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// Linha '#' de metadados do log: ODR e fundos de escala
+static void ler_metadados(imu_replay_t *r, const char *linha)
+{
+    const char *p;
+    if ((p = strstr(linha, "odr_hz=")))
+        r->imu.taxa_hz = (uint32_t)strtoul(p + 7, NULL, 10);
+    if ((p = strstr(linha, "accel_lsb_g=")))
+        r->imu.escala_accel = (uint16_t)strtoul(p + 12, NULL, 10);
+    if ((p = strstr(linha, "gyro_lsb_dps=")))
+        r->imu.escala_gyro_x10 = (uint16_t)(strtod(p + 13, NULL) * 10.0 + 0.5);
+}
+
+// Cabeçalho do CSV: acha as colunas pelo nome ("ax" nas amostras, "ax_avg" nas janelas)
+static bool ler_cabecalho(imu_replay_t *r, char *linha)
+{
+    for (int i = 0; i < IMU_REPLAY_COLUNAS; i++)
+        r->colunas[i] = -1;
+
+    int indice = 0;
+    for (char *campo = strtok(linha, ";\r\n"); campo; campo = strtok(NULL, ";\r\n"), indice++)
+    {
+        if (strcmp(campo, "timestamp_us") == 0 || strcmp(campo, "t_inicio_us") == 0)
+            r->colunas[COL_TIMESTAMP] = indice;
+        else if (strcmp(campo, "sensor") == 0)
+            r->colunas[COL_SENSOR] = indice;
+        for (int c = 0; c < 7; c++)
+        {
+            size_t n = strlen(nomes_canais[c]);
+            if (strncmp(campo, nomes_canais[c], n) == 0 && (campo[n] == '\0' || strcmp(campo + n, "_avg") == 0))
+                r->colunas[COL_CANAIS + c] = indice;
+        }
+    }
+    for (int i = 0; i < COL_SENSOR; i++)
+        if (r->colunas[i] < 0)
+            return false;
+    return true;
+}
+
+// Próxima linha de dados do sensor escolhido. Metadados e cabeçalhos de sessões
+// seguintes (o log acumula sessões no mesmo arquivo) são consumidos no caminho.
+static bool ler_linha_csv(imu_replay_t *r, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    while (fgets(r->linha, sizeof r->linha, r->arquivo))
+    {
+        char *linha = r->linha;
+        if (linha[0] == '#')
+        {
+            ler_metadados(r, linha);
+            continue;
+        }
+        if (linha[0] != '-' && (linha[0] < '0' || linha[0] > '9'))
+        {
+            if (linha[0] != '\r' && linha[0] != '\n' && !ler_cabecalho(r, linha))
+                return false;
+            continue;
+        }
+
+        long long valores[64];
+        int n = 0;
+        char *p = linha;
+        while (n < 64)
+        {
+            char *fim;
+            valores[n++] = strtoll(p, &fim, 10);
+            if (*fim != ';')
+                break;
+            p = fim + 1;
+        }
+
+        bool completa = true;
+        for (int i = 0; i < IMU_REPLAY_COLUNAS; i++)
+            if (r->colunas[i] >= n)
+                completa = false;
+        if (!completa)
+        {
+            r->linhas_invalidas++;
+            continue;
+        }
+        int sensor = r->colunas[COL_SENSOR] < 0 ? 0 : (int)valores[r->colunas[COL_SENSOR]];
+        if (sensor != r->sensor)
+            continue;
+
+        *timestamp_us = (uint64_t)valores[r->colunas[COL_TIMESTAMP]];
+        int16_t canais[7];
+        for (int c = 0; c < 7; c++)
+            canais[c] = (int16_t)valores[r->colunas[COL_CANAIS + c]];
+        memcpy(dados->accel, canais, sizeof dados->accel);
+        memcpy(dados->gyro, canais + 3, sizeof dados->gyro);
+        dados->temp = canais[6];
+        return true;
+    }
+    return false;
+}
+
+static bool ler_registro_binario(imu_replay_t *r, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    uint8_t reg[IMU_REPLAY_REGISTRO_LEN];
+    if (fread(reg, 1, sizeof reg, r->arquivo) != sizeof reg)
+        return false;
+    uint64_t t = 0;
+    for (int i = 7; i >= 0; i--)
+        t = t << 8 | reg[i];
+    *timestamp_us = t;
+    for (int i = 0; i < 3; i++)
+    {
+        dados->accel[i] = (int16_t)le16(&reg[8 + i * 2]);
+        dados->gyro[i] = (int16_t)le16(&reg[14 + i * 2]);
+    }
+    dados->temp = (int16_t)le16(&reg[20]);
+    return true;
+}
+
+// Log binário: cabeçalhos de sessões seguintes atualizam as escalas, blocos com CRC
+// errado contam como linhas inválidas e trocas de taxa são puladas
+static bool ler_registro_log(imu_replay_t *r, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    for (;;)
+    {
+        lb_registro_t reg;
+        while (lb_ler_proximo(&r->leitor, &reg))
+        {
+            if (reg.sensor != r->sensor)
+                continue;
+            *timestamp_us = reg.timestamp_us;
+            memcpy(dados->accel, reg.canais, sizeof dados->accel);
+            memcpy(dados->gyro, reg.canais + 3, sizeof dados->gyro);
+            dados->temp = reg.canais[6];
+            return true;
+        }
+        if (fread(r->bloco, 1, LB_BLOCO, r->arquivo) != LB_BLOCO)
+            return false;
+        lb_leitor_iniciar(&r->leitor, &r->cab, r->bloco, 0);
+        lb_cabecalho_t cab;
+        uint32_t sequencia;
+        uint16_t n;
+        if (lb_ler_cabecalho(r->bloco, &cab))
+        {
+            r->cab = cab;
+            r->imu.escala_accel = cab.escala_accel;
+            r->imu.escala_gyro_x10 = cab.escala_gyro_x10;
+        }
+        else if (lb_ler_bloco(r->bloco, &sequencia, &n) && n <= lb_capacidade(&r->cab))
+            lb_leitor_iniciar(&r->leitor, &r->cab, r->bloco, n);
+        else
+            r->linhas_invalidas++;
+    }
+}
+
+// Segura a entrega até o instante da amostra, escalado pela velocidade
+static void esperar_instante(imu_replay_t *r, uint64_t timestamp_us)
+{
+    if (r->velocidade <= 0.0f)
+        return;
+    // Um timestamp que volta é o começo de outra sessão: o ritmo recomeça nela
+    if (!r->ritmo_iniciado || timestamp_us < r->primeiro_us)
+    {
+        r->ritmo_iniciado = true;
+        r->primeiro_us = timestamp_us;
+        clock_gettime(CLOCK_MONOTONIC, &r->inicio);
+        return;
+    }
+    uint64_t atraso_ns = (uint64_t)((double)(timestamp_us - r->primeiro_us) * 1000.0 / r->velocidade);
+    struct timespec alvo = r->inicio;
+    alvo.tv_sec += (time_t)(atraso_ns / 1000000000u);
+    alvo.tv_nsec += (long)(atraso_ns % 1000000000u);
+    if (alvo.tv_nsec >= 1000000000L)
+    {
+        alvo.tv_sec++;
+        alvo.tv_nsec -= 1000000000L;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &alvo, NULL);
+}
+
+static bool replay_ler(imu_t *imu, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    imu_replay_t *r = (imu_replay_t *)imu;
+    bool ok = r->log_binario ? ler_registro_log(r, dados, timestamp_us)
+              : r->binario   ? ler_registro_binario(r, dados, timestamp_us)
+                             : ler_linha_csv(r, dados, timestamp_us);
+    if (!ok)
+        return false;
+    esperar_instante(r, *timestamp_us);
+    r->amostras++;
+    return true;
+}
+
+static bool replay_reset(imu_t *imu)
+{
+    imu_replay_t *r = (imu_replay_t *)imu;
+    r->ritmo_iniciado = false;
+    r->amostras = 0;
+    lb_leitor_iniciar(&r->leitor, &r->cab, r->bloco, 0);
+    return fseek(r->arquivo, r->inicio_dados, SEEK_SET) == 0;
+}
+
+static const imu_ops_t ops_replay = {.reset = replay_reset, .ler = replay_ler};
+
+// Taxa pelos primeiros intervalos, para arquivos sem a linha de metadados
+// (ou de médias, em que cada linha é uma janela)
+static uint32_t estimar_taxa(imu_replay_t *r)
+{
+    imu_dados_t dados;
+    uint64_t primeiro = 0, ultimo = 0;
+    uint32_t n = 0;
+    float velocidade = r->velocidade;
+    r->velocidade = 0.0f;
+    for (; n < AMOSTRAS_ESTIMATIVA && replay_ler(&r->imu, &dados, &ultimo); n++)
+        if (n == 0)
+            primeiro = ultimo;
+    r->velocidade = velocidade;
+    if (n < 2 || ultimo <= primeiro)
+        return 0;
+    return (uint32_t)(((uint64_t)(n - 1) * 1000000u + (ultimo - primeiro) / 2) / (ultimo - primeiro));
+}
+
+bool imu_replay_abrir(imu_replay_t *r, const char *caminho, int sensor, float velocidade)
+{
+    memset(r, 0, sizeof *r);
+    r->arquivo = fopen(caminho, "rb");
+    if (!r->arquivo)
+        return false;
+    r->imu.ops = &ops_replay;
+    r->imu.contexto = r;
+    r->imu.escala_accel = 16384;
+    r->imu.escala_gyro_x10 = 1310;
+    r->sensor = sensor;
+    r->velocidade = velocidade;
+
+    uint8_t cab[IMU_REPLAY_CABECALHO_LEN];
+    if (fread(cab, 1, sizeof cab, r->arquivo) == sizeof cab && memcmp(cab, IMU_REPLAY_MAGICA, 4) == 0)
+    {
+        if (le16(&cab[4]) != IMU_REPLAY_VERSAO)
+        {
+            imu_replay_fechar(r);
+            return false;
+        }
+        r->binario = true;
+        r->imu.escala_accel = le16(&cab[6]);
+        r->imu.escala_gyro_x10 = le16(&cab[8]);
+        r->imu.taxa_hz = le16(&cab[12]) | (uint32_t)le16(&cab[14]) << 16;
+        r->inicio_dados = IMU_REPLAY_CABECALHO_LEN;
+        return true;
+    }
+
+    // Log binário: a primeira sessão dá taxa e escalas; o cabeçalho é lido de novo a cada passada
+    rewind(r->arquivo);
+    if (fread(r->bloco, 1, LB_BLOCO, r->arquivo) == LB_BLOCO && lb_ler_cabecalho(r->bloco, &r->cab))
+    {
+        r->log_binario = true;
+        r->imu.escala_accel = r->cab.escala_accel;
+        r->imu.escala_gyro_x10 = r->cab.escala_gyro_x10;
+        // Nas janelas cada registro é uma janela: a taxa é a das janelas
+        r->imu.taxa_hz = r->cab.tipo == LB_JANELAS && r->cab.janela_amostras
+                             ? (r->cab.odr_hz + r->cab.janela_amostras / 2) / r->cab.janela_amostras
+                             : r->cab.odr_hz / (r->cab.fator_decimacao ? r->cab.fator_decimacao : 1);
+        r->inicio_dados = 0;
+        return replay_reset(&r->imu);
+    }
+
+    // CSV: metadados e cabeçalho até a primeira linha de dados
+    rewind(r->arquivo);
+    bool cabecalho = false;
+    long posicao = 0;
+    while (fgets(r->linha, sizeof r->linha, r->arquivo))
+    {
+        char c = r->linha[0];
+        if (c == '#')
+            ler_metadados(r, r->linha);
+        else if (c == '-' || (c >= '0' && c <= '9'))
+            break;
+        else if (c != '\r' && c != '\n')
+            cabecalho = ler_cabecalho(r, r->linha);
+        posicao = ftell(r->arquivo);
+    }
+    if (!cabecalho)
+    {
+        imu_replay_fechar(r);
+        return false;
+    }
+    r->inicio_dados = posicao;
+
+    // O ritmo das linhas vale mais que o ODR dos metadados: nas médias de janela e
+    // nas amostras decimadas os dois são diferentes
+    replay_reset(&r->imu);
+    uint32_t estimada = estimar_taxa(r);
+    if (estimada)
+        r->imu.taxa_hz = estimada;
+    r->linhas_invalidas = 0;
+    return replay_reset(&r->imu);
+}
+
+void imu_replay_fechar(imu_replay_t *r)
+{
+    if (r->arquivo)
+        fclose(r->arquivo);
+    r->arquivo = NULL;
+}
+
+bool imu_replay_gravar_cabecalho(FILE *arquivo, const imu_t *imu)
+{
+    uint8_t cab[IMU_REPLAY_CABECALHO_LEN] = {0};
+    memcpy(cab, IMU_REPLAY_MAGICA, 4);
+    escrever_le(&cab[4], IMU_REPLAY_VERSAO, 2);
+    escrever_le(&cab[6], imu->escala_accel, 2);
+    escrever_le(&cab[8], imu->escala_gyro_x10, 2);
+    escrever_le(&cab[12], imu->taxa_hz, 4);
+    return fwrite(cab, 1, sizeof cab, arquivo) == sizeof cab;
+}
+
+bool imu_replay_gravar_amostra(FILE *arquivo, const imu_dados_t *dados, uint64_t timestamp_us)
+{
+    uint8_t reg[IMU_REPLAY_REGISTRO_LEN];
+    escrever_le(reg, timestamp_us, 8);
+    for (int i = 0; i < 3; i++)
+    {
+        escrever_le(&reg[8 + i * 2], (uint16_t)dados->accel[i], 2);
+        escrever_le(&reg[14 + i * 2], (uint16_t)dados->gyro[i], 2);
+    }
+    escrever_le(&reg[20], (uint16_t)dados->temp, 2);
+    return fwrite(reg, 1, sizeof reg, arquivo) == sizeof reg;
+}
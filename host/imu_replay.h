@@ -0,0 +1,64 @@
+// imu_replay.h
+#ifndef IMU_REPLAY_H
+#define IMU_REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include "imu.h"
+#include "log_binario.h"
+
+// IMU virtual: reproduz uma sessão gravada pela interface de imu.h, para rodar o
+// processamento da placa no PC. Aceita o CSV do log (amostras brutas ou médias de
+// janela, como o dados_pico.csv), o log binário (lib/log_binario.h; nas janelas, a
+// média) e a captura binária abaixo. Cada linha do arquivo vira uma amostra, com o
+// timestamp gravado.
+
+// Captura binária, little-endian: cabeçalho de 16 bytes seguido de registros de 22
+#define IMU_REPLAY_MAGICA "IMUR"
+#define IMU_REPLAY_VERSAO 1
+#define IMU_REPLAY_CABECALHO_LEN 16 // magica[4], versao u16, escala_accel u16, escala_gyro_x10 u16, 0 u16, taxa_hz u32
+#define IMU_REPLAY_REGISTRO_LEN 22  // timestamp_us u64, ax, ay, az, gx, gy, gz, temp i16
+
+// Colunas procuradas no cabeçalho do CSV: timestamp, os 7 canais e o sensor
+#define IMU_REPLAY_COLUNAS 9
+
+typedef struct
+{
+    imu_t imu; // Primeiro campo: as funções da interface recebem o replay por ele
+    FILE *arquivo;
+    bool binario;
+    bool log_binario;
+    long inicio_dados; // Posição da primeira amostra, para onde o reset volta
+    int sensor;        // Só as linhas deste sensor; um arquivo sem a coluna é o sensor 0
+    int colunas[IMU_REPLAY_COLUNAS];
+
+    // Ritmo: 0 entrega o mais rápido possível, 1 em tempo real, 10 dez vezes mais rápido
+    float velocidade;
+    bool ritmo_iniciado;
+    uint64_t primeiro_us;   // Timestamp da primeira amostra da passada
+    struct timespec inicio; // Relógio do PC nesse instante
+
+    uint32_t amostras;         // Entregues desde o reset
+    uint32_t linhas_invalidas; // Linhas de dados que não puderam ser lidas
+    char linha[1024];
+
+    // Log binário: sessão e bloco correntes
+    lb_cabecalho_t cab;
+    uint8_t bloco[LB_BLOCO];
+    lb_leitor_t leitor;
+} imu_replay_t;
+
+// Abre o arquivo, reconhece o formato e preenche taxa e escalas a partir dos metadados
+// (linha '#' do log ou cabeçalho binário). Sem metadados, as escalas são ±2 g e ±250 °/s
+// e a taxa sai dos primeiros timestamps. Retorna false se o formato não for reconhecido.
+bool imu_replay_abrir(imu_replay_t *r, const char *caminho, int sensor, float velocidade);
+
+void imu_replay_fechar(imu_replay_t *r);
+
+// Gravação no formato binário, para converter um CSV ou guardar uma passada
+bool imu_replay_gravar_cabecalho(FILE *arquivo, const imu_t *imu);
+bool imu_replay_gravar_amostra(FILE *arquivo, const imu_dados_t *dados, uint64_t timestamp_us);
+
+#endif // IMU_REPLAY_H
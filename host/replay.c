@@ -0,0 +1,364 @@
+// Reproduz uma sessão gravada pelo mesmo caminho da placa (agregação, orientação,
+// formatação das linhas e gravação em blocos por lib/gravador.c) e mede quanto
+// tempo cada passada leva no PC.
+//
+//   replay [opções] <arquivo.csv | captura.bin>
+//     -s N    sensor reproduzido (coluna 'sensor'; padrão 0)
+//     -j N    amostras por janela (padrão: a taxa do arquivo, uma janela por segundo)
+//     -e M    máscara de estatísticas de agregacao.h (padrão 7: média, mín e máx)
+//     -a      grava as amostras em vez das janelas (LOG_AMOSTRAS_BRUTAS)
+//     -q      orientação em cada linha (ORIENTACAO)
+//     -v X    velocidade: 0 = o mais rápido possível (padrão), 1 = tempo real, 10 = 10x
+//     -n N    passadas sobre o arquivo, para medir arquivos curtos
+//     -o ARQ  saída CSV (padrão: descartada)
+//     -b ARQ  grava também a captura binária das amostras lidas
+//     -l ARQ  grava também o log binário da placa (LOG_BINARIO), pelo mesmo gravador
+//     -z      amostras do log binário comprimidas (LOG_COMPRIMIDO; só com -a)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "agregacao.h"
+#include "formatacao.h"
+#include "gravador.h"
+#include "imu_replay.h"
+#include "log_binario.h"
+#include "orientacao.h"
+
+#define NUM_CANAIS AG_NUM_CANAIS
+
+static const char *const nomes_canais[NUM_CANAIS] = {"ax", "ay", "az", "gx", "gy", "gz", "temp"};
+
+typedef struct
+{
+    int sensor;
+    uint32_t janela;
+    uint8_t estatisticas;
+    bool amostras;
+    bool orientacao;
+    float velocidade;
+    uint32_t passadas;
+    const char *saida;
+    const char *binario;
+    const char *log_binario;
+    bool comprimir;
+    const char *entrada;
+} opcoes_t;
+
+// Mesmo layout das linhas do log do cartão (gravar_cabecalho, gravar_janela e gravar_amostra)
+static void gravar_cabecalho(gravador_t *f, const opcoes_t *o)
+{
+    if (o->amostras)
+    {
+        gravador_printf(f, "seq;sensor;timestamp_us;ax;ay;az;gx;gy;gz;temp");
+    }
+    else
+    {
+        gravador_printf(f, "seq;sensor;t_inicio_us;t_fim_us");
+        for (uint32_t e = 0; e < AG_NUM_ESTATISTICAS; e++)
+            if (o->estatisticas & (1u << e))
+                for (int c = 0; c < NUM_CANAIS; c++)
+                    gravador_printf(f, ";%s_%s", nomes_canais[c], ag_nome_estatistica(e));
+    }
+    if (o->orientacao)
+        gravador_printf(f, ";qw;qx;qy;qz;roll_cdeg;pitch_cdeg;yaw_cdeg");
+    gravador_escrever(f, "\n", 1);
+}
+
+static char *formatar_orientacao(char *p, const opcoes_t *o, const ori_filtro_t *filtro)
+{
+    if (!o->orientacao)
+        return p;
+    ori_saida_t s;
+    ori_obter_saida(filtro, &s);
+    p = fmt_campos_i16(p, s.q, 4);
+    return fmt_campos_i16(p, s.rpy_cdeg, 3);
+}
+
+static void gravar_janela(gravador_t *f, const opcoes_t *o, uint32_t seq, uint64_t inicio_us, uint64_t fim_us,
+                          const ag_resultado_t *j, const ori_filtro_t *filtro)
+{
+    char reserva[GRAV_LINHA_MAX];
+    char *inicio = gravador_reservar(f, GRAV_LINHA_MAX, reserva);
+    char *p = fmt_u32(inicio, seq);
+    *p++ = ';';
+    p = fmt_i32(p, o->sensor);
+    *p++ = ';';
+    p = fmt_u64(p, inicio_us);
+    *p++ = ';';
+    p = fmt_u64(p, fim_us);
+    if (o->estatisticas & AG_MEDIA)
+        p = fmt_campos_i16(p, j->media, NUM_CANAIS);
+    if (o->estatisticas & AG_MIN)
+        p = fmt_campos_i16(p, j->min, NUM_CANAIS);
+    if (o->estatisticas & AG_MAX)
+        p = fmt_campos_i16(p, j->max, NUM_CANAIS);
+    if (o->estatisticas & AG_RMS)
+        for (int c = 0; c < NUM_CANAIS; c++)
+        {
+            *p++ = ';';
+            p = fmt_u32(p, j->rms[c]);
+        }
+    gravador_confirmar(f, inicio, (uint32_t)(p - inicio));
+
+    inicio = gravador_reservar(f, GRAV_LINHA_MAX, reserva);
+    p = inicio;
+    if (o->estatisticas & AG_VARIANCIA)
+        for (int c = 0; c < NUM_CANAIS; c++)
+        {
+            *p++ = ';';
+            p = fmt_i32(p, (int32_t)j->variancia[c]);
+        }
+    p = formatar_orientacao(p, o, filtro);
+    *p++ = '\n';
+    gravador_confirmar(f, inicio, (uint32_t)(p - inicio));
+}
+
+static void gravar_amostra(gravador_t *f, const opcoes_t *o, uint32_t seq, uint64_t timestamp_us,
+                           const int16_t canais[NUM_CANAIS], const ori_filtro_t *filtro)
+{
+    char reserva[GRAV_LINHA_MAX];
+    char *inicio = gravador_reservar(f, GRAV_LINHA_MAX, reserva);
+    char *p = fmt_u32(inicio, seq);
+    *p++ = ';';
+    p = fmt_i32(p, o->sensor);
+    *p++ = ';';
+    p = fmt_u64(p, timestamp_us);
+    p = fmt_campos_i16(p, canais, NUM_CANAIS);
+    p = formatar_orientacao(p, o, filtro);
+    *p++ = '\n';
+    gravador_confirmar(f, inicio, (uint32_t)(p - inicio));
+}
+
+// Log binário: o cabeçalho num setor e os blocos cheios pelo gravador, como na placa
+typedef struct
+{
+    FIL arquivo;
+    gravador_t gravador;
+    lb_escritor_t escritor;
+} log_binario_t;
+
+static void log_binario_iniciar(log_binario_t *l, const opcoes_t *o, const imu_t *imu)
+{
+    lb_cabecalho_t cab = {.tipo = o->amostras ? LB_AMOSTRAS : LB_JANELAS,
+                          .estatisticas = o->estatisticas,
+                          .orientacao = o->orientacao,
+                          .num_sensores = 1,
+                          .escala_accel = imu->escala_accel,
+                          .escala_gyro_x10 = imu->escala_gyro_x10,
+                          .odr_hz = imu->taxa_hz,
+                          .janela_amostras = o->janela,
+                          .fator_decimacao = 1,
+                          .comprimido = o->amostras && o->comprimir};
+    gravador_iniciar(&l->gravador, &l->arquivo);
+    lb_montar_cabecalho(&cab, l->escritor.bloco);
+    gravador_escrever(&l->gravador, l->escritor.bloco, LB_BLOCO);
+    lb_iniciar(&l->escritor, &cab);
+}
+
+static void log_binario_gravar(log_binario_t *l, uint32_t seq, const lb_registro_t *r)
+{
+    if (!lb_cabe(&l->escritor, seq, r))
+    {
+        gravador_escrever(&l->gravador, lb_fechar_bloco(&l->escritor), LB_BLOCO);
+        lb_novo_bloco(&l->escritor);
+    }
+    lb_adicionar(&l->escritor, seq, r);
+    if (lb_bloco_cheio(&l->escritor))
+    {
+        gravador_escrever(&l->gravador, lb_fechar_bloco(&l->escritor), LB_BLOCO);
+        lb_novo_bloco(&l->escritor);
+    }
+}
+
+static void log_binario_finalizar(log_binario_t *l)
+{
+    if (l->escritor.registros)
+        gravador_escrever(&l->gravador, lb_fechar_bloco(&l->escritor), LB_BLOCO);
+    gravador_finalizar(&l->gravador);
+}
+
+static double agora_s(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static bool ler_opcoes(int argc, char **argv, opcoes_t *o)
+{
+    *o = (opcoes_t){.estatisticas = AG_MEDIA | AG_MIN | AG_MAX, .passadas = 1};
+    int c;
+    while ((c = getopt(argc, argv, "s:j:e:aqv:n:o:b:l:z")) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            o->sensor = atoi(optarg);
+            break;
+        case 'j':
+            o->janela = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            o->estatisticas = (uint8_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'a':
+            o->amostras = true;
+            break;
+        case 'q':
+            o->orientacao = true;
+            break;
+        case 'v':
+            o->velocidade = strtof(optarg, NULL);
+            break;
+        case 'n':
+            o->passadas = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            o->saida = optarg;
+            break;
+        case 'b':
+            o->binario = optarg;
+            break;
+        case 'l':
+            o->log_binario = optarg;
+            break;
+        case 'z':
+            o->comprimir = true;
+            break;
+        default:
+            return false;
+        }
+    }
+    if (optind != argc - 1 || o->passadas == 0)
+        return false;
+    o->entrada = argv[optind];
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    opcoes_t o;
+    if (!ler_opcoes(argc, argv, &o))
+    {
+        fprintf(stderr, "uso: %s [-s sensor] [-j janela] [-e estatisticas] [-a] [-q] [-v velocidade] "
+                        "[-n passadas] [-o saida.csv] [-b captura.bin] [-l log.bin] [-z] <arquivo>\n", argv[0]);
+        return 2;
+    }
+
+    static imu_replay_t replay;
+    if (!imu_replay_abrir(&replay, o.entrada, o.sensor, o.velocidade))
+    {
+        fprintf(stderr, "ERRO: %s nao e um log CSV nem uma captura binaria\n", o.entrada);
+        return 1;
+    }
+    imu_t *imu = &replay.imu;
+    if (o.janela == 0)
+        o.janela = imu->taxa_hz ? imu->taxa_hz : 1;
+
+    static FIL arquivo;
+    static gravador_t saida;
+    arquivo.arquivo = fopen(o.saida ? o.saida : "/dev/null", "wb");
+    FILE *binario = o.binario ? fopen(o.binario, "wb") : NULL;
+    static log_binario_t log;
+    log.arquivo.arquivo = o.log_binario ? fopen(o.log_binario, "wb") : NULL;
+    if (!arquivo.arquivo || (o.binario && !binario) || (o.log_binario && !log.arquivo.arquivo))
+    {
+        fprintf(stderr, "ERRO: nao foi possivel criar a saida\n");
+        return 1;
+    }
+    fprintf(stderr, "%s: %s, %u Hz, accel %u LSB/g, gyro %u.%u LSB/dps\n", o.entrada,
+            replay.log_binario ? "log binario" : replay.binario ? "captura binaria" : "CSV", imu->taxa_hz, imu->escala_accel,
+            imu->escala_gyro_x10 / 10, imu->escala_gyro_x10 % 10);
+    if (binario)
+        imu_replay_gravar_cabecalho(binario, imu);
+    gravador_iniciar(&saida, &arquivo);
+    if (o.log_binario)
+        log_binario_iniciar(&log, &o, imu);
+
+    ag_agregador_t agregador;
+    ori_filtro_t filtro;
+    uint64_t amostras = 0, linhas = 0;
+    uint32_t seq = 0;
+    double inicio = agora_s();
+    for (uint32_t p = 0; p < o.passadas; p++)
+    {
+        if (!imu_reset(imu) || !ag_iniciar(&agregador, o.janela, o.estatisticas))
+        {
+            fprintf(stderr, "ERRO: janela invalida\n");
+            return 1;
+        }
+        ori_iniciar(&filtro, imu->escala_gyro_x10, imu->taxa_hz ? 1000000 / imu->taxa_hz : 10000,
+                    ORI_KP_PADRAO, ORI_KI_PADRAO);
+        gravar_cabecalho(&saida, &o);
+
+        imu_dados_t d;
+        uint64_t t = 0, inicio_janela_us = 0;
+        while (imu_ler(imu, &d, &t))
+        {
+            amostras++;
+            if (binario && p == 0)
+                imu_replay_gravar_amostra(binario, &d, t);
+
+            int16_t canais[NUM_CANAIS] = {d.accel[0], d.accel[1], d.accel[2], d.gyro[0], d.gyro[1], d.gyro[2], d.temp};
+            if (o.orientacao)
+                ori_atualizar(&filtro, d.accel, d.gyro, t);
+            if (o.amostras)
+            {
+                if (o.log_binario && p == 0)
+                {
+                    lb_registro_t r = {.timestamp_us = t};
+                    memcpy(r.canais, canais, sizeof r.canais);
+                    ori_obter_saida(&filtro, &r.orientacao);
+                    log_binario_gravar(&log, seq, &r);
+                }
+                gravar_amostra(&saida, &o, seq++, t, canais, &filtro);
+                linhas++;
+                continue;
+            }
+            if (agregador.contagem == 0)
+                inicio_janela_us = t;
+            if (ag_adicionar(&agregador, canais))
+            {
+                ag_resultado_t j;
+                ag_fechar(&agregador, &j);
+                if (o.log_binario && p == 0)
+                {
+                    lb_registro_t r = {.timestamp_us = inicio_janela_us, .timestamp_fim_us = t, .janela = j};
+                    ori_obter_saida(&filtro, &r.orientacao);
+                    log_binario_gravar(&log, seq, &r);
+                }
+                gravar_janela(&saida, &o, seq++, inicio_janela_us, t, &j, &filtro);
+                linhas++;
+            }
+        }
+    }
+    gravador_finalizar(&saida);
+    if (o.log_binario)
+        log_binario_finalizar(&log);
+    double tempo = agora_s() - inicio;
+
+    fprintf(stderr, "%llu amostras, %llu linhas em %u passada(s), %.3f s", (unsigned long long)amostras,
+            (unsigned long long)linhas, o.passadas, tempo);
+    fprintf(stderr, ", %llu bytes\n", (unsigned long long)saida.bytes);
+    fprintf(stderr, "%u escritas de %u bytes + %u parciais (%.1f linhas por escrita)\n", saida.escritas,
+            GRAV_BLOCO_BYTES, saida.escritas_parciais,
+            linhas / (double)(arquivo.escritas ? arquivo.escritas : 1));
+    if (amostras && tempo > 0.0)
+        fprintf(stderr, "%.1f ns por amostra, %.0f amostras/s (%.0fx a taxa do arquivo)\n", tempo * 1e9 / amostras,
+                amostras / tempo, imu->taxa_hz ? amostras / tempo / imu->taxa_hz : 0.0);
+    if (replay.linhas_invalidas)
+        fprintf(stderr, "%u linhas invalidas ignoradas\n", replay.linhas_invalidas);
+
+    fclose(arquivo.arquivo);
+    if (binario)
+        fclose(binario);
+    if (o.log_binario)
+    {
+        fprintf(stderr, "log binario: %llu bytes\n", (unsigned long long)log.gravador.bytes);
+        fclose(log.arquivo.arquivo);
+    }
+    imu_replay_fechar(&replay);
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Espectro (lib/espectro.c) de ondas quadradas de fundo de escala, o caso em que
+// a FFT em ponto fixo mais se aproxima de estourar 16 bits. Cada caso confere
+// Parseval (a soma das bandas contra a média quadrática do sinal) e o pico na
+// frequência fundamental; o código de saída é o número de casos que falharam.
+//
+//   teste_espectro
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "espectro.h"
+
+#define ODR_HZ 1000
+#define TOLERANCIA 0.03 // Vazamento da janela para o DC e a Nyquist, que ficam fora das bandas
+
+static esp_analisador_t g_esp;
+static int g_falhas;
+
+static void caso(uint32_t pontos, uint32_t periodo, int16_t amplitude)
+{
+    esp_config_t config = {.pontos = (uint16_t)pontos, .num_bandas = 2, .bordas_hz = {0, 100, ODR_HZ / 2}};
+    if (!esp_iniciar(&g_esp, &config, ODR_HZ))
+    {
+        printf("N=%lu: configuracao recusada\n", (unsigned long)pontos);
+        g_falhas++;
+        return;
+    }
+
+    // ax: quadrada; ay: parado; az: constante, que sai com o DC
+    double soma = 0, soma_quadrados = 0;
+    bool completou = false;
+    for (uint32_t i = 0; i < pontos; i++)
+    {
+        int16_t v = (i % periodo) < periodo / 2 ? amplitude : (int16_t)-amplitude;
+        int16_t eixos[ESP_NUM_EIXOS] = {v, 0, amplitude};
+        soma += v;
+        soma_quadrados += (double)v * v;
+        completou = esp_adicionar(&g_esp, eixos);
+    }
+    esp_resultado_t resultado;
+    esp_calcular(&g_esp, &resultado);
+
+    // Média quadrática sem o DC do bloco, que a análise remove antes da janela
+    double esperado = soma_quadrados / pontos - (soma / pontos) * (soma / pontos);
+    double total = 0;
+    for (uint32_t b = 0; b < config.num_bandas; b++)
+        total += resultado.energia[0][b];
+    double erro = fabs(total - esperado) / esperado;
+    // Pico na fundamental, com a interpolação errando menos de um quarto de bin
+    int pico_esperado = 10 * ODR_HZ / (int)periodo;
+    bool ok = completou && erro < TOLERANCIA &&
+              abs((int)resultado.pico_dhz[0] - pico_esperado) <= 10 * ODR_HZ / (4 * (int)pontos) &&
+              resultado.energia[1][0] == 0 && resultado.energia[1][1] == 0;
+    for (uint32_t b = 0; b < config.num_bandas; b++)
+        ok = ok && resultado.energia[2][b] < esperado * TOLERANCIA;
+
+    printf("N=%3lu periodo=%2lu amplitude=%5d  energia %12.0f (esperado %12.0f, %5.2f%%)  pico %5u dHz  %s\n",
+           (unsigned long)pontos, (unsigned long)periodo, amplitude, total, esperado, 100 * erro,
+           resultado.pico_dhz[0], ok ? "ok" : "FALHOU");
+    if (!ok)
+        g_falhas++;
+}
+
+int main(void)
+{
+    static const uint32_t pontos[] = {16, 32, 64, 256, 512};
+    static const int16_t amplitudes[] = {INT16_MAX, 20000, 1000};
+
+    // Período 8: harmônicas em bins exatos. Período 12: fora dos bins, com vazamento,
+    // e sem harmônica na Nyquist; precisa de blocos de 32 pontos ou mais.
+    for (size_t n = 0; n < sizeof pontos / sizeof pontos[0]; n++)
+        for (size_t a = 0; a < sizeof amplitudes / sizeof amplitudes[0]; a++)
+        {
+            caso(pontos[n], 8, amplitudes[a]);
+            if (pontos[n] >= 32)
+                caso(pontos[n], 12, amplitudes[a]);
+        }
+
+    if (g_falhas)
+        printf("%d caso(s) falharam\n", g_falhas);
+    return g_falhas;
+}
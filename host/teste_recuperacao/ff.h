@@ -0,0 +1,70 @@
+// ff.h (cartão simulado)
+#ifndef FF_H
+#define FF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// O pedaço da API do FatFs que lib/prealocado.c e lib/recuperacao.c usam, sobre um
+// cartão na RAM (teste_recuperacao.c). Os campos e os códigos de erro têm os
+// nomes e os valores do ff15, para o código da placa compilar sem mudanças.
+
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+typedef char TCHAR;
+typedef uint64_t FSIZE_t;
+typedef uint64_t LBA_t;
+
+typedef enum
+{
+    FR_OK = 0,
+    FR_DISK_ERR = 1,
+    FR_INT_ERR = 2,
+    FR_NO_FILE = 4,
+    FR_DENIED = 7,
+    FR_EXIST = 8
+} FRESULT;
+
+typedef struct
+{
+    BYTE pdrv;
+    WORD csize;       // Setores por cluster
+    DWORD n_fatent;   // Clusters + 2
+    LBA_t database;   // Primeiro setor do cluster 2
+} FATFS;
+
+typedef struct
+{
+    FATFS *fs;
+    DWORD sclust;     // Primeiro cluster; 0 sem nenhum
+    FSIZE_t objsize;
+} FFOBJID;
+
+typedef struct
+{
+    FFOBJID obj;
+    BYTE flag;
+    FSIZE_t fptr;
+} FIL;
+
+#define FA_READ 0x01
+#define FA_WRITE 0x02
+#define FA_CREATE_NEW 0x04
+#define FA_CREATE_ALWAYS 0x08
+
+#define f_size(fp) ((fp)->obj.objsize)
+#define f_tell(fp) ((fp)->fptr)
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt);
+FRESULT f_unlink(const TCHAR *path);
+
+#endif // FF_H
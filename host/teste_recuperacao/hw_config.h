@@ -0,0 +1,7 @@
+// hw_config.h (cartão simulado)
+#ifndef HW_CONFIG_H
+#define HW_CONFIG_H
+
+#include "sd_card.h"
+
+#endif // HW_CONFIG_H
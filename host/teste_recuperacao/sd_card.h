@@ -0,0 +1,20 @@
+// sd_card.h (cartão simulado)
+#ifndef SD_CARD_H
+#define SD_CARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Só o acesso em setores do driver do SD, que lib/prealocado.c usa direto
+typedef struct sd_card_t sd_card_t;
+struct sd_card_t
+{
+    int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer, uint64_t ulSectorNumber, uint32_t blockCnt);
+    int (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber, uint32_t blockCnt);
+};
+
+#define SD_BLOCK_DEVICE_ERROR_NONE 0
+
+sd_card_t *sd_get_by_num(size_t num);
+
+#endif // SD_CARD_H
@@ -0,0 +1,341 @@
+// Recuperação depois de um desligamento (lib/recuperacao.c) num cartão simulado na
+// RAM. As sessões são gravadas pelo mesmo caminho da placa (lib/gravador.c, com
+// lib/prealocado.c e lib/log_binario.c) e interrompidas sem fechar o arquivo, como
+// num corte de energia. Cada caso confere o tamanho recuperado contra o fim dos
+// dados válidos no cartão; o código de saída é o número de casos que falharam.
+//
+//   teste_recuperacao
+//
+// O FatFs daqui (ff.h ao lado) tem uma entrada de diretório só e aloca sempre
+// a partir do mesmo cluster: a parte nova cai sobre os setores de uma sessão antiga
+// apagada, o caso em que a reserva traz lixo que parece dados.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ff.h"
+#include "sd_card.h"
+#include "gravador.h"
+#include "log_binario.h"
+#include "prealocado.h"
+#include "recuperacao.h"
+
+#define SETOR 512
+#define SETORES_CARTAO 70000
+#define INICIO_DADOS 100      // fs.database
+#define SETORES_CLUSTER 8
+#define PRIMEIRO_CLUSTER 5    // Onde o f_expand simulado acha espaço
+#define RESERVA (16u << 20)   // Como PREALOCAR_MB=16
+#define SETOR_ARQUIVO (INICIO_DADOS + SETORES_CLUSTER * (PRIMEIRO_CLUSTER - 2))
+
+static uint8_t g_cartao[SETORES_CARTAO * SETOR];
+static sd_card_t g_sd;
+static FATFS g_fs = {.csize = SETORES_CLUSTER, .n_fatent = SETORES_CARTAO / SETORES_CLUSTER,
+                     .database = INICIO_DADOS};
+
+// A única entrada de diretório: o tamanho só muda no f_sync, f_truncate e f_close
+static struct
+{
+    char nome[32];
+    bool existe;
+    DWORD sclust;
+    FSIZE_t tamanho;
+} g_entrada;
+
+// --- Cartão simulado ---
+
+static int escrever_blocos(sd_card_t *sd, const uint8_t *buffer, uint64_t setor, uint32_t n)
+{
+    (void)sd;
+    if (setor + n > SETORES_CARTAO)
+        return -1;
+    memcpy(&g_cartao[setor * SETOR], buffer, (size_t)n * SETOR);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static int ler_blocos(sd_card_t *sd, uint8_t *buffer, uint64_t setor, uint32_t n)
+{
+    (void)sd;
+    if (setor + n > SETORES_CARTAO)
+        return -1;
+    memcpy(buffer, &g_cartao[setor * SETOR], (size_t)n * SETOR);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+sd_card_t *sd_get_by_num(size_t num)
+{
+    return num == 0 ? &g_sd : NULL;
+}
+
+// Byte 'posicao' do arquivo (os clusters são sempre contíguos aqui)
+static uint8_t *dados_arquivo(FSIZE_t posicao)
+{
+    return &g_cartao[(size_t)SETOR_ARQUIVO * SETOR + posicao];
+}
+
+static void atualizar_entrada(FIL *fp)
+{
+    g_entrada.sclust = fp->obj.sclust;
+    g_entrada.tamanho = fp->obj.objsize;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    memset(fp, 0, sizeof *fp);
+    fp->obj.fs = &g_fs;
+    fp->flag = mode;
+    if (mode & (FA_CREATE_NEW | FA_CREATE_ALWAYS))
+    {
+        if (g_entrada.existe && (mode & FA_CREATE_NEW))
+            return FR_EXIST;
+        snprintf(g_entrada.nome, sizeof g_entrada.nome, "%s", path);
+        g_entrada.existe = true;
+        atualizar_entrada(fp);
+        return FR_OK;
+    }
+    if (!g_entrada.existe || strcmp(g_entrada.nome, path) != 0)
+        return FR_NO_FILE;
+    fp->obj.sclust = g_entrada.sclust;
+    fp->obj.objsize = g_entrada.tamanho;
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+    if (fp->flag & FA_WRITE)
+        atualizar_entrada(fp);
+    return FR_OK;
+}
+
+FRESULT f_sync(FIL *fp)
+{
+    atualizar_entrada(fp);
+    return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    FSIZE_t resto = fp->obj.objsize > fp->fptr ? fp->obj.objsize - fp->fptr : 0;
+    if (btr > resto)
+        btr = (UINT)resto;
+    memcpy(buff, dados_arquivo(fp->fptr), btr);
+    fp->fptr += btr;
+    *br = btr;
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    if (fp->obj.sclust == 0)
+        fp->obj.sclust = PRIMEIRO_CLUSTER;
+    memcpy(dados_arquivo(fp->fptr), buff, btw);
+    fp->fptr += btw;
+    if (fp->fptr > fp->obj.objsize)
+        fp->obj.objsize = fp->fptr;
+    *bw = btw;
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp)
+{
+    fp->obj.objsize = fp->fptr;
+    if (fp->obj.objsize == 0)
+        fp->obj.sclust = 0;
+    atualizar_entrada(fp);
+    return FR_OK;
+}
+
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt)
+{
+    (void)opt;
+    if (fp->obj.objsize)
+        return FR_DENIED;
+    fp->obj.sclust = PRIMEIRO_CLUSTER;
+    fp->obj.objsize = fsz;
+    return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path)
+{
+    if (!g_entrada.existe || strcmp(g_entrada.nome, path) != 0)
+        return FR_NO_FILE;
+    g_entrada.existe = false;
+    return FR_OK;
+}
+
+// --- Sessões ---
+
+static FIL g_arquivo;
+static prealocado_t g_reserva;
+static grav_destino_t g_destino;
+static gravador_t g_gravador;
+static lb_escritor_t g_escritor;
+
+// Parte nova no lugar da anterior, que é apagada (os setores dela ficam como estão)
+static void criar_parte(const char *nome, bool reservar)
+{
+    f_unlink(g_entrada.nome);
+    if (reservar)
+    {
+        if (prealocado_criar(&g_reserva, &g_arquivo, nome, RESERVA) != FR_OK)
+            abort();
+        gravador_iniciar(&g_gravador, &g_arquivo);
+        prealocado_como_destino(&g_reserva, &g_destino);
+        gravador_usar_destino(&g_gravador, &g_destino);
+    }
+    else
+    {
+        f_open(&g_arquivo, nome, FA_CREATE_NEW | FA_WRITE);
+        gravador_iniciar(&g_gravador, &g_arquivo);
+    }
+}
+
+// Fim normal, como fechar_arquivo na placa
+static void fechar_parte(bool reservar)
+{
+    gravador_finalizar(&g_gravador);
+    if (reservar)
+        prealocado_fechar(&g_reserva);
+    else
+        f_close(&g_arquivo);
+}
+
+// Fim dos dados no cartão, estejam ou não cobertos pelo diretório
+static FSIZE_t gravado(bool reservar)
+{
+    return reservar ? g_reserva.tamanho : g_arquivo.obj.objsize;
+}
+
+// Sessão binária de 'n' amostras, com o checkpoint a cada 'sync_cada' registros
+static void sessao_binaria(const char *nome, bool reservar, uint32_t sessao, uint32_t n, uint64_t t0,
+                           uint32_t sync_cada)
+{
+    criar_parte(nome, reservar);
+    lb_cabecalho_t cab = {.tipo = LB_AMOSTRAS, .num_sensores = 1, .odr_hz = 1000, .fator_decimacao = 1,
+                          .inicio_us = t0, .sessao = sessao, .parte = 0};
+    lb_montar_cabecalho(&cab, g_escritor.bloco);
+    gravador_escrever(&g_gravador, g_escritor.bloco, LB_BLOCO);
+    lb_iniciar(&g_escritor, &cab);
+    for (uint32_t seq = 0; seq < n; seq++)
+    {
+        lb_registro_t r = {.timestamp_us = t0 + seq * 1000ull};
+        r.canais[0] = (int16_t)seq;
+        if (!lb_cabe(&g_escritor, seq, &r))
+        {
+            gravador_escrever(&g_gravador, lb_fechar_bloco(&g_escritor), LB_BLOCO);
+            lb_novo_bloco(&g_escritor);
+        }
+        lb_adicionar(&g_escritor, seq, &r);
+        if (lb_bloco_cheio(&g_escritor))
+        {
+            gravador_escrever(&g_gravador, lb_fechar_bloco(&g_escritor), LB_BLOCO);
+            lb_novo_bloco(&g_escritor);
+        }
+        if (seq % sync_cada == sync_cada - 1)
+            gravador_sincronizar_cauda(&g_gravador, lb_fechar_bloco(&g_escritor), LB_BLOCO);
+        gravador_gravar_prontos(&g_gravador, UINT32_MAX);
+    }
+}
+
+// Sessão CSV de 'n' linhas com valores aleatórios: uma sessão antiga não repete os bytes da nova
+static void sessao_csv(const char *nome, bool reservar, uint32_t sessao, uint32_t n, uint64_t t0,
+                       uint32_t sync_cada)
+{
+    criar_parte(nome, reservar);
+    gravador_printf(&g_gravador, "seq;sensor;timestamp_us;ax;ay;az\n# sessao=%lu;parte=0;inicio=2026-01-01 10:00:00\n"
+                                 "# odr_hz=1000\n", (unsigned long)sessao);
+    srand(sessao * 7919u);
+    for (uint32_t seq = 0; seq < n; seq++)
+    {
+        gravador_printf(&g_gravador, "%lu;0;%llu;%d;%d;%d\n", (unsigned long)seq,
+                        (unsigned long long)(t0 + seq * 1000ull), rand() % 32768 - 16384,
+                        rand() % 32768 - 16384, rand() % 32768 - 16384);
+        if (seq % sync_cada == sync_cada - 1)
+            gravador_sincronizar(&g_gravador);
+        gravador_gravar_prontos(&g_gravador, UINT32_MAX);
+    }
+}
+
+// Fim da última linha completa antes de 'fim'
+static FSIZE_t ultima_linha(FSIZE_t fim)
+{
+    while (fim && *dados_arquivo(fim - 1) != '\n')
+        fim--;
+    return fim;
+}
+
+static int g_falhas;
+
+static void conferir(const char *caso, const char *nome, bool binario, uint32_t sessao, bool reservar,
+                     FSIZE_t esperado, bool removido)
+{
+    rec_arquivo_t a = {.binario = binario, .sessao = sessao, .parte = 0, .reservado = reservar ? RESERVA : 0};
+    rec_resultado_t r;
+    FRESULT fr = rec_recuperar(nome, &a, &r);
+    bool ok = fr == FR_OK && r.tamanho == esperado && r.removido == removido &&
+              (removido || (g_entrada.existe && g_entrada.tamanho == esperado));
+    printf("%-40s %9llu -> %9llu (esperado %9llu), %3lu setores lidos%s  %s\n", caso,
+           (unsigned long long)r.tamanho_anterior, (unsigned long long)r.tamanho, (unsigned long long)esperado,
+           (unsigned long)r.setores_lidos, r.removido ? ", removido" : "", ok ? "OK" : "FALHOU");
+    if (!ok)
+        g_falhas++;
+}
+
+int main(void)
+{
+    g_sd.write_blocks = escrever_blocos;
+    g_sd.read_blocks = ler_blocos;
+
+    // Binário: uma sessão antiga, longa, deixou blocos válidos (de outra marca) na
+    // reserva; a nova desliga no meio, depois de vários checkpoints
+    sessao_binaria("a.bin", true, 1, 200000, 1000000000ull, 5000);
+    fechar_parte(true);
+    sessao_binaria("b.bin", true, 2, 100000, 2000000ull, 3000);
+    conferir("binario: reserva sobre sessao antiga", "b.bin", true, 2, true, gravado(true), false);
+
+    // O cabeçalho é de outra sessão: nada além do tamanho no diretório
+    sessao_binaria("c.bin", true, 2, 50000, 2000000ull, 3000);
+    FSIZE_t diretorio = g_entrada.tamanho;
+    conferir("binario: cabecalho de outra sessao", "c.bin", true, 3, true, diretorio, false);
+
+    // Desligou antes do primeiro checkpoint: só a reserva tem os dados
+    sessao_binaria("d.bin", true, 4, 20000, 3000000ull, UINT32_MAX);
+    conferir("binario: sem nenhum checkpoint", "d.bin", true, 4, true, gravado(true), false);
+
+    // Sem reserva: o último bloco dentro do tamanho ficou pela metade
+    sessao_binaria("e.bin", false, 5, 30000, 2000000ull, 3000);
+    fechar_parte(false);
+    FSIZE_t fim = g_entrada.tamanho;
+    memset(dados_arquivo(fim - SETOR + 100), 0xAB, 50);
+    conferir("binario: sem reserva, bloco rasgado", "e.bin", true, 5, false, fim - SETOR, false);
+
+    // CSV: a sessão antiga tem as mesmas sequências, mas em outro tempo e com outros valores
+    sessao_csv("a.csv", true, 1, 300000, 900000000ull, 7000);
+    fechar_parte(true);
+    sessao_csv("b.csv", true, 2, 150000, 5000000ull, 7000);
+    conferir("csv: reserva sobre sessao antiga", "b.csv", false, 2, true, ultima_linha(gravado(true)), false);
+
+    // Desligou antes do primeiro checkpoint (tamanho 0 no diretório)
+    sessao_csv("c.csv", true, 3, 3000, 8000000ull, UINT32_MAX);
+    conferir("csv: sem nenhum checkpoint", "c.csv", false, 3, true, ultima_linha(gravado(true)), false);
+
+    // Sem reserva: o tamanho no diretório corta a última linha
+    sessao_csv("d.csv", false, 4, 20000, 5000000ull, 7000);
+    fechar_parte(false);
+    g_entrada.tamanho -= 7;
+    conferir("csv: sem reserva, linha rasgada", "d.csv", false, 4, false, ultima_linha(g_entrada.tamanho), false);
+
+    // Parte criada para a troca seguinte e nunca usada, sobre os setores de outra
+    criar_parte("e.csv", true);
+    conferir("parte vazia", "e.csv", false, 6, true, 0, true);
+
+    if (g_falhas)
+        printf("%d caso(s) falharam\n", g_falhas);
+    return g_falhas;
+}
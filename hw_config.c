@@ -9,6 +9,8 @@
 #include "ff.h" /* Obtains integer types */
 //
 #include "diskio.h" /* Declarations of disk functions */
+//
+#include "lib/mpu6050.h"
 
 /* 
 This example assumes the following hardware configuration:
@@ -52,6 +54,22 @@ static sd_card_t sd_cards[] = {  // One for each SD card
                                  // present.
     }};
 
+// Hardware Configuration of the MPU6050 "objects" (up to AQ_MAX_SENSORES).
+// Two sensors share a bus with different AD0 levels (0x68 low, 0x69 high).
+// Sensors on i2c1 use the display pins (GPIO 14 and 15); the sample rate and
+// full scales are set by the application, the same for every sensor.
+// Every entry sets .int_gpio: left out, it would be GPIO 0 (I2C0 SDA).
+static mpu6050_t mpus[] = {  // One for each MPU6050
+    {
+        .i2c = i2c0,      // I2C block (SDA GPIO 0, SCL GPIO 1)
+        .addr = 0x68,     // AD0 low
+        .int_gpio = 8     // INT pin, used in data-ready mode (first sensor only)
+    },
+    // {.i2c = i2c0, .addr = 0x69, .int_gpio = MPU6050_SEM_INT},
+    // {.i2c = i2c1, .addr = 0x68, .int_gpio = MPU6050_SEM_INT},
+    // {.i2c = i2c1, .addr = 0x69, .int_gpio = MPU6050_SEM_INT},
+};
+
 /* ********************************************************************** */
 size_t sd_get_num() { return count_of(sd_cards); }
 sd_card_t *sd_get_by_num(size_t num) {
@@ -71,5 +89,14 @@ spi_t *spi_get_by_num(size_t num) {
         return NULL;
     }
 }
+size_t mpu_get_num() { return count_of(mpus); }
+mpu6050_t *mpu_get_by_num(size_t num) {
+    assert(num < mpu_get_num());
+    if (num < mpu_get_num()) {
+        return &mpus[num];
+    } else {
+        return NULL;
+    }
+}
 
 /* [] END OF FILE */
@@ -0,0 +1,129 @@
+#include "agregacao.h"
+#include <string.h>
+
+static const char *const nomes_estatisticas[AG_NUM_ESTATISTICAS] = {"avg", "min", "max", "rms", "var"};
+
+static void zerar_janela(ag_agregador_t *ag)
+{
+    ag->contagem = 0;
+    memset(ag->soma, 0, sizeof ag->soma);
+    memset(ag->soma_quadrados, 0, sizeof ag->soma_quadrados);
+    for (int c = 0; c < AG_NUM_CANAIS; c++)
+    {
+        ag->min[c] = INT16_MAX;
+        ag->max[c] = INT16_MIN;
+    }
+}
+
+// Divisão com arredondamento para o inteiro mais próximo (metade para longe do zero)
+static int32_t dividir_arredondando(int32_t num, uint32_t den)
+{
+    if (num >= 0)
+        return (int32_t)(((uint32_t)num + den / 2) / den);
+    return -(int32_t)(((uint32_t)-(int64_t)num + den / 2) / den);
+}
+
+// Raiz quadrada inteira arredondada, bit a bit (sem float no M0+)
+static uint32_t raiz_arredondada(uint32_t v)
+{
+    uint32_t raiz = 0;
+    uint32_t bit = 1u << 30;
+    uint32_t resto = v;
+    while (bit > resto)
+        bit >>= 2;
+    while (bit)
+    {
+        if (resto >= raiz + bit)
+        {
+            resto -= raiz + bit;
+            raiz = (raiz >> 1) + bit;
+        }
+        else
+        {
+            raiz >>= 1;
+        }
+        bit >>= 2;
+    }
+    // (raiz + 0,5)² = raiz² + raiz + 0,25: acima disso, arredonda para cima
+    return resto > raiz ? raiz + 1 : raiz;
+}
+
+bool ag_iniciar(ag_agregador_t *ag, uint32_t janela, uint8_t estatisticas)
+{
+    if (janela == 0 || janela > AG_JANELA_MAX)
+        return false;
+    ag->janela = janela;
+    ag->estatisticas = estatisticas & AG_TODAS;
+    zerar_janela(ag);
+    return true;
+}
+
+bool ag_adicionar(ag_agregador_t *ag, const int16_t amostra[AG_NUM_CANAIS])
+{
+    // A soma também serve à variância; os quadrados só são acumulados se alguém usar
+    for (int c = 0; c < AG_NUM_CANAIS; c++)
+        ag->soma[c] += amostra[c];
+
+    if (ag->estatisticas & (AG_MIN | AG_MAX))
+    {
+        for (int c = 0; c < AG_NUM_CANAIS; c++)
+        {
+            if (amostra[c] < ag->min[c])
+                ag->min[c] = amostra[c];
+            if (amostra[c] > ag->max[c])
+                ag->max[c] = amostra[c];
+        }
+    }
+
+    if (ag->estatisticas & (AG_RMS | AG_VARIANCIA))
+    {
+        for (int c = 0; c < AG_NUM_CANAIS; c++)
+            ag->soma_quadrados[c] += (uint32_t)((int32_t)amostra[c] * amostra[c]);
+    }
+
+    return ++ag->contagem >= ag->janela;
+}
+
+void ag_fechar(ag_agregador_t *ag, ag_resultado_t *resultado)
+{
+    uint32_t n = ag->contagem;
+    if (n == 0)
+    {
+        memset(resultado, 0, sizeof *resultado);
+        return;
+    }
+
+    for (int c = 0; c < AG_NUM_CANAIS; c++)
+    {
+        if (ag->estatisticas & AG_MEDIA)
+            resultado->media[c] = (int16_t)dividir_arredondando(ag->soma[c], n);
+        resultado->min[c] = ag->min[c];
+        resultado->max[c] = ag->max[c];
+
+        // A média dos quadrados de valores de 16 bits nunca passa de 2^30
+        if (ag->estatisticas & AG_RMS)
+        {
+            uint32_t quadrado_medio = (uint32_t)((ag->soma_quadrados[c] + n / 2) / n);
+            uint32_t rms = raiz_arredondada(quadrado_medio);
+            resultado->rms[c] = rms > UINT16_MAX ? UINT16_MAX : (uint16_t)rms;
+        }
+
+        // Var = (n·Σx² - (Σx)²) / n². As somas são inteiros exatos, então não há o
+        // cancelamento que motiva Welford em ponto flutuante, e nenhuma divisão por amostra.
+        // Com n < 2^16 os dois termos ficam abaixo de 2^62.
+        if (ag->estatisticas & AG_VARIANCIA)
+        {
+            int64_t soma = ag->soma[c];
+            uint64_t numerador = (uint64_t)n * ag->soma_quadrados[c] - (uint64_t)(soma * soma);
+            uint64_t n2 = (uint64_t)n * n;
+            resultado->variancia[c] = (uint32_t)((numerador + n2 / 2) / n2);
+        }
+    }
+
+    zerar_janela(ag);
+}
+
+const char *ag_nome_estatistica(uint32_t indice)
+{
+    return indice < AG_NUM_ESTATISTICAS ? nomes_estatisticas[indice] : "";
+}
@@ -0,0 +1,63 @@
+// agregacao.h
+#ifndef AGREGACAO_H
+#define AGREGACAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Canais agregados: ax, ay, az, gx, gy, gz, temp
+#define AG_NUM_CANAIS 7
+
+// Maior janela: a soma de 65535 amostras de 16 bits ainda cabe em int32
+#define AG_JANELA_MAX 65535u
+
+// Estatísticas por canal, combináveis em uma máscara
+typedef enum
+{
+    AG_MEDIA = 1u << 0,     // Média arredondada (metade para longe do zero)
+    AG_MIN = 1u << 1,       // Menor valor da janela
+    AG_MAX = 1u << 2,       // Maior valor da janela
+    AG_RMS = 1u << 3,       // Raiz da média dos quadrados, arredondada
+    AG_VARIANCIA = 1u << 4, // Variância populacional em LSB², arredondada
+} ag_estatistica_t;
+
+#define AG_NUM_ESTATISTICAS 5
+#define AG_TODAS 0x1Fu
+
+// Resultado de uma janela. Só os campos das estatísticas habilitadas são preenchidos.
+typedef struct
+{
+    int16_t media[AG_NUM_CANAIS];
+    int16_t min[AG_NUM_CANAIS];
+    int16_t max[AG_NUM_CANAIS];
+    uint16_t rms[AG_NUM_CANAIS];
+    uint32_t variancia[AG_NUM_CANAIS]; // Até 2^30 LSB² para valores de 16 bits
+} ag_resultado_t;
+
+// Acumuladores de uma janela. Cada amostra custa somas e comparações inteiras
+// (e um produto 16x16 por canal se RMS ou variância estiverem habilitados);
+// as divisões e a raiz quadrada ficam para o fechamento da janela.
+typedef struct
+{
+    uint32_t janela;
+    uint8_t estatisticas; // Máscara de ag_estatistica_t
+    uint32_t contagem;
+    int32_t soma[AG_NUM_CANAIS];
+    uint64_t soma_quadrados[AG_NUM_CANAIS];
+    int16_t min[AG_NUM_CANAIS];
+    int16_t max[AG_NUM_CANAIS];
+} ag_agregador_t;
+
+// Prepara uma janela de 'janela' amostras (1 a AG_JANELA_MAX). Retorna false se o tamanho for inválido.
+bool ag_iniciar(ag_agregador_t *ag, uint32_t janela, uint8_t estatisticas);
+
+// Acumula uma amostra. Retorna true quando a janela completou e pode ser fechada.
+bool ag_adicionar(ag_agregador_t *ag, const int16_t amostra[AG_NUM_CANAIS]);
+
+// Calcula as estatísticas das amostras acumuladas e zera a janela
+void ag_fechar(ag_agregador_t *ag, ag_resultado_t *resultado);
+
+// Sufixo da coluna de cada estatística no log ("avg", "min", ...), na ordem dos bits
+const char *ag_nome_estatistica(uint32_t indice);
+
+#endif // AGREGACAO_H
@@ -0,0 +1,1090 @@
+#include "aquisicao.h"
+#include <math.h>
+#include <string.h>
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/critical_section.h"
+#include "pico/flash.h"
+#include "pico/multicore.h"
+#include "fila_spsc.h"
+#include "i2c_dma.h"
+
+static aq_config_t g_config;
+static volatile bool g_ativo = false;
+static repeating_timer_t g_timer;
+// Pool de alarmes do core que atende a aquisição (o timer dispara no core que criou o pool)
+static alarm_pool_t *g_alarm_pool;
+
+// Rajada máxima: a FIFO inteira em quadros completos
+#define RAJADA_MAX_LEN (MPU6050_FIFO_MAX_QUADROS * MPU6050_FIFO_QUADRO_LEN)
+
+// Caminho de amostragem de um sensor
+typedef struct
+{
+    const mpu6050_t *mpu;
+    imu_t imu;      // O mesmo sensor pela interface genérica, para as leituras bloqueantes
+    uint8_t indice; // Posição na tabela, gravada em cada registro
+
+    // Estatísticas da janela corrente
+    ag_agregador_t agregador;
+    uint64_t inicio_janela_us; // Captura da primeira amostra da janela
+
+    // Decimação das amostras publicadas
+    dec_decimador_t decimador;
+
+    // Espectro: o caminho de amostragem enche os blocos e a FFT roda fora da IRQ
+    esp_analisador_t espectro;
+    uint64_t inicio_bloco_us;
+    uint64_t espectro_inicio_us, espectro_fim_us; // Bloco pendente
+
+    ori_filtro_t orientacao;
+
+    // Correção do bias do giroscópio, definida pelo core 0 entre sessões
+    cal_gyro_t calibracao;
+    bool calibracao_ativa;
+
+    // Detector de lacunas: compara o timestamp de cada amostra com o da anterior
+    uint64_t timestamp_anterior_us;
+
+    // Média do acelerômetro na última janela parada (referência na taxa baixa)
+    int16_t accel_repouso[3];
+
+    // Destinos do DMA
+    uint8_t bloco[MPU6050_BLOCO_DADOS_LEN];
+    uint8_t rajada[RAJADA_MAX_LEN];
+    uint8_t status_fifo;      // INT_STATUS
+    uint8_t contagem_fifo[2]; // FIFO_COUNTH, FIFO_COUNTL
+    uint8_t user_ctrl;        // Releitura depois do reset da FIFO (descartada)
+    uint16_t quadros_rajada;
+    uint64_t timestamp_rajada_us; // Instante em que a FIFO foi contada
+} sensor_t;
+
+static sensor_t g_sensores[AQ_MAX_SENSORES];
+static uint8_t g_num_sensores;
+
+// Atraso de grupo da decimação já convertido para o timestamp (igual em todos os sensores)
+static uint32_t g_atraso_decimacao_us;
+
+// Captura por evento. As amostras do anel saem para a fila aos poucos, algumas por
+// amostra nova, deixando folga na fila para as janelas e os espectros.
+#define PUBLICACOES_POR_AMOSTRA 4
+#define FOLGA_FILA 16
+static gat_captura_t g_gatilho;
+static volatile bool g_disparo_manual;
+
+// Fusão accel+gyro a cada amostra. O core 0 lê uma cópia da do primeiro sensor,
+// renovada a cada g_intervalo_orientacao amostras para não calcular os ângulos em toda IRQ.
+static uint32_t g_intervalo_orientacao, g_amostras_orientacao;
+static ori_saida_t g_orientacao_atual;
+static bool g_orientacao_valida;
+static critical_section_t g_cs_orientacao;
+
+// Registros prontos, do produtor (IRQs de aquisição) para o consumidor (loop principal)
+static aq_registro_t g_fila_buffer[AQ_PROFUNDIDADE_FILA];
+static fila_spsc_t g_fila;
+
+// Atualizados no core de aquisição; cada campo é lido isoladamente pelo core 0.
+// registros_descartados vem da própria fila.
+static volatile aq_contadores_t g_contadores;
+
+// Intervalo acima do qual duas amostras seguidas de um sensor são uma lacuna, e o
+// período em vigor (muda com a taxa adaptativa)
+static uint32_t g_limite_lacuna_us;
+static uint32_t g_periodo_atual_us;
+
+// Taxa adaptativa. As janelas decidem a descida e as amostras na taxa baixa, a
+// subida; a troca em si (registradores dos sensores e período do timer) acontece
+// no tick seguinte, com os barramentos livres.
+static uint32_t g_limiar_var_accel, g_limiar_var_gyro; // Soma das variâncias dos 3 eixos, LSB²
+static int16_t g_limiar_movimento;                    // LSB do accel
+static bool g_em_repouso;
+static volatile bool g_troca_pendente;
+static uint8_t g_janelas_paradas;
+static uint8_t g_sensores_parados; // Bit por sensor com a janela corrente parada
+static uint64_t g_inicio_repouso_us;
+static uint32_t g_tempo_repouso_ms;
+
+// Intervalos entre amostras. Os desvios em relação ao período nominal são pequenos,
+// então as somas cabem em inteiros mesmo em sessões longas.
+static uint32_t g_periodo_nominal_us;
+static uint64_t g_ultimo_timestamp_us;
+static uint32_t g_intervalos;
+static uint32_t g_intervalo_min_us, g_intervalo_max_us;
+static int64_t g_soma_desvio_us;
+static uint64_t g_soma_desvio2_us;
+// As estatísticas são atualizadas no core de aquisição e lidas no core 0
+static critical_section_t g_cs_jitter;
+
+// Leituras feitas pelo DMA: a IRQ de disparo só inicia a transferência e a
+// amostra é publicada pela IRQ de conclusão do DMA. Cada bloco I2C lê os seus
+// sensores em cadeia (a conclusão de um inicia o próximo) e os dois blocos
+// transferem em paralelo.
+typedef struct
+{
+    i2c_dma_t dma;
+    bool pronto; // Canais reservados (ficam assim entre sessões)
+    uint8_t sensores[AQ_MAX_SENSORES];
+    uint8_t num_sensores;
+    uint8_t atual;         // Posição em 'sensores' da leitura em andamento
+    uint64_t timestamp_us; // Instante do disparo da rodada
+} barramento_t;
+
+static barramento_t g_barramentos[2]; // Indexado por i2c_get_index
+
+// Numera o registro e entrega ao loop principal, que grava no arquivo quando puder.
+// A sequência avança mesmo se a fila estiver cheia, para o salto aparecer no log.
+static void publicar(aq_registro_t *registro)
+{
+    registro->sequencia = g_contadores.registros_gerados++;
+    fila_spsc_inserir(&g_fila, registro);
+}
+
+static void detectar_lacuna(sensor_t *s, uint64_t timestamp_us)
+{
+    if (s->timestamp_anterior_us != 0)
+    {
+        uint32_t intervalo = (uint32_t)(timestamp_us - s->timestamp_anterior_us);
+        if (intervalo > g_limite_lacuna_us)
+        {
+            // Arredonda a lacuna para o número de períodos mais próximo
+            g_contadores.lacunas++;
+            g_contadores.amostras_faltando += (intervalo + g_periodo_atual_us / 2) / g_periodo_atual_us - 1;
+        }
+    }
+    s->timestamp_anterior_us = timestamp_us;
+}
+
+// Calcula o espectro do bloco pendente e publica o resultado. Roda fora das IRQs
+// de aquisição (no laço do core 1), mas publica com elas desligadas: para a fila,
+// o core continua sendo um único produtor.
+static void processar_espectro_pendente(sensor_t *s)
+{
+    aq_registro_t registro = {.timestamp_inicio_us = s->espectro_inicio_us,
+                              .timestamp_fim_us = s->espectro_fim_us,
+                              .tipo = AQ_REGISTRO_ESPECTRO,
+                              .sensor = s->indice};
+    esp_calcular(&s->espectro, &registro.espectro);
+
+    uint32_t interrupcoes = save_and_disable_interrupts();
+    publicar(&registro);
+    restore_interrupts(interrupcoes);
+}
+
+static void sinalizar_espectro_pendente(sensor_t *s)
+{
+#if AQ_NO_CORE1
+    (void)s;
+    __sev(); // Acorda o laço do core 1
+#else
+    processar_espectro_pendente(s); // Sem o core 1, a FFT roda na própria IRQ
+#endif
+}
+
+static void processar_espectros_pendentes(void)
+{
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+        if (g_sensores[i].espectro.pendente)
+            processar_espectro_pendente(&g_sensores[i]);
+}
+
+static void atualizar_orientacao(sensor_t *s, const mpu6050_dados_t *dados, uint64_t timestamp_us)
+{
+    ori_atualizar(&s->orientacao, dados->accel, dados->gyro, timestamp_us);
+    if (s->indice != 0 || ++g_amostras_orientacao < g_intervalo_orientacao)
+        return;
+    g_amostras_orientacao = 0;
+
+    ori_saida_t saida;
+    ori_obter_saida(&s->orientacao, &saida);
+    critical_section_enter_blocking(&g_cs_orientacao);
+    g_orientacao_atual = saida;
+    g_orientacao_valida = true;
+    critical_section_exit(&g_cs_orientacao);
+}
+
+// Publica amostras de evento enquanto houver folga na fila (no máximo 'limite')
+static void publicar_amostras_evento(uint32_t limite)
+{
+    gat_amostra_t a;
+    uint32_t livre_ate = fila_spsc_capacidade(&g_fila) - FOLGA_FILA;
+    for (uint32_t n = 0; n < limite && fila_spsc_ocupacao(&g_fila) < livre_ate; n++)
+    {
+        if (!gat_proxima(&g_gatilho, &a))
+            break;
+        aq_registro_t amostra = {.timestamp_inicio_us = a.timestamp_us,
+                                 .timestamp_fim_us = a.timestamp_us,
+                                 .tipo = AQ_REGISTRO_AMOSTRA,
+                                 .sensor = a.sensor};
+        memcpy(amostra.canais, a.canais, sizeof amostra.canais);
+        if (g_config.orientacao)
+            ori_saida_de_q14(a.q, &amostra.orientacao);
+        publicar(&amostra);
+    }
+}
+
+static void processar_gatilho(sensor_t *s, const int16_t canais[AQ_NUM_CANAIS], uint64_t timestamp_us)
+{
+    gat_amostra_t a = {.timestamp_us = timestamp_us, .sensor = s->indice};
+    memcpy(a.canais, canais, sizeof a.canais);
+    if (g_config.orientacao)
+        ori_quaternion_q14(&s->orientacao, a.q);
+
+    bool forcar = g_disparo_manual;
+    if (forcar)
+        g_disparo_manual = false;
+    aq_registro_t registro = {.timestamp_inicio_us = timestamp_us,
+                              .timestamp_fim_us = timestamp_us,
+                              .tipo = AQ_REGISTRO_EVENTO};
+    if (gat_adicionar(&g_gatilho, &a, forcar, &registro.evento))
+    {
+        registro.sensor = registro.evento.sensor;
+        publicar(&registro);
+    }
+
+    publicar_amostras_evento(PUBLICACOES_POR_AMOSTRA);
+}
+
+// Decide a taxa pela janela que fechou: todos os sensores parados por
+// janelas_repouso janelas baixam a taxa; qualquer janela agitada na taxa baixa a sobe
+static void avaliar_janela_adaptativa(sensor_t *s, const ag_resultado_t *janela)
+{
+    uint32_t var_accel = janela->variancia[0] + janela->variancia[1] + janela->variancia[2];
+    uint32_t var_gyro = janela->variancia[3] + janela->variancia[4] + janela->variancia[5];
+    bool parada = var_accel <= g_limiar_var_accel && (g_em_repouso || var_gyro <= g_limiar_var_gyro);
+
+    if (g_em_repouso)
+    {
+        if (!parada)
+            g_troca_pendente = true;
+        return;
+    }
+    if (!parada)
+    {
+        g_janelas_paradas = 0;
+        g_sensores_parados = 0;
+        return;
+    }
+    memcpy(s->accel_repouso, janela->media, sizeof s->accel_repouso);
+    g_sensores_parados |= (uint8_t)(1u << s->indice);
+    if (g_sensores_parados != (1u << g_num_sensores) - 1)
+        return;
+    g_sensores_parados = 0;
+    if (++g_janelas_paradas >= g_config.adaptativa.janelas_repouso)
+        g_troca_pendente = true;
+}
+
+// Na taxa baixa: uma amostra longe da média parada acorda sem esperar a janela
+static void detectar_movimento(const sensor_t *s, const int16_t accel[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t desvio = accel[i] - s->accel_repouso[i];
+        if (desvio > g_limiar_movimento || desvio < -g_limiar_movimento)
+        {
+            g_troca_pendente = true;
+            return;
+        }
+    }
+}
+
+static void fechar_janela(sensor_t *s, uint64_t timestamp_fim_us)
+{
+    uint32_t amostras = s->agregador.contagem;
+    aq_registro_t registro = {.timestamp_inicio_us = s->inicio_janela_us,
+                              .timestamp_fim_us = timestamp_fim_us,
+                              .tipo = AQ_REGISTRO_JANELA,
+                              .sensor = s->indice};
+    ag_fechar(&s->agregador, &registro.janela);
+
+    if (g_config.adaptativa.habilitada && !g_troca_pendente)
+        avaliar_janela_adaptativa(s, &registro.janela);
+
+    if (g_config.publicar_janelas)
+    {
+        g_contadores.amostras_agregadas += amostras;
+        if (g_config.orientacao)
+            ori_obter_saida(&s->orientacao, &registro.orientacao);
+        publicar(&registro);
+    }
+}
+
+static void processar_amostra(sensor_t *s, const mpu6050_dados_t *leitura, uint64_t timestamp_us)
+{
+    mpu6050_dados_t dados = *leitura;
+    if (s->calibracao_ativa)
+        cal_corrigir_gyro(&s->calibracao, dados.gyro, dados.temp);
+
+    g_contadores.amostras_adquiridas++;
+    detectar_lacuna(s, timestamp_us);
+
+    int16_t canais[AQ_NUM_CANAIS];
+    for (int i = 0; i < 3; i++)
+    {
+        canais[i] = dados.accel[i];
+        canais[3 + i] = dados.gyro[i];
+    }
+    canais[6] = dados.temp;
+
+    if (g_em_repouso && !g_troca_pendente)
+        detectar_movimento(s, dados.accel);
+
+    if (g_config.orientacao)
+        atualizar_orientacao(s, &dados, timestamp_us);
+
+    aq_registro_t amostra;
+    if (g_config.publicar_amostras && dec_adicionar(&s->decimador, canais, amostra.canais))
+    {
+        amostra.timestamp_inicio_us = timestamp_us - g_atraso_decimacao_us;
+        amostra.timestamp_fim_us = amostra.timestamp_inicio_us;
+        amostra.tipo = AQ_REGISTRO_AMOSTRA;
+        amostra.sensor = s->indice;
+        if (g_config.orientacao)
+            ori_obter_saida(&s->orientacao, &amostra.orientacao);
+        publicar(&amostra);
+    }
+
+    if (g_config.gatilho.tipo != GAT_DESLIGADO)
+        processar_gatilho(s, canais, timestamp_us);
+
+    // As bandas são da taxa plena: na taxa baixa o espectro espera
+    if (g_config.espectro.pontos && !g_em_repouso)
+    {
+        if (s->espectro.preenchidas == 0)
+            s->inicio_bloco_us = timestamp_us;
+        if (esp_adicionar(&s->espectro, canais))
+        {
+            s->espectro_inicio_us = s->inicio_bloco_us;
+            s->espectro_fim_us = timestamp_us;
+            sinalizar_espectro_pendente(s);
+        }
+    }
+
+    if (s->agregador.contagem == 0)
+        s->inicio_janela_us = timestamp_us;
+    if (ag_adicionar(&s->agregador, canais))
+        fechar_janela(s, timestamp_us);
+}
+
+static void registrar_intervalo(uint64_t agora_us)
+{
+    critical_section_enter_blocking(&g_cs_jitter);
+    if (g_ultimo_timestamp_us != 0)
+    {
+        uint32_t intervalo = (uint32_t)(agora_us - g_ultimo_timestamp_us);
+        int32_t desvio = (int32_t)intervalo - (int32_t)g_periodo_nominal_us;
+        if (intervalo < g_intervalo_min_us)
+            g_intervalo_min_us = intervalo;
+        if (intervalo > g_intervalo_max_us)
+            g_intervalo_max_us = intervalo;
+        g_soma_desvio_us += desvio;
+        g_soma_desvio2_us += (uint64_t)((int64_t)desvio * desvio);
+        g_intervalos++;
+    }
+    g_ultimo_timestamp_us = agora_us;
+    critical_section_exit(&g_cs_jitter);
+}
+
+static void processar_rajada(sensor_t *s, uint16_t quadros)
+{
+    for (uint16_t q = 0; q < quadros; q++)
+    {
+        // O último quadro é o mais recente; os anteriores estão espaçados de um período do ODR
+        uint64_t timestamp = s->timestamp_rajada_us - (uint64_t)(quadros - 1 - q) * g_periodo_nominal_us;
+        mpu6050_dados_t dados;
+        mpu6050_decodificar(&s->rajada[q * MPU6050_FIFO_QUADRO_LEN], &dados);
+        processar_amostra(s, &dados, timestamp);
+    }
+}
+
+// Quadros completos na FIFO pelo INT_STATUS e pela contagem lidos; false se ela
+// transbordou ou perdeu o alinhamento e precisa ser esvaziada
+static bool quadros_fifo(sensor_t *s, bool overflow, uint16_t bytes)
+{
+    s->timestamp_rajada_us = time_us_64();
+
+    // Após um transbordo o sensor descarta bytes antigos e os quadros perdem o alinhamento:
+    // a única forma segura de voltar a ler quadros válidos é esvaziar a FIFO.
+    if (overflow || bytes >= MPU6050_FIFO_TAMANHO || bytes % MPU6050_FIFO_QUADRO_LEN)
+    {
+        g_contadores.ressincronizacoes_fifo++;
+        return false;
+    }
+    s->quadros_rajada = bytes / MPU6050_FIFO_QUADRO_LEN;
+    return true;
+}
+
+#if AQ_USAR_DMA
+// Informa se a rodada anterior ainda ocupa o barramento. Se um NACK a cancelou, a
+// leitura em andamento e as dos sensores seguintes da cadeia não aconteceram.
+static bool barramento_ocupado(barramento_t *b)
+{
+    uint32_t abortos = b->dma.abortos;
+    if (i2c_dma_ocupado(&b->dma))
+        return true;
+    if (b->dma.abortos != abortos)
+        g_contadores.leituras_perdidas += b->num_sensores - b->atual;
+    return false;
+}
+
+static void bloco_lido(void *contexto);
+
+// Inicia a leitura do próximo sensor da rodada no barramento
+static void ler_proximo_bloco(barramento_t *b)
+{
+    for (; b->atual < b->num_sensores; b->atual++)
+    {
+        sensor_t *s = &g_sensores[b->sensores[b->atual]];
+        if (i2c_dma_ler_registradores(&b->dma, s->mpu->addr, MPU6050_REG_ACCEL_XOUT_H,
+                                      s->bloco, sizeof s->bloco, bloco_lido, b))
+            return;
+        g_contadores.leituras_perdidas++;
+    }
+}
+
+// Conclusão do DMA do bloco 0x3B..0x48 (contexto da IRQ de DMA)
+static void bloco_lido(void *contexto)
+{
+    barramento_t *b = contexto;
+    sensor_t *s = &g_sensores[b->sensores[b->atual++]];
+
+    // O próximo sensor já vai para o barramento enquanto este é processado
+    ler_proximo_bloco(b);
+
+    mpu6050_dados_t dados;
+    mpu6050_decodificar(s->bloco, &dados);
+    processar_amostra(s, &dados, b->timestamp_us);
+}
+
+// Modo FIFO: cada sensor do barramento passa por INT_STATUS, FIFO_COUNT e a rajada
+// (ou o reset da FIFO), cada etapa iniciada pela conclusão do DMA da anterior.
+// Nenhuma IRQ espera o barramento.
+static void status_lido(void *contexto);
+static void contagem_lida(void *contexto);
+static void rajada_lida(void *contexto);
+static void fifo_resetada(void *contexto);
+
+// Começa a consulta da FIFO do sensor atual ou, se ela não puder começar, dos seguintes
+static void consultar_proxima_fifo(barramento_t *b)
+{
+    for (; b->atual < b->num_sensores; b->atual++)
+    {
+        sensor_t *s = &g_sensores[b->sensores[b->atual]];
+        if (i2c_dma_ler_registradores(&b->dma, s->mpu->addr, MPU6050_REG_INT_STATUS, &s->status_fifo, 1,
+                                      status_lido, b))
+            return;
+        g_contadores.leituras_perdidas++;
+    }
+}
+
+// Encerra o sensor atual e passa ao seguinte
+static void proxima_fifo(barramento_t *b)
+{
+    b->atual++;
+    consultar_proxima_fifo(b);
+}
+
+static void status_lido(void *contexto)
+{
+    barramento_t *b = contexto;
+    sensor_t *s = &g_sensores[b->sensores[b->atual]];
+    if (i2c_dma_ler_registradores(&b->dma, s->mpu->addr, MPU6050_REG_FIFO_COUNTH, s->contagem_fifo,
+                                  sizeof s->contagem_fifo, contagem_lida, b))
+        return;
+    g_contadores.leituras_perdidas++;
+    proxima_fifo(b);
+}
+
+static void contagem_lida(void *contexto)
+{
+    barramento_t *b = contexto;
+    sensor_t *s = &g_sensores[b->sensores[b->atual]];
+    bool ok;
+    if (!quadros_fifo(s, s->status_fifo & MPU6050_INT_FIFO_OFLOW,
+                      (uint16_t)(s->contagem_fifo[0] << 8 | s->contagem_fifo[1])))
+    {
+        static const uint8_t reset[] = {MPU6050_USER_CTRL_FIFO_RESET, MPU6050_USER_CTRL_FIFO_EN};
+        ok = i2c_dma_escrever_registrador(&b->dma, s->mpu->addr, MPU6050_REG_USER_CTRL, reset, 2, &s->user_ctrl,
+                                          fifo_resetada, b);
+    }
+    else if (s->quadros_rajada == 0)
+    {
+        proxima_fifo(b);
+        return;
+    }
+    else
+    {
+        // A rajada inteira (até ~23 ms a 400 kHz) corre por DMA, fora da IRQ do timer
+        ok = i2c_dma_ler_registradores(&b->dma, s->mpu->addr, MPU6050_REG_FIFO_R_W, s->rajada,
+                                       (size_t)s->quadros_rajada * MPU6050_FIFO_QUADRO_LEN, rajada_lida, b);
+    }
+    if (!ok)
+    {
+        g_contadores.leituras_perdidas++;
+        proxima_fifo(b);
+    }
+}
+
+// Conclusão do DMA de uma rajada da FIFO
+static void rajada_lida(void *contexto)
+{
+    barramento_t *b = contexto;
+    sensor_t *s = &g_sensores[b->sensores[b->atual]];
+    proxima_fifo(b);
+    processar_rajada(s, s->quadros_rajada);
+}
+
+static void fifo_resetada(void *contexto)
+{
+    proxima_fifo(contexto);
+}
+#else
+// Quadros completos na FIFO do sensor; 0 se não houver ou se ela precisou ser esvaziada
+static uint16_t contar_fifo(sensor_t *s)
+{
+    bool overflow;
+    uint16_t bytes;
+    if (!mpu6050_fifo_transbordou(s->mpu, &overflow) || !mpu6050_fifo_contar(s->mpu, &bytes))
+        return 0;
+    if (!quadros_fifo(s, overflow, bytes))
+    {
+        mpu6050_fifo_resetar(s->mpu);
+        return 0;
+    }
+    return s->quadros_rajada;
+}
+#endif
+
+// Lê uma amostra de cada sensor: com DMA apenas dispara as transferências, sem DMA
+// bloqueia durante as leituras
+static void disparar_leitura(uint64_t timestamp_us)
+{
+#if AQ_USAR_DMA
+    for (int i = 0; i < 2; i++)
+    {
+        barramento_t *b = &g_barramentos[i];
+        if (b->num_sensores == 0)
+            continue;
+        if (barramento_ocupado(b))
+        {
+            // A rodada anterior ainda está no barramento: estas amostras se perdem
+            g_contadores.leituras_perdidas += b->num_sensores;
+            continue;
+        }
+        b->timestamp_us = timestamp_us;
+        b->atual = 0;
+        ler_proximo_bloco(b);
+    }
+#else
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        sensor_t *s = &g_sensores[i];
+        imu_dados_t dados;
+        uint64_t instante_us = timestamp_us;
+        if (imu_ler(&s->imu, &dados, &instante_us))
+            processar_amostra(s, &dados, instante_us);
+        else
+            g_contadores.leituras_perdidas++;
+    }
+#endif
+}
+
+static bool barramentos_ocupados(void)
+{
+#if AQ_USAR_DMA
+    for (int i = 0; i < 2; i++)
+        if (g_barramentos[i].num_sensores && barramento_ocupado(&g_barramentos[i]))
+            return true;
+#endif
+    return false;
+}
+
+// Troca entre a taxa plena e o modo cíclico, no contexto do timer. As janelas em
+// andamento fecham na taxa antiga e um registro marca o instante da troca.
+static void trocar_taxa(repeating_timer_t *t, uint64_t agora_us)
+{
+    const aq_adaptativa_t *a = &g_config.adaptativa;
+    bool repouso = !g_em_repouso;
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+        if (!mpu6050_ciclo(g_sensores[i].mpu, repouso, a->ciclo))
+            g_contadores.leituras_perdidas++;
+
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        sensor_t *s = &g_sensores[i];
+        if (s->agregador.contagem)
+            fechar_janela(s, s->timestamp_anterior_us);
+        // O bloco de FFT em andamento recomeça na volta à taxa plena
+        s->espectro.preenchidas = 0;
+        s->timestamp_anterior_us = 0;
+    }
+
+    uint32_t odr_mhz = repouso ? mpu6050_ciclo_mhz(a->ciclo) : mpu6050_taxa_amostragem_hz(g_sensores[0].mpu) * 1000;
+    g_periodo_atual_us = repouso ? (uint32_t)(1000000000ull / odr_mhz) : g_periodo_nominal_us;
+    g_limite_lacuna_us = g_periodo_atual_us * 3 / 2;
+    // Negativo: período contado do início do callback, como na criação do timer
+    t->delay_us = -(int64_t)g_periodo_atual_us;
+
+    if (repouso)
+        g_inicio_repouso_us = agora_us;
+    else
+        g_tempo_repouso_ms += (uint32_t)((agora_us - g_inicio_repouso_us) / 1000);
+    g_em_repouso = repouso;
+    g_janelas_paradas = 0;
+    g_sensores_parados = 0;
+    g_contadores.trocas_taxa++;
+
+    // Os intervalos do jitter são só os da taxa plena
+    critical_section_enter_blocking(&g_cs_jitter);
+    g_ultimo_timestamp_us = 0;
+    critical_section_exit(&g_cs_jitter);
+
+    aq_registro_t registro = {.timestamp_inicio_us = agora_us,
+                              .timestamp_fim_us = agora_us,
+                              .tipo = AQ_REGISTRO_TAXA,
+                              .taxa = {.odr_mhz = odr_mhz, .repouso = repouso}};
+    publicar(&registro);
+    g_troca_pendente = false;
+}
+
+// Modo timer: uma leitura de registradores por período do ODR
+static bool timer_callback(repeating_timer_t *t)
+{
+    if (!g_ativo)
+        return false; // Retornar false cancela o timer
+
+    uint64_t agora = time_us_64();
+    // As escritas nos sensores são bloqueantes: só com a rodada anterior concluída
+    if (g_troca_pendente && !barramentos_ocupados())
+        trocar_taxa(t, agora);
+    if (!g_em_repouso)
+        registrar_intervalo(agora);
+    disparar_leitura(agora);
+    return true;
+}
+
+// Modo FIFO: acorda com as FIFOs pela metade e esvazia cada uma em uma única rajada
+static bool fifo_callback(repeating_timer_t *t)
+{
+    if (!g_ativo)
+        return false;
+
+#if AQ_USAR_DMA
+    for (int i = 0; i < 2; i++)
+    {
+        barramento_t *b = &g_barramentos[i];
+        // A rodada anterior ainda ocupa o barramento; a FIFO tem folga até o próximo tick
+        if (b->num_sensores == 0 || barramento_ocupado(b))
+            continue;
+        b->atual = 0;
+        consultar_proxima_fifo(b);
+    }
+#else
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        sensor_t *s = &g_sensores[i];
+        uint16_t quadros = contar_fifo(s);
+        if (quadros == 0)
+            continue;
+        if (mpu6050_fifo_ler(s->mpu, s->rajada, quadros))
+            processar_rajada(s, quadros);
+        else
+            g_contadores.leituras_perdidas++;
+    }
+#endif
+    return true;
+}
+
+// Modo data-ready: o timestamp é capturado na borda, antes da leitura I2C. Só o
+// primeiro sensor avisa; os outros são lidos no mesmo instante.
+static void drdy_irq_handler(void)
+{
+    uint64_t agora = time_us_64();
+    uint int_gpio = (uint)g_sensores[0].mpu->int_gpio;
+    if (!(gpio_get_irq_event_mask(int_gpio) & GPIO_IRQ_EDGE_RISE))
+        return;
+    gpio_acknowledge_irq(int_gpio, GPIO_IRQ_EDGE_RISE);
+    if (!g_ativo)
+        return;
+
+    registrar_intervalo(agora);
+    disparar_leitura(agora);
+}
+
+static void parar_local(void);
+
+// Executado no core que vai atender as IRQs de aquisição
+static bool iniciar_local(void)
+{
+    const mpu6050_t *mpu = g_sensores[0].mpu;
+    aq_modo_t modo = g_config.modo;
+    uint32_t odr = mpu6050_taxa_amostragem_hz(mpu);
+    uint32_t janela = g_config.janela_amostras ? g_config.janela_amostras : odr;
+    const aq_adaptativa_t *adaptativa = &g_config.adaptativa;
+    // A troca de taxa reprograma o timer; decimação e FIFO supõem o ODR fixo
+    if (adaptativa->habilitada && (modo != AQ_MODO_TIMER || g_config.decimacao.tipo != DEC_NENHUM))
+        return false;
+    // A decisão usa a média e a variância de cada janela, gravadas ou não
+    uint8_t estatisticas = g_config.estatisticas | (adaptativa->habilitada ? AG_MEDIA | AG_VARIANCIA : 0);
+    g_periodo_nominal_us = 1000000 / odr;
+    g_periodo_atual_us = g_periodo_nominal_us;
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        sensor_t *s = &g_sensores[i];
+        if (!ag_iniciar(&s->agregador, janela, estatisticas) ||
+            !dec_iniciar(&s->decimador, &g_config.decimacao))
+            return false;
+        if (g_config.espectro.pontos && !esp_iniciar(&s->espectro, &g_config.espectro, odr))
+            return false;
+        s->espectro.blocos_perdidos = 0;
+        s->espectro.pendente = false;
+        ori_iniciar(&s->orientacao, mpu6050_escala_gyro_x10(s->mpu), g_periodo_nominal_us,
+                    ORI_KP_PADRAO, ORI_KI_PADRAO);
+        s->timestamp_anterior_us = 0;
+    }
+    if (g_config.gatilho.tipo != GAT_DESLIGADO &&
+        !gat_iniciar(&g_gatilho, &g_config.gatilho, mpu6050_escala_accel(mpu), g_num_sensores))
+        return false;
+    g_gatilho.eventos = 0;
+    g_gatilho.perdidas = 0;
+    g_disparo_manual = false;
+    memset((void *)&g_contadores, 0, sizeof g_contadores);
+
+    // Limiares da taxa adaptativa nas unidades dos sensores (3 eixos, desvio ao quadrado)
+    uint32_t lsb_accel = mpu6050_escala_accel(mpu);
+    uint32_t desvio_accel = adaptativa->desvio_accel_mg * lsb_accel / 1000;
+    uint32_t desvio_gyro = adaptativa->desvio_gyro_cdps * mpu6050_escala_gyro_x10(mpu) / 1000;
+    g_limiar_var_accel = 3 * desvio_accel * desvio_accel;
+    g_limiar_var_gyro = 3 * desvio_gyro * desvio_gyro;
+    uint32_t movimento = adaptativa->movimento_mg * lsb_accel / 1000;
+    g_limiar_movimento = (int16_t)(movimento > INT16_MAX ? INT16_MAX : movimento);
+    g_em_repouso = false;
+    g_troca_pendente = false;
+    g_janelas_paradas = 0;
+    g_sensores_parados = 0;
+    g_tempo_repouso_ms = 0;
+
+    // Agrupa os sensores pelo bloco I2C em que estão ligados
+    for (int i = 0; i < 2; i++)
+        g_barramentos[i].num_sensores = 0;
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        barramento_t *b = &g_barramentos[i2c_get_index(g_sensores[i].mpu->i2c)];
+        b->sensores[b->num_sensores++] = i;
+    }
+
+#if AQ_USAR_DMA
+    // Os canais ficam reservados entre sessões
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+    {
+        barramento_t *b = &g_barramentos[i2c_get_index(g_sensores[i].mpu->i2c)];
+        if (!b->pronto)
+        {
+            if (!i2c_dma_init(&b->dma, g_sensores[i].mpu->i2c))
+                return false;
+            b->pronto = true;
+        }
+    }
+#endif
+
+    critical_section_enter_blocking(&g_cs_jitter);
+    g_atraso_decimacao_us = dec_atraso_meias_amostras(&g_sensores[0].decimador) * g_periodo_nominal_us / 2;
+    g_intervalo_orientacao = odr >= 20 ? odr / 20 : 1;
+    g_amostras_orientacao = 0;
+    // Timer e data-ready toleram meio período de atraso. Na FIFO os timestamps são
+    // reconstruídos a partir do instante da contagem, que erra até um período em cada
+    // rajada: só acima de dois períodos e meio o salto é uma perda de verdade.
+    if (modo == AQ_MODO_FIFO)
+        g_limite_lacuna_us = g_periodo_nominal_us * 5 / 2;
+    else
+        g_limite_lacuna_us = g_periodo_nominal_us * 3 / 2;
+    g_ultimo_timestamp_us = 0;
+    g_intervalos = 0;
+    g_intervalo_min_us = UINT32_MAX;
+    g_intervalo_max_us = 0;
+    g_soma_desvio_us = 0;
+    g_soma_desvio2_us = 0;
+    critical_section_exit(&g_cs_jitter);
+
+    critical_section_enter_blocking(&g_cs_orientacao);
+    g_orientacao_valida = false;
+    critical_section_exit(&g_cs_orientacao);
+
+    bool ok = true;
+    if (modo == AQ_MODO_FIFO)
+    {
+        for (uint8_t i = 0; i < g_num_sensores; i++)
+            if (!mpu6050_fifo_iniciar(g_sensores[i].mpu))
+            {
+                while (i--)
+                    mpu6050_fifo_parar(g_sensores[i].mpu);
+                return false;
+            }
+        g_ativo = true;
+        // Esvazia com a FIFO pela metade: sobra meio buffer de folga para atrasos do timer
+        int64_t periodo_us = (int64_t)(MPU6050_FIFO_MAX_QUADROS / 2) * 1000000 / odr;
+        ok = alarm_pool_add_repeating_timer_us(g_alarm_pool, -periodo_us, fifo_callback, NULL, &g_timer);
+    }
+    else if (modo == AQ_MODO_DRDY)
+    {
+        // Handler dedicado ao pino INT: não passa pelo callback compartilhado dos botões (e seu debounce)
+        uint int_gpio = (uint)mpu->int_gpio;
+        gpio_init(int_gpio);
+        gpio_set_dir(int_gpio, GPIO_IN);
+        gpio_pull_down(int_gpio);
+        gpio_add_raw_irq_handler(int_gpio, drdy_irq_handler);
+        g_ativo = true;
+        gpio_set_irq_enabled(int_gpio, GPIO_IRQ_EDGE_RISE, true);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+        ok = mpu6050_drdy_habilitar(mpu, true);
+    }
+    else
+    {
+        g_ativo = true;
+        ok = alarm_pool_add_repeating_timer_us(g_alarm_pool, -(int64_t)g_periodo_nominal_us,
+                                               timer_callback, NULL, &g_timer);
+    }
+
+    if (!ok)
+        parar_local();
+    return ok;
+}
+
+static void parar_local(void)
+{
+    if (!g_ativo)
+        return;
+    g_ativo = false;
+    const mpu6050_t *mpu = g_sensores[0].mpu;
+    if (g_config.modo == AQ_MODO_DRDY)
+    {
+        gpio_set_irq_enabled((uint)mpu->int_gpio, GPIO_IRQ_EDGE_RISE, false);
+        gpio_remove_raw_irq_handler((uint)mpu->int_gpio, drdy_irq_handler);
+    }
+    else
+    {
+        cancel_repeating_timer(&g_timer);
+    }
+
+#if AQ_USAR_DMA
+    // As escritas de configuração abaixo são bloqueantes: os barramentos precisam estar livres.
+    // Uma rajada da FIFO leva até ~25 ms por sensor; depois disso a transferência é cancelada.
+    uint64_t limite = time_us_64() + 30000 * AQ_MAX_SENSORES;
+    for (int i = 0; i < 2; i++)
+    {
+        barramento_t *b = &g_barramentos[i];
+        if (b->num_sensores == 0)
+            continue;
+        while (barramento_ocupado(b) && time_us_64() < limite)
+            tight_loop_contents();
+        if (barramento_ocupado(b))
+            i2c_dma_cancelar(&b->dma);
+    }
+#endif
+
+    if (g_config.modo == AQ_MODO_DRDY)
+        mpu6050_drdy_habilitar(mpu, false);
+    else if (g_config.modo == AQ_MODO_FIFO)
+        for (uint8_t i = 0; i < g_num_sensores; i++)
+            mpu6050_fifo_parar(g_sensores[i].mpu);
+
+    // Os sensores saem do modo cíclico para a próxima sessão e para a calibração
+    if (g_em_repouso)
+    {
+        for (uint8_t i = 0; i < g_num_sensores; i++)
+            mpu6050_ciclo(g_sensores[i].mpu, false, g_config.adaptativa.ciclo);
+        g_tempo_repouso_ms += (uint32_t)((time_us_64() - g_inicio_repouso_us) / 1000);
+        g_em_repouso = false;
+    }
+
+    // Os últimos blocos completos entram na sessão antes de o gravador esvaziar a fila
+    processar_espectros_pendentes();
+
+    // O que ainda esperava no anel entra se couber; o resto do evento se perde
+    if (g_config.gatilho.tipo != GAT_DESLIGADO)
+    {
+        publicar_amostras_evento(UINT32_MAX);
+        g_gatilho.perdidas += gat_pendentes(&g_gatilho);
+    }
+}
+
+#if AQ_NO_CORE1
+// Comandos do core 0 para o core 1. Não usamos a FIFO entre cores porque ela é
+// reservada pelo multicore_lockout durante gravações na flash.
+enum
+{
+    CMD_NENHUM = 0,
+    CMD_INICIAR,
+    CMD_PARAR
+};
+static volatile uint32_t g_cmd = CMD_NENHUM;
+static volatile bool g_cmd_resultado;
+
+static void core1_main(void)
+{
+    // Timers, GPIO e DMA_IRQ_1 registrados a partir daqui são atendidos pelo core 1,
+    // longe das escritas no SD, do display e do USB do core 0
+    g_alarm_pool = alarm_pool_create_with_unused_hardware_alarm(4);
+    // Permite ao core 0 parar este core enquanto grava a calibração na flash
+    flash_safe_execute_core_init();
+
+    while (true)
+    {
+        __wfe();
+        processar_espectros_pendentes();
+
+        uint32_t cmd = g_cmd;
+        if (cmd == CMD_NENHUM)
+            continue;
+        if (cmd == CMD_INICIAR)
+            g_cmd_resultado = iniciar_local();
+        else
+            parar_local();
+        __dmb();
+        g_cmd = CMD_NENHUM;
+        __sev();
+    }
+}
+
+static bool executar_no_core1(uint32_t cmd)
+{
+    __dmb();
+    g_cmd = cmd;
+    __sev();
+    while (g_cmd != CMD_NENHUM)
+        __wfe();
+    return g_cmd_resultado;
+}
+#endif
+
+void aquisicao_init(void)
+{
+    critical_section_init(&g_cs_jitter);
+    critical_section_init(&g_cs_orientacao);
+    fila_spsc_init(&g_fila, g_fila_buffer, sizeof(aq_registro_t), AQ_PROFUNDIDADE_FILA);
+#if AQ_NO_CORE1
+    multicore_launch_core1(core1_main);
+#else
+    g_alarm_pool = alarm_pool_get_default();
+#endif
+}
+
+bool aquisicao_iniciar(const mpu6050_t *const sensores[], uint8_t num_sensores, const aq_config_t *config)
+{
+    if (g_ativo || num_sensores == 0 || num_sensores > AQ_MAX_SENSORES)
+        return false;
+    // O primeiro sensor que respondeu pode não ser o da tabela que tem o pino INT
+    if (config->modo == AQ_MODO_DRDY && sensores[0]->int_gpio == MPU6050_SEM_INT)
+        return false;
+    for (uint8_t i = 0; i < num_sensores; i++)
+    {
+        g_sensores[i].mpu = sensores[i];
+        mpu6050_como_imu(sensores[i], &g_sensores[i].imu);
+        g_sensores[i].indice = i;
+    }
+    g_num_sensores = num_sensores;
+    g_config = *config;
+    // Registros que sobraram da sessão anterior (lado consumidor, antes de o produtor voltar)
+    fila_spsc_limpar(&g_fila);
+#if AQ_NO_CORE1
+    return executar_no_core1(CMD_INICIAR);
+#else
+    return iniciar_local();
+#endif
+}
+
+void aquisicao_parar(void)
+{
+#if AQ_NO_CORE1
+    executar_no_core1(CMD_PARAR);
+#else
+    parar_local();
+#endif
+}
+
+bool aquisicao_definir_calibracao(uint8_t sensor, const cal_gyro_t *calibracao)
+{
+    if (g_ativo || sensor >= AQ_MAX_SENSORES)
+        return false;
+    sensor_t *s = &g_sensores[sensor];
+    if (calibracao)
+        s->calibracao = *calibracao;
+    s->calibracao_ativa = calibracao != NULL;
+    return true;
+}
+
+bool aquisicao_ativa(void)
+{
+    return g_ativo;
+}
+
+bool aquisicao_em_repouso(void)
+{
+    return g_em_repouso;
+}
+
+void aquisicao_disparar(void)
+{
+    g_disparo_manual = true;
+}
+
+bool aquisicao_obter_registro(aq_registro_t *registro)
+{
+    return fila_spsc_remover(&g_fila, registro);
+}
+
+void aquisicao_obter_estado_fila(aq_estado_fila_t *estado)
+{
+    estado->capacidade = fila_spsc_capacidade(&g_fila);
+    estado->ocupacao = fila_spsc_ocupacao(&g_fila);
+    estado->maior_ocupacao = g_fila.maior_ocupacao;
+    estado->descartes = g_fila.descartes;
+}
+
+void aquisicao_obter_jitter(aq_jitter_t *jitter)
+{
+    // Copia as somas de uma vez para não misturar duas amostras
+    critical_section_enter_blocking(&g_cs_jitter);
+    uint32_t n = g_intervalos;
+    uint32_t min_us = g_intervalo_min_us, max_us = g_intervalo_max_us;
+    int64_t soma = g_soma_desvio_us;
+    uint64_t soma2 = g_soma_desvio2_us;
+    critical_section_exit(&g_cs_jitter);
+
+    jitter->intervalos = n;
+    jitter->periodo_nominal_us = g_periodo_nominal_us;
+    jitter->min_us = n ? min_us : 0;
+    jitter->max_us = max_us;
+    jitter->media_us = (float)g_periodo_nominal_us;
+    jitter->desvio_padrao_us = 0.0f;
+    if (n == 0)
+        return;
+
+    float media_desvio = (float)soma / n;
+    float variancia = (float)soma2 / n - media_desvio * media_desvio;
+    jitter->media_us += media_desvio;
+    jitter->desvio_padrao_us = variancia > 0.0f ? sqrtf(variancia) : 0.0f;
+}
+
+void aquisicao_obter_contadores(aq_contadores_t *contadores)
+{
+    *contadores = *(const aq_contadores_t *)&g_contadores;
+    contadores->registros_descartados = g_fila.descartes;
+    contadores->espectros_perdidos = 0;
+    for (uint8_t i = 0; i < g_num_sensores; i++)
+        contadores->espectros_perdidos += g_sensores[i].espectro.blocos_perdidos;
+    contadores->eventos = g_gatilho.eventos;
+    contadores->amostras_evento_perdidas = g_gatilho.perdidas;
+    contadores->tempo_repouso_ms = g_tempo_repouso_ms;
+    if (g_em_repouso)
+        contadores->tempo_repouso_ms += (uint32_t)((time_us_64() - g_inicio_repouso_us) / 1000);
+}
+
+bool aquisicao_obter_orientacao(ori_saida_t *saida)
+{
+    critical_section_enter_blocking(&g_cs_orientacao);
+    bool valida = g_orientacao_valida;
+    *saida = g_orientacao_atual;
+    critical_section_exit(&g_cs_orientacao);
+    return valida;
+}
@@ -0,0 +1,204 @@
+// aquisicao.h
+#ifndef AQUISICAO_H
+#define AQUISICAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "agregacao.h"
+#include "calibracao.h"
+#include "decimacao.h"
+#include "espectro.h"
+#include "gatilho.h"
+#include "mpu6050.h"
+#include "orientacao.h"
+
+// Leituras I2C por DMA: a IRQ de disparo (timer ou data-ready) só inicia a
+// transferência e a IRQ de conclusão do DMA publica a amostra
+#ifndef AQ_USAR_DMA
+#define AQ_USAR_DMA 1
+#endif
+
+// Amostragem e agregação no core 1. O core 0 fica com FatFs, display e CLI;
+// as médias chegam por uma fila sem travas, então travamentos do SD não
+// atrasam nem descartam amostras.
+#ifndef AQ_NO_CORE1
+#define AQ_NO_CORE1 1
+#endif
+
+// Registros na fila entre a aquisição e o gravador (potência de 2). Com 512
+// registros e janelas de 1 s o gravador pode atrasar mais de 8 minutos; com
+// amostras brutas a 100 Hz, cerca de 5 s. Cada registro ocupa ~128 bytes de RAM
+// (mais o anel de pré-disparo, GAT_AMOSTRAS_MAX x 32 bytes).
+#ifndef AQ_PROFUNDIDADE_FILA
+#define AQ_PROFUNDIDADE_FILA 512
+#endif
+// A fila indexa com 'capacidade - 1' como máscara
+_Static_assert(AQ_PROFUNDIDADE_FILA > 0 && (AQ_PROFUNDIDADE_FILA & (AQ_PROFUNDIDADE_FILA - 1)) == 0,
+               "AQ_PROFUNDIDADE_FILA precisa ser uma potencia de 2");
+
+// Canais de cada registro: ax, ay, az, gx, gy, gz, temp
+#define AQ_NUM_CANAIS AG_NUM_CANAIS
+
+// Sensores amostrados juntos (dois endereços em cada um dos dois blocos I2C). Cada
+// um tem o próprio caminho de agregação, decimação, espectro e orientação, ~11 KB
+// de RAM por sensor.
+#define AQ_MAX_SENSORES GAT_MAX_SENSORES
+
+// Com vários sensores, cada disparo lê todos: as leituras de um mesmo barramento
+// seguem em cadeia e os dois barramentos transferem ao mesmo tempo.
+typedef enum
+{
+    AQ_MODO_TIMER = 0, // Um bloco de 14 bytes por sensor a cada tick do timer (até ~200 Hz)
+    AQ_MODO_FIFO,      // FIFO de cada MPU6050 esvaziada em rajadas (500 Hz a 1 kHz)
+    AQ_MODO_DRDY       // Pino INT do primeiro sensor dispara uma IRQ de GPIO a cada amostra
+} aq_modo_t;
+
+// Taxa adaptativa (só no modo timer, sem decimação). Com todos os sensores parados
+// por 'janelas_repouso' janelas seguidas, eles entram no modo cíclico (só o
+// acelerômetro, na taxa de 'ciclo') e o timer acompanha: a janela, contada em
+// amostras, passa a cobrir mais tempo. Na taxa baixa cada amostra é comparada à
+// média da última janela parada; um desvio acima de 'movimento_mg' em qualquer
+// eixo volta à taxa plena no tick seguinte, e uma janela agitada também.
+typedef struct
+{
+    bool habilitada;
+    uint16_t desvio_accel_mg;   // Desvio padrão por eixo abaixo do qual a janela está parada
+    uint16_t desvio_gyro_cdps;  // Idem no gyro (centésimos de °/s), avaliado só na taxa plena
+    uint16_t movimento_mg;      // Desvio de uma amostra que acorda na taxa baixa
+    uint8_t janelas_repouso;    // Janelas paradas seguidas antes de baixar a taxa
+    mpu6050_ciclo_t ciclo;      // Taxa de repouso
+} aq_adaptativa_t;
+
+typedef struct
+{
+    aq_modo_t modo;
+    bool publicar_amostras;   // Cada amostra bruta vai para a fila (log em taxa plena)
+    bool publicar_janelas;    // As estatísticas de cada janela vão para a fila
+    uint32_t janela_amostras; // Amostras por janela; 0 = o ODR (uma janela por segundo)
+    uint8_t estatisticas;     // Máscara de ag_estatistica_t calculada em cada janela
+    dec_config_t decimacao;   // Filtro antialiasing das amostras publicadas (DEC_NENHUM = taxa plena)
+    esp_config_t espectro;    // Bandas de vibração de ax, ay, az por bloco (pontos = 0 desliga)
+    bool orientacao;          // Fusão accel+gyro a cada amostra; o resultado segue em cada registro
+    gat_config_t gatilho;     // Amostras em taxa plena só em volta de cada evento (GAT_DESLIGADO = contínuo)
+    aq_adaptativa_t adaptativa;
+} aq_config_t;
+
+typedef enum
+{
+    AQ_REGISTRO_AMOSTRA = 0,
+    AQ_REGISTRO_JANELA,
+    AQ_REGISTRO_ESPECTRO,
+    AQ_REGISTRO_EVENTO, // Disparo; as amostras do evento vêm logo depois, como AQ_REGISTRO_AMOSTRA
+    AQ_REGISTRO_TAXA    // Troca de taxa; os registros seguintes são da taxa nova
+} aq_tipo_registro_t;
+
+// Taxa em vigor a partir do timestamp do registro. As janelas em andamento são
+// fechadas antes da troca, então nenhuma mistura as duas taxas.
+typedef struct
+{
+    uint32_t odr_mhz;
+    bool repouso; // Modo cíclico: gyro em standby, lido como zero
+} aq_taxa_t;
+
+// Elemento da fila. Os timestamps são os da captura, tomados no caminho de
+// amostragem: numa janela ou bloco de FFT, o da primeira e o da última amostra; numa
+// amostra (bruta ou decimada), os dois são iguais. Amostras decimadas levam o
+// instante do centro do filtro, já descontado o atraso de grupo. A sequência é contínua dentro da sessão:
+// um salto visto pelo gravador é um registro descartado na fila. Com a orientação
+// ligada, amostras e janelas levam a estimativa do instante em que foram fechadas.
+typedef struct
+{
+    uint64_t timestamp_inicio_us;
+    uint64_t timestamp_fim_us;
+    uint32_t sequencia;
+    uint8_t tipo;   // aq_tipo_registro_t
+    uint8_t sensor; // Posição na tabela de sensores (no evento, o que disparou)
+    union
+    {
+        int16_t canais[AQ_NUM_CANAIS]; // AQ_REGISTRO_AMOSTRA
+        ag_resultado_t janela;         // AQ_REGISTRO_JANELA
+        esp_resultado_t espectro;      // AQ_REGISTRO_ESPECTRO
+        gat_evento_t evento;           // AQ_REGISTRO_EVENTO (timestamp da amostra do disparo)
+        aq_taxa_t taxa;                // AQ_REGISTRO_TAXA (timestamp do primeiro tick na taxa nova)
+    };
+    ori_saida_t orientacao; // Amostras e janelas, se aq_config_t.orientacao
+} aq_registro_t;
+
+typedef struct
+{
+    uint32_t capacidade;
+    uint32_t ocupacao;
+    uint32_t maior_ocupacao; // High-water mark desde o início da sessão
+    uint32_t descartes;      // Registros perdidos por fila cheia
+} aq_estado_fila_t;
+
+// Estatísticas do intervalo entre amostras consecutivas (modos timer e data-ready;
+// na taxa adaptativa, só os intervalos na taxa plena)
+typedef struct
+{
+    uint32_t intervalos;      // Número de intervalos medidos
+    uint32_t periodo_nominal_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    float media_us;
+    float desvio_padrao_us;
+} aq_jitter_t;
+
+// Contabilidade de perdas da sessão, do disparo da leitura até a fila
+typedef struct
+{
+    uint32_t amostras_adquiridas;    // Amostras lidas do sensor e processadas
+    uint32_t amostras_agregadas;     // Amostras que entraram em janelas publicadas
+    uint32_t registros_gerados;      // Registros numerados (a próxima sequência)
+    uint32_t registros_descartados;  // Registros perdidos por fila cheia
+    uint32_t leituras_perdidas;      // Disparos sem amostra: barramento ocupado ou erro de I2C
+    uint32_t ressincronizacoes_fifo; // Transbordos/desalinhamentos que esvaziaram a FIFO
+    uint32_t lacunas;                // Saltos de timestamp entre amostras consecutivas
+    uint32_t amostras_faltando;      // Amostras estimadas dentro das lacunas
+    uint32_t espectros_perdidos;     // Blocos descartados porque a FFT anterior não terminou
+    uint32_t eventos;                // Disparos que abriram um evento
+    uint32_t amostras_evento_perdidas; // Amostras de evento que não couberam na fila a tempo
+    uint32_t trocas_taxa;            // Mudanças da taxa adaptativa
+    uint32_t tempo_repouso_ms;       // Tempo na taxa baixa
+} aq_contadores_t;
+
+// Prepara a fila de registros e, com AQ_NO_CORE1, lança o core 1. Chamar uma vez no boot.
+void aquisicao_init(void);
+
+// Inicia a amostragem dos sensores no ODR configurado no primeiro (todos devem ter
+// o mesmo ODR e fundos de escala). Retorna false se a janela for maior que
+// AG_JANELA_MAX, se o fator de decimação não for suportado, se um sensor não responder
+// ou, no modo data-ready, se o primeiro sensor não tiver o pino INT (MPU6050_SEM_INT).
+bool aquisicao_iniciar(const mpu6050_t *const sensores[], uint8_t num_sensores, const aq_config_t *config);
+
+// Para a amostragem e desliga a FIFO ou o pino INT dos sensores, conforme o modo
+void aquisicao_parar(void);
+
+// Correção do giroscópio aplicada a cada amostra do sensor nas próximas sessões
+// (NULL desliga). Retorna false com a aquisição ativa.
+bool aquisicao_definir_calibracao(uint8_t sensor, const cal_gyro_t *calibracao);
+
+bool aquisicao_ativa(void);
+
+// Taxa adaptativa na taxa baixa
+bool aquisicao_em_repouso(void);
+
+// Dispara um evento na próxima amostra, como se a condição do gatilho fosse atendida
+void aquisicao_disparar(void);
+
+// Retira o próximo registro da fila (lado do gravador). Retorna false se estiver vazia.
+bool aquisicao_obter_registro(aq_registro_t *registro);
+
+void aquisicao_obter_estado_fila(aq_estado_fila_t *estado);
+
+// Jitter observado desde o início da sessão
+void aquisicao_obter_jitter(aq_jitter_t *jitter);
+
+// Contadores de perdas desde o início da sessão (podem ser lidos com a aquisição ativa)
+void aquisicao_obter_contadores(aq_contadores_t *contadores);
+
+// Última orientação estimada do primeiro sensor (atualizada ~20 vezes por segundo). Retorna false se
+// a fusão estiver desligada ou ainda não tiver recebido amostras.
+bool aquisicao_obter_orientacao(ori_saida_t *saida);
+
+#endif // AQUISICAO_H
@@ -0,0 +1,245 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "aquisicao.h"
+#include "decimacao.h"
+#include "espectro.h"
+#include "formatacao.h"
+#include "log_binario.h"
+#include "orientacao.h"
+
+// Entrada sintética: ruído pseudo-aleatório de ±8192 LSB, gerado antes da
+// medição para o custo do gerador não entrar na conta
+#define BENCH_AMOSTRAS_TABELA 64
+#define BENCH_AMOSTRAS 4096
+
+static int16_t g_entrada[BENCH_AMOSTRAS_TABELA][DEC_NUM_CANAIS];
+static dec_decimador_t g_decimador;
+static esp_analisador_t g_espectro;
+static ori_filtro_t g_orientacao;
+
+static void preparar_entrada(void)
+{
+    uint32_t semente = 12345;
+    for (int i = 0; i < BENCH_AMOSTRAS_TABELA; i++)
+        for (int c = 0; c < DEC_NUM_CANAIS; c++)
+        {
+            semente = semente * 1664525u + 1013904223u;
+            g_entrada[i][c] = (int16_t)((int32_t)(semente >> 16) % 8192);
+        }
+}
+
+// Converte microssegundos em ciclos do clock do sistema
+static uint32_t ciclos(uint32_t tempo_us, uint32_t repeticoes)
+{
+    uint64_t hz = clock_get_hz(clk_sys);
+    return (uint32_t)((uint64_t)tempo_us * hz / 1000000 / repeticoes);
+}
+
+static uint32_t medir_decimacao(dec_tipo_t tipo, uint32_t fator)
+{
+    dec_config_t config = {.tipo = tipo, .fator = fator};
+    if (!dec_iniciar(&g_decimador, &config))
+        return 0;
+
+    int16_t saida[DEC_NUM_CANAIS];
+    uint32_t interrupcoes = save_and_disable_interrupts();
+    uint32_t inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_AMOSTRAS; i++)
+        dec_adicionar(&g_decimador, g_entrada[i % BENCH_AMOSTRAS_TABELA], saida);
+    uint32_t tempo_us = time_us_32() - inicio;
+    restore_interrupts(interrupcoes);
+    return ciclos(tempo_us, BENCH_AMOSTRAS);
+}
+
+void benchmark_decimacao(void)
+{
+    static const uint32_t fatores[] = {4, 10, 20, 40};
+    preparar_entrada();
+
+    printf("Decimacao (%d canais, %lu MHz), ciclos por amostra de entrada:\n",
+           DEC_NUM_CANAIS, clock_get_hz(clk_sys) / 1000000);
+    for (size_t i = 0; i < count_of(fatores); i++)
+    {
+        dec_decimador_t *dec = &g_decimador;
+        uint32_t cic = medir_decimacao(DEC_CIC, fatores[i]);
+        uint32_t fir = medir_decimacao(DEC_FIR, fatores[i]);
+        printf("  R=%2lu: CIC %lu, FIR %lu (%lu coeficientes)\n",
+               fatores[i], cic, fir, fir ? dec->fir.taps : 0);
+    }
+}
+
+void benchmark_espectro(void)
+{
+    static const uint16_t pontos[] = {64, 128, 256, 512};
+    if (aquisicao_ativa())
+    {
+        printf("Espectro: pare o log antes de medir\n");
+        return;
+    }
+    preparar_entrada();
+
+    printf("FFT de %d eixos, ciclos por bloco:\n", ESP_NUM_EIXOS);
+    for (size_t i = 0; i < count_of(pontos); i++)
+    {
+        esp_config_t config = {.pontos = pontos[i], .num_bandas = 4, .bordas_hz = {20, 50, 100, 200, 500}};
+        if (!esp_iniciar(&g_espectro, &config, 1000))
+            continue;
+
+        // Enche um bloco fora da medição; só o cálculo entra na conta
+        int16_t eixos[ESP_NUM_EIXOS];
+        for (uint32_t n = 0; n < pontos[i]; n++)
+        {
+            for (int e = 0; e < ESP_NUM_EIXOS; e++)
+                eixos[e] = g_entrada[n % BENCH_AMOSTRAS_TABELA][e];
+            esp_adicionar(&g_espectro, eixos);
+        }
+
+        esp_resultado_t resultado;
+        uint32_t interrupcoes = save_and_disable_interrupts();
+        uint32_t inicio = time_us_32();
+        esp_calcular(&g_espectro, &resultado);
+        uint32_t tempo_us = time_us_32() - inicio;
+        restore_interrupts(interrupcoes);
+
+        // A 1 kHz um bloco de N pontos chega a cada N ms
+        printf("  N=%3u: %lu ciclos (%lu us), %lu.%02lu%% de um core a 1 kHz\n",
+               pontos[i], ciclos(tempo_us, 1), tempo_us,
+               tempo_us / (10 * pontos[i]), (tempo_us * 10 / pontos[i]) % 100);
+    }
+}
+
+void benchmark_orientacao(void)
+{
+    preparar_entrada();
+    // ±2000 °/s: o ruído sintético vira rotações grandes, sem atalhos no float
+    ori_iniciar(&g_orientacao, 164, 1000, ORI_KP_PADRAO, ORI_KI_PADRAO);
+
+    uint32_t interrupcoes = save_and_disable_interrupts();
+    uint32_t inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_AMOSTRAS; i++)
+    {
+        const int16_t *amostra = g_entrada[i % BENCH_AMOSTRAS_TABELA];
+        ori_atualizar(&g_orientacao, &amostra[0], &amostra[3], (uint64_t)i * 1000);
+    }
+    uint32_t tempo_atualizar_us = time_us_32() - inicio;
+
+    ori_saida_t saida;
+    inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_AMOSTRAS / 16; i++)
+        ori_obter_saida(&g_orientacao, &saida);
+    uint32_t tempo_saida_us = time_us_32() - inicio;
+    restore_interrupts(interrupcoes);
+
+    // A 1 kHz cada amostra tem 1000 us
+    uint32_t centesimos = tempo_atualizar_us * 100 / BENCH_AMOSTRAS * 100 / 1000;
+    printf("Orientacao (Mahony, float): %lu ciclos por amostra, %lu ciclos por leitura dos angulos, "
+           "%lu.%02lu%% de um core a 1 kHz\n",
+           ciclos(tempo_atualizar_us, BENCH_AMOSTRAS), ciclos(tempo_saida_us, BENCH_AMOSTRAS / 16),
+           centesimos / 100, centesimos % 100);
+}
+
+// Linha de amostra com timestamp de 64 bits, como gravar_amostra (sem a orientação)
+#define BENCH_LINHAS 1024
+
+void benchmark_formatacao(void)
+{
+    preparar_entrada();
+    static char linha[128];
+    uint64_t t = 5000000000ull; // ~83 min de boot: o timestamp já não cabe em 32 bits
+    uint32_t bytes_printf = 0, bytes_rapido = 0;
+
+    uint32_t interrupcoes = save_and_disable_interrupts();
+    uint32_t inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_LINHAS; i++)
+    {
+        const int16_t *c = g_entrada[i % BENCH_AMOSTRAS_TABELA];
+        bytes_printf += (uint32_t)snprintf(linha, sizeof linha, "%lu;%u;%llu;%d;%d;%d;%d;%d;%d;%d\n", i, 0u,
+                                           t + i * 1000u, c[0], c[1], c[2], c[3], c[4], c[5], c[6]);
+    }
+    uint32_t tempo_printf_us = time_us_32() - inicio;
+
+    inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_LINHAS; i++)
+    {
+        char *p = fmt_u32(linha, i);
+        *p++ = ';';
+        p = fmt_u32(p, 0);
+        *p++ = ';';
+        p = fmt_u64(p, t + i * 1000u);
+        p = fmt_campos_i16(p, g_entrada[i % BENCH_AMOSTRAS_TABELA], DEC_NUM_CANAIS);
+        *p++ = '\n';
+        bytes_rapido += (uint32_t)(p - linha);
+    }
+    uint32_t tempo_rapido_us = time_us_32() - inicio;
+    restore_interrupts(interrupcoes);
+
+    printf("Formatacao do CSV (linha de amostra, %lu bytes): printf %lu ciclos, formatacao.c %lu ciclos por linha%s\n",
+           bytes_rapido / BENCH_LINHAS, ciclos(tempo_printf_us, BENCH_LINHAS), ciclos(tempo_rapido_us, BENCH_LINHAS),
+           bytes_printf == bytes_rapido ? "" : " (ERRO: tamanhos diferentes)");
+}
+
+// Amostras do log binário com e sem compressão: passeio aleatório de ±32 LSB por
+// amostra a 1 kHz, que é como um IMU quase parado aparece nos registros
+#define BENCH_REGISTROS 2048
+
+static lb_escritor_t g_escritor;
+
+static uint32_t medir_log_binario(bool comprimido, uint32_t *blocos)
+{
+    lb_cabecalho_t cab = {.tipo = LB_AMOSTRAS, .num_sensores = 1, .odr_hz = 1000, .fator_decimacao = 1,
+                          .comprimido = comprimido};
+    lb_iniciar(&g_escritor, &cab);
+    lb_registro_t r = {.timestamp_us = 5000000000ull};
+    *blocos = 0;
+
+    uint32_t interrupcoes = save_and_disable_interrupts();
+    uint32_t inicio = time_us_32();
+    for (uint32_t i = 0; i < BENCH_REGISTROS; i++)
+    {
+        // O passeio entra nas duas medições igual; o que muda é o escritor
+        const int16_t *passo = g_entrada[i % BENCH_AMOSTRAS_TABELA];
+        for (int c = 0; c < DEC_NUM_CANAIS; c++)
+            r.canais[c] = (int16_t)(r.canais[c] + (passo[c] >> 8));
+        r.timestamp_us += 1000 + (i & 3);
+        if (!lb_cabe(&g_escritor, i, &r))
+        {
+            lb_fechar_bloco(&g_escritor);
+            lb_novo_bloco(&g_escritor);
+            (*blocos)++;
+        }
+        lb_adicionar(&g_escritor, i, &r);
+        if (lb_bloco_cheio(&g_escritor))
+        {
+            lb_fechar_bloco(&g_escritor);
+            lb_novo_bloco(&g_escritor);
+            (*blocos)++;
+        }
+    }
+    if (g_escritor.registros)
+    {
+        lb_fechar_bloco(&g_escritor);
+        (*blocos)++;
+    }
+    uint32_t tempo_us = time_us_32() - inicio;
+    restore_interrupts(interrupcoes);
+    return ciclos(tempo_us, BENCH_REGISTROS);
+}
+
+void benchmark_compressao(void)
+{
+    preparar_entrada();
+    uint32_t blocos_fixo, blocos_comprimido;
+    uint32_t fixo = medir_log_binario(false, &blocos_fixo);
+    uint32_t comprimido = medir_log_binario(true, &blocos_comprimido);
+
+    // Bytes por amostra em centésimos, contando rodapés e o fim dos blocos
+    uint32_t bytes_fixo = blocos_fixo * LB_BLOCO * 100 / BENCH_REGISTROS;
+    uint32_t bytes_comprimido = blocos_comprimido * LB_BLOCO * 100 / BENCH_REGISTROS;
+    printf("Log binario (amostras, CRC incluido): fixo %lu ciclos e %lu.%02lu bytes, comprimido %lu ciclos e "
+           "%lu.%02lu bytes por amostra (%lu.%02lux)\n",
+           fixo, bytes_fixo / 100, bytes_fixo % 100, comprimido, bytes_comprimido / 100, bytes_comprimido % 100,
+           blocos_fixo / blocos_comprimido, blocos_fixo * 100 / blocos_comprimido % 100);
+}
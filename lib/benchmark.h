@@ -0,0 +1,27 @@
+// benchmark.h
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Custo de CPU dos estágios de processamento, medido no próprio RP2040 e
+// impresso no terminal em ciclos de clock. Cada medição roda com as
+// interrupções deste core desligadas, sobre dados sintéticos.
+
+// Ciclos por amostra de entrada dos filtros de decimação (CIC e FIR) em alguns fatores
+void benchmark_decimacao(void);
+
+// Ciclos por bloco da FFT de ax, ay, az (janela, FFT e bandas) e a fração de um
+// core que ela consome a 1 kHz. Recusa rodar com o log ativo: divide as tabelas
+// e a área de trabalho com a aquisição.
+void benchmark_espectro(void);
+
+// Ciclos por amostra do filtro de orientação e por leitura dos ângulos de Euler,
+// e a fração de um core que a fusão consome a 1 kHz
+void benchmark_orientacao(void);
+
+// Ciclos por linha de amostra do CSV com snprintf (o caminho antigo) e com formatacao.c
+void benchmark_formatacao(void);
+
+// Ciclos e bytes por amostra do log binário com registros fixos e comprimidos
+void benchmark_compressao(void);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,130 @@
+#include "calibracao.h"
+#include <string.h>
+
+// LSB/(°/s) x10 da unidade dos registradores de offset (±1000 °/s)
+#define ESCALA_OFFSETS_X10 328
+
+static int64_t dividir_arredondado(int64_t num, int64_t den)
+{
+    if (den < 0)
+    {
+        num = -num;
+        den = -den;
+    }
+    return (num >= 0 ? num + den / 2 : num - den / 2) / den;
+}
+
+static int32_t limitar_coef(int64_t coef)
+{
+    return (int32_t)(coef > CAL_COEF_Q16_MAX ? CAL_COEF_Q16_MAX : coef < -CAL_COEF_Q16_MAX ? -CAL_COEF_Q16_MAX : coef);
+}
+
+void cal_iniciar(cal_acumulador_t *acc)
+{
+    memset(acc, 0, sizeof *acc);
+}
+
+void cal_acumular(cal_acumulador_t *acc, const int16_t gyro[3], int16_t temp)
+{
+    if (acc->n == 0)
+    {
+        acc->temp_base = temp;
+        acc->min_t = acc->max_t = temp;
+        for (int i = 0; i < 3; i++)
+            acc->min_g[i] = acc->max_g[i] = gyro[i];
+    }
+    acc->n++;
+
+    int32_t t = temp - acc->temp_base;
+    acc->soma_t += t;
+    acc->soma_tt += t * t;
+    if (temp < acc->min_t)
+        acc->min_t = temp;
+    if (temp > acc->max_t)
+        acc->max_t = temp;
+
+    for (int i = 0; i < 3; i++)
+    {
+        acc->soma_g[i] += gyro[i];
+        acc->soma_gt[i] += (int64_t)gyro[i] * t;
+        if (gyro[i] < acc->min_g[i])
+            acc->min_g[i] = gyro[i];
+        if (gyro[i] > acc->max_g[i])
+            acc->max_g[i] = gyro[i];
+    }
+}
+
+bool cal_ajustar(const cal_acumulador_t *acc, uint16_t escala_gyro_x10, int32_t limite_repouso, cal_gyro_t *cal)
+{
+    if (acc->n < 2)
+        return false;
+    for (int i = 0; i < 3; i++)
+        if (acc->max_g[i] - acc->min_g[i] > limite_repouso)
+            return false;
+
+    // O ajuste roda uma vez, fora do caminho de amostragem: double basta
+    double n = (double)acc->n;
+    double media_t = (double)acc->soma_t / n;
+    bool ajustar_coef = acc->max_t - acc->min_t >= CAL_VARIACAO_TEMP_MIN;
+    double denominador = n * (double)acc->soma_tt - (double)acc->soma_t * (double)acc->soma_t;
+
+    int32_t temp_ref = acc->temp_base + (int32_t)(media_t >= 0 ? media_t + 0.5 : media_t - 0.5);
+    for (int i = 0; i < 3; i++)
+    {
+        double media_g = (double)acc->soma_g[i] / n;
+        if (ajustar_coef && denominador > 0.0)
+        {
+            double coef = (n * (double)acc->soma_gt[i] - (double)acc->soma_t * (double)acc->soma_g[i]) / denominador;
+            cal->coef_q16[i] = limitar_coef((int64_t)(coef * 65536.0));
+        }
+        // A reta passa pelas médias; o bias é levado da temperatura média até temp_ref
+        double bias = media_g + (double)cal->coef_q16[i] / 65536.0 * ((double)temp_ref - acc->temp_base - media_t);
+        cal->bias_q8[i] = (int32_t)(bias * 256.0 + (bias >= 0 ? 0.5 : -0.5));
+    }
+    cal->temp_ref = (int16_t)temp_ref;
+    cal->escala_gyro_x10 = escala_gyro_x10;
+    return true;
+}
+
+void cal_converter_escala(cal_gyro_t *cal, uint16_t escala_gyro_x10)
+{
+    if (cal->escala_gyro_x10 == escala_gyro_x10 || cal->escala_gyro_x10 == 0)
+        return;
+    for (int i = 0; i < 3; i++)
+    {
+        cal->bias_q8[i] = (int32_t)dividir_arredondado((int64_t)cal->bias_q8[i] * escala_gyro_x10, cal->escala_gyro_x10);
+        cal->coef_q16[i] = limitar_coef(dividir_arredondado((int64_t)cal->coef_q16[i] * escala_gyro_x10, cal->escala_gyro_x10));
+    }
+    cal->escala_gyro_x10 = escala_gyro_x10;
+}
+
+void cal_offsets_sensor(const cal_gyro_t *cal, int16_t offsets[3], cal_gyro_t *residual)
+{
+    *residual = *cal;
+    int64_t escala = cal->escala_gyro_x10;
+    for (int i = 0; i < 3; i++)
+    {
+        // Um passo do registrador vale escala/328 LSB da saída
+        int64_t o = dividir_arredondado(-(int64_t)cal->bias_q8[i] * ESCALA_OFFSETS_X10, escala * 256);
+        o = o > INT16_MAX ? INT16_MAX : o < INT16_MIN ? INT16_MIN : o;
+        offsets[i] = (int16_t)o;
+        residual->bias_q8[i] = (int32_t)(cal->bias_q8[i] + dividir_arredondado(o * escala * 256, ESCALA_OFFSETS_X10));
+    }
+}
+
+bool cal_sem_deriva(const cal_gyro_t *cal)
+{
+    return cal->coef_q16[0] == 0 && cal->coef_q16[1] == 0 && cal->coef_q16[2] == 0;
+}
+
+void cal_corrigir_gyro(const cal_gyro_t *cal, int16_t gyro[3], int16_t temp)
+{
+    // |coef| <= 2^14 e |ΔT| < 2^16: o produto cabe em int32
+    int32_t delta_t = (int32_t)temp - cal->temp_ref;
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t bias_q8 = cal->bias_q8[i] + ((cal->coef_q16[i] * delta_t) >> 8);
+        int32_t v = gyro[i] - ((bias_q8 + 128) >> 8);
+        gyro[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+    }
+}
@@ -0,0 +1,63 @@
+// calibracao.h
+#ifndef CALIBRACAO_H
+#define CALIBRACAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bias do giroscópio com deriva linear na temperatura do próprio sensor:
+//   bias(T) = bias_ref + coef · (T - temp_ref)
+// com o bias em LSB do giroscópio e T em LSB do canal de temperatura (340 LSB/°C).
+// A correção por amostra é inteira: um produto de 32 bits e dois deslocamentos por eixo.
+typedef struct
+{
+    int32_t bias_q8[3];       // Bias na temperatura de referência, LSB x256
+    int32_t coef_q16[3];      // LSB de gyro por LSB de temperatura, Q16
+    int16_t temp_ref;         // Temperatura média durante a calibração (LSB do canal)
+    uint16_t escala_gyro_x10; // Fundo de escala em que foi medido (mpu6050_escala_gyro_x10)
+} cal_gyro_t;
+
+// Maior coeficiente aceito (0,25 LSB/LSB, ~85 LSB/°C): mantém coef · ΔT em 32 bits
+#define CAL_COEF_Q16_MAX 16384
+
+// Variação mínima de temperatura para ajustar o coeficiente (1 °C). Abaixo disso
+// o ajuste é dominado pelo ruído e o coeficiente anterior é mantido.
+#define CAL_VARIACAO_TEMP_MIN 340
+
+// Somas para o ajuste por mínimos quadrados. A temperatura é acumulada em relação
+// à primeira amostra para as somas caberem em inteiros.
+typedef struct
+{
+    uint32_t n;
+    int16_t temp_base;
+    int64_t soma_t, soma_tt;
+    int64_t soma_g[3], soma_gt[3];
+    int16_t min_g[3], max_g[3];
+    int16_t min_t, max_t;
+} cal_acumulador_t;
+
+void cal_iniciar(cal_acumulador_t *acc);
+
+void cal_acumular(cal_acumulador_t *acc, const int16_t gyro[3], int16_t temp);
+
+// Ajusta bias e coeficiente térmico. 'limite_repouso' é a maior variação pico a
+// pico aceita em cada eixo (LSB); acima dela o sensor se moveu e a função retorna
+// false sem alterar 'cal'. Se a temperatura variou menos que CAL_VARIACAO_TEMP_MIN,
+// o coeficiente de 'cal' é mantido e só o bias é atualizado.
+bool cal_ajustar(const cal_acumulador_t *acc, uint16_t escala_gyro_x10, int32_t limite_repouso, cal_gyro_t *cal);
+
+// Converte bias e coeficiente para outro fundo de escala
+void cal_converter_escala(cal_gyro_t *cal, uint16_t escala_gyro_x10);
+
+// Offsets para XG/YG/ZG_OFFS_USR, que o sensor soma à saída em unidades de ±1000 °/s.
+// Cancela o bias na temperatura de referência; 'residual' fica com o que sobra
+// (menos de meio passo do registrador) e com a deriva térmica.
+void cal_offsets_sensor(const cal_gyro_t *cal, int16_t offsets[3], cal_gyro_t *residual);
+
+// Nenhum eixo tem coeficiente térmico
+bool cal_sem_deriva(const cal_gyro_t *cal);
+
+// Subtrai o bias estimado para a temperatura da amostra
+void cal_corrigir_gyro(const cal_gyro_t *cal, int16_t gyro[3], int16_t temp);
+
+#endif // CALIBRACAO_H
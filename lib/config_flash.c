@@ -0,0 +1,68 @@
+#include "config_flash.h"
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+#define OFFSET_CONFIG (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+typedef struct
+{
+    uint32_t assinatura;
+    uint32_t tamanho;
+    uint32_t crc; // CRC-32 dos dados
+} cabecalho_t;
+
+#define DADOS_MAX (FLASH_PAGE_SIZE - sizeof(cabecalho_t))
+
+// A página é montada na RAM: durante a gravação a flash não pode ser lida
+static uint8_t g_pagina[FLASH_PAGE_SIZE];
+
+static uint32_t crc32(const uint8_t *dados, size_t tamanho)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < tamanho; i++)
+    {
+        crc ^= dados[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+bool config_flash_ler(uint32_t assinatura, void *dados, size_t tamanho)
+{
+    const uint8_t *setor = (const uint8_t *)(XIP_BASE + OFFSET_CONFIG);
+    cabecalho_t cabecalho;
+    memcpy(&cabecalho, setor, sizeof cabecalho);
+    if (cabecalho.assinatura != assinatura || cabecalho.tamanho != tamanho || tamanho > DADOS_MAX)
+        return false;
+    if (crc32(setor + sizeof cabecalho, tamanho) != cabecalho.crc)
+        return false;
+    memcpy(dados, setor + sizeof cabecalho, tamanho);
+    return true;
+}
+
+// Roda com as interrupções desligadas e o outro core parado
+static void gravar_pagina(void *parametro)
+{
+    (void)parametro;
+    flash_range_erase(OFFSET_CONFIG, FLASH_SECTOR_SIZE);
+    flash_range_program(OFFSET_CONFIG, g_pagina, FLASH_PAGE_SIZE);
+}
+
+bool config_flash_gravar(uint32_t assinatura, const void *dados, size_t tamanho)
+{
+    if (tamanho > DADOS_MAX)
+        return false;
+    cabecalho_t cabecalho = {.assinatura = assinatura,
+                             .tamanho = (uint32_t)tamanho,
+                             .crc = crc32(dados, tamanho)};
+    memset(g_pagina, 0xFF, sizeof g_pagina);
+    memcpy(g_pagina, &cabecalho, sizeof cabecalho);
+    memcpy(g_pagina + sizeof cabecalho, dados, tamanho);
+
+    if (flash_safe_execute(gravar_pagina, NULL, 100) != PICO_OK)
+        return false;
+    // Confere lendo de volta pela XIP
+    return config_flash_ler(assinatura, g_pagina, tamanho) && memcmp(g_pagina, dados, tamanho) == 0;
+}
@@ -0,0 +1,22 @@
+// config_flash.h
+#ifndef CONFIG_FLASH_H
+#define CONFIG_FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Configuração persistente no último setor da flash do Pico (fora do alcance do
+// .uf2, que só grava o tamanho do firmware). Um bloco de até ~240 bytes por vez,
+// identificado por uma assinatura que o chamador muda quando o formato muda.
+
+// Copia o bloco salvo para 'dados'. Retorna false se não houver bloco com esta
+// assinatura e este tamanho, ou se o CRC não conferir.
+bool config_flash_ler(uint32_t assinatura, void *dados, size_t tamanho);
+
+// Apaga o setor e grava o bloco. Com o core 1 no ar, ele é parado pelo
+// multicore_lockout (flash_safe_execute) enquanto a flash não pode ser lida;
+// os dois cores ficam ~50 ms sem interrupções. Não chamar com a aquisição ativa.
+bool config_flash_gravar(uint32_t assinatura, const void *dados, size_t tamanho);
+
+#endif // CONFIG_FLASH_H
@@ -0,0 +1,161 @@
+#include "decimacao.h"
+#include <math.h>
+#include <string.h>
+
+static int16_t saturar(int32_t v)
+{
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    if (v < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)v;
+}
+
+// Passa-baixas sinc janelado com corte em 0,4/R ciclos por amostra (0,8 da Nyquist
+// da saída). Os coeficientes são arredondados para Q15 e o central absorve o erro
+// de arredondamento, para o ganho DC ser exatamente 1.
+static void projetar_fir(dec_decimador_t *dec)
+{
+    uint32_t taps = 8 * dec->fator + 1;
+    if (taps > DEC_FIR_MAX_TAPS)
+        taps = DEC_FIR_MAX_TAPS;
+    dec->fir.taps = taps;
+
+    const float pi = 3.14159265f;
+    float corte = 0.4f / (float)dec->fator;
+    float centro = (float)(taps - 1) / 2.0f;
+    float h[DEC_FIR_MAX_TAPS];
+    float soma = 0.0f;
+    for (uint32_t n = 0; n < taps; n++)
+    {
+        float x = (float)n - centro;
+        float sinc = x == 0.0f ? 2.0f * corte : sinf(2.0f * pi * corte * x) / (pi * x);
+        float hamming = 0.54f - 0.46f * cosf(2.0f * pi * (float)n / (float)(taps - 1));
+        h[n] = sinc * hamming;
+        soma += h[n];
+    }
+
+    int32_t soma_q15 = 0;
+    for (uint32_t n = 0; n < taps; n++)
+    {
+        dec->fir.coeficientes[n] = (int16_t)lroundf(h[n] / soma * 32768.0f);
+        soma_q15 += dec->fir.coeficientes[n];
+    }
+    dec->fir.coeficientes[taps / 2] += (int16_t)(32768 - soma_q15);
+}
+
+bool dec_iniciar(dec_decimador_t *dec, const dec_config_t *config)
+{
+    memset(dec, 0, sizeof *dec);
+    dec->tipo = config->tipo;
+    dec->fator = config->fator ? config->fator : 1;
+
+    switch (dec->tipo)
+    {
+    case DEC_NENHUM:
+        dec->fator = 1;
+        return true;
+    case DEC_CIC:
+        if (dec->fator > DEC_CIC_FATOR_MAX)
+            return false;
+        dec->cic.ganho = (int32_t)(dec->fator * dec->fator * dec->fator);
+        return true;
+    case DEC_FIR:
+        if (dec->fator > DEC_FIR_FATOR_MAX)
+            return false;
+        projetar_fir(dec);
+        return true;
+    }
+    return false;
+}
+
+static bool cic_adicionar(dec_decimador_t *dec, const int16_t entrada[DEC_NUM_CANAIS], int16_t saida[DEC_NUM_CANAIS])
+{
+    // Integradores na taxa de entrada. O estouro é intencional: em aritmética
+    // modular o pente desfaz a volta e o resultado final cabe em 32 bits.
+    for (int c = 0; c < DEC_NUM_CANAIS; c++)
+    {
+        uint32_t v = (uint32_t)(int32_t)entrada[c];
+        for (int e = 0; e < DEC_CIC_ESTAGIOS; e++)
+        {
+            dec->cic.integradores[e][c] += v;
+            v = dec->cic.integradores[e][c];
+        }
+    }
+
+    if (++dec->fase < dec->fator)
+        return false;
+    dec->fase = 0;
+
+    // Pentes na taxa de saída, seguidos da divisão pelo ganho com arredondamento
+    int32_t meio = dec->cic.ganho / 2;
+    for (int c = 0; c < DEC_NUM_CANAIS; c++)
+    {
+        uint32_t v = dec->cic.integradores[DEC_CIC_ESTAGIOS - 1][c];
+        for (int e = 0; e < DEC_CIC_ESTAGIOS; e++)
+        {
+            uint32_t anterior = dec->cic.pentes[e][c];
+            dec->cic.pentes[e][c] = v;
+            v -= anterior;
+        }
+        int32_t y = (int32_t)v;
+        saida[c] = saturar((y >= 0 ? y + meio : y - meio) / dec->cic.ganho);
+    }
+    return true;
+}
+
+static bool fir_adicionar(dec_decimador_t *dec, const int16_t entrada[DEC_NUM_CANAIS], int16_t saida[DEC_NUM_CANAIS])
+{
+    uint32_t taps = dec->fir.taps;
+    uint32_t p = dec->fir.posicao;
+    for (int c = 0; c < DEC_NUM_CANAIS; c++)
+    {
+        dec->fir.historico[c][p] = entrada[c];
+        dec->fir.historico[c][p + taps] = entrada[c];
+    }
+    dec->fir.posicao = p + 1 == taps ? 0 : p + 1;
+
+    if (++dec->fase < dec->fator)
+        return false;
+    dec->fase = 0;
+
+    // historico[posicao .. posicao + taps - 1] vai da amostra mais antiga à mais nova.
+    // Q15 x 16 bits com soma dos |coeficientes| perto de 1,2 cabe em int32.
+    const int16_t *h = dec->fir.coeficientes;
+    for (int c = 0; c < DEC_NUM_CANAIS; c++)
+    {
+        const int16_t *x = &dec->fir.historico[c][dec->fir.posicao];
+        int32_t acc = 1 << 14;
+        for (uint32_t n = 0; n < taps; n++)
+            acc += (int32_t)h[n] * x[n];
+        saida[c] = saturar(acc >> 15);
+    }
+    return true;
+}
+
+bool dec_adicionar(dec_decimador_t *dec, const int16_t entrada[DEC_NUM_CANAIS], int16_t saida[DEC_NUM_CANAIS])
+{
+    switch (dec->tipo)
+    {
+    case DEC_CIC:
+        return cic_adicionar(dec, entrada, saida);
+    case DEC_FIR:
+        return fir_adicionar(dec, entrada, saida);
+    default:
+        memcpy(saida, entrada, DEC_NUM_CANAIS * sizeof(int16_t));
+        return true;
+    }
+}
+
+uint32_t dec_atraso_meias_amostras(const dec_decimador_t *dec)
+{
+    switch (dec->tipo)
+    {
+    case DEC_CIC:
+        return DEC_CIC_ESTAGIOS * (dec->fator - 1);
+    case DEC_FIR:
+        return dec->fir.taps - 1;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,69 @@
+// decimacao.h
+#ifndef DECIMACAO_H
+#define DECIMACAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Canais filtrados: ax, ay, az, gx, gy, gz, temp
+#define DEC_NUM_CANAIS 7
+
+// CIC de 3 estágios em aritmética modular de 32 bits: o ganho R³ de um sinal de
+// 16 bits cabe enquanto 2^15·R³ < 2^31, ou seja, R até 40
+#define DEC_CIC_ESTAGIOS 3
+#define DEC_CIC_FATOR_MAX 40
+
+// FIR de fase linear com 8·R + 1 coeficientes Q15, limitado a DEC_FIR_MAX_TAPS
+#define DEC_FIR_MAX_TAPS 129
+#define DEC_FIR_FATOR_MAX 64
+
+typedef enum
+{
+    DEC_NENHUM = 0, // Sem decimação: a amostra bruta segue adiante
+    DEC_CIC,        // Integrador-pente: só somas, barato, queda lenta acima da banda
+    DEC_FIR         // FIR janelado (Hamming), corte em 0,8 da nova Nyquist
+} dec_tipo_t;
+
+typedef struct
+{
+    dec_tipo_t tipo;
+    uint32_t fator; // Uma saída a cada 'fator' entradas
+} dec_config_t;
+
+// Estado do filtro. O FIR é polifásico na prática: as entradas só são guardadas
+// e os produtos são calculados apenas para as amostras que saem.
+typedef struct
+{
+    dec_tipo_t tipo;
+    uint32_t fator;
+    uint32_t fase; // Entradas desde a última saída
+    union
+    {
+        struct
+        {
+            uint32_t integradores[DEC_CIC_ESTAGIOS][DEC_NUM_CANAIS];
+            uint32_t pentes[DEC_CIC_ESTAGIOS][DEC_NUM_CANAIS]; // Saída anterior de cada integrador
+            int32_t ganho;                                    // R³
+        } cic;
+        struct
+        {
+            uint32_t taps;
+            uint32_t posicao;
+            int16_t coeficientes[DEC_FIR_MAX_TAPS];
+            // Cada amostra é escrita em duas posições para a janela ser sempre contígua
+            int16_t historico[DEC_NUM_CANAIS][2 * DEC_FIR_MAX_TAPS];
+        } fir;
+    };
+} dec_decimador_t;
+
+// Prepara o filtro. Os coeficientes do FIR são projetados aqui, uma única vez;
+// o caminho por amostra é todo inteiro. Retorna false se o fator não for suportado.
+bool dec_iniciar(dec_decimador_t *dec, const dec_config_t *config);
+
+// Filtra uma amostra. Retorna true quando 'saida' recebeu uma amostra decimada.
+bool dec_adicionar(dec_decimador_t *dec, const int16_t entrada[DEC_NUM_CANAIS], int16_t saida[DEC_NUM_CANAIS]);
+
+// Atraso de grupo em meias amostras de entrada, para corrigir o timestamp da saída
+uint32_t dec_atraso_meias_amostras(const dec_decimador_t *dec);
+
+#endif // DECIMACAO_H
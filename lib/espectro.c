@@ -0,0 +1,232 @@
+#include "espectro.h"
+#include <math.h>
+#include <string.h>
+
+// Tabelas Q15 para a maior FFT; tamanhos menores usam um passo maior.
+// São calculadas uma vez, na primeira sessão com espectro.
+static int16_t g_cosseno[ESP_FFT_MAX / 2];
+static int16_t g_seno[ESP_FFT_MAX / 2];
+static int16_t g_hann[ESP_FFT_MAX];
+static uint32_t g_pontos_hann;
+
+// Área de trabalho da FFT (um eixo por vez)
+static int16_t g_re[ESP_FFT_MAX];
+static int16_t g_im[ESP_FFT_MAX];
+
+// Acima disso uma borboleta sem escala pode estourar 16 bits: |a + w·b| <= (1 + √2)·max.
+// Acima do dobro, nem dividir por 2 basta, e o estágio divide por 4.
+#define LIMIAR_ESCALA 13573
+
+static int16_t q15(float v)
+{
+    int32_t q = (int32_t)lroundf(v * 32768.0f);
+    return (int16_t)(q > INT16_MAX ? INT16_MAX : q);
+}
+
+static void preparar_tabelas(uint32_t pontos)
+{
+    const float pi = 3.14159265f;
+    if (g_cosseno[0] == 0)
+    {
+        for (uint32_t k = 0; k < ESP_FFT_MAX / 2; k++)
+        {
+            g_cosseno[k] = q15(cosf(2.0f * pi * (float)k / ESP_FFT_MAX));
+            g_seno[k] = q15(sinf(2.0f * pi * (float)k / ESP_FFT_MAX));
+        }
+    }
+    if (g_pontos_hann != pontos)
+    {
+        for (uint32_t n = 0; n < pontos; n++)
+            g_hann[n] = q15(0.5f - 0.5f * cosf(2.0f * pi * (float)n / (float)pontos));
+        g_pontos_hann = pontos;
+    }
+}
+
+bool esp_iniciar(esp_analisador_t *esp, const esp_config_t *config, uint32_t odr_hz)
+{
+    uint32_t n = config->pontos;
+    if (n < 16 || n > ESP_FFT_MAX || (n & (n - 1)) || odr_hz == 0 ||
+        config->num_bandas == 0 || config->num_bandas > ESP_MAX_BANDAS)
+        return false;
+
+    esp->pontos = n;
+    esp->log2_pontos = 0;
+    while ((1u << esp->log2_pontos) < n)
+        esp->log2_pontos++;
+    esp->odr_hz = odr_hz;
+    esp->num_bandas = config->num_bandas;
+
+    // Bordas em bins, limitadas à Nyquist. A borda superior de uma banda é exclusiva.
+    for (uint32_t b = 0; b <= esp->num_bandas; b++)
+    {
+        uint32_t bin = (uint32_t)config->bordas_hz[b] * n / odr_hz;
+        esp->bin_borda[b] = (uint16_t)(bin > n / 2 ? n / 2 : bin);
+    }
+
+    esp->preenchidas = 0;
+    esp->bloco_escrita = 0;
+    esp->pendente = false;
+    esp->blocos_perdidos = 0;
+    preparar_tabelas(n);
+    return true;
+}
+
+bool esp_adicionar(esp_analisador_t *esp, const int16_t eixos[ESP_NUM_EIXOS])
+{
+    uint32_t i = esp->preenchidas;
+    for (int e = 0; e < ESP_NUM_EIXOS; e++)
+        esp->blocos[esp->bloco_escrita][e][i] = eixos[e];
+    if (++esp->preenchidas < esp->pontos)
+        return false;
+
+    esp->preenchidas = 0;
+    if (esp->pendente)
+    {
+        // A FFT do bloco anterior não terminou: este é sobrescrito pelo próximo
+        esp->blocos_perdidos++;
+        return false;
+    }
+    esp->bloco_escrita ^= 1;
+    esp->pendente = true;
+    return true;
+}
+
+// FFT complexa radix-2 (decimação no tempo), in-place, com escala em bloco:
+// um estágio só divide por 2 ou por 4 quando os valores podem estourar. Retorna o número
+// de divisões, para a saída valer FFT / 2^expoente.
+static uint32_t fft(uint32_t n, int32_t maximo)
+{
+    // Permutação por bits invertidos
+    for (uint32_t i = 1, j = 0; i < n; i++)
+    {
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+        if (i < j)
+        {
+            int16_t t = g_re[i];
+            g_re[i] = g_re[j];
+            g_re[j] = t;
+            t = g_im[i];
+            g_im[i] = g_im[j];
+            g_im[j] = t;
+        }
+    }
+
+    uint32_t expoente = 0;
+    for (uint32_t meio = 1, passo = ESP_FFT_MAX / 2; meio < n; meio <<= 1, passo >>= 1)
+    {
+        uint32_t escala = maximo > 2 * LIMIAR_ESCALA ? 2 : maximo > LIMIAR_ESCALA ? 1 : 0;
+        expoente += escala;
+        maximo = 0;
+        for (uint32_t j = 0; j < meio; j++)
+        {
+            int32_t c = g_cosseno[j * passo];
+            int32_t s = g_seno[j * passo];
+            for (uint32_t i = j; i < n; i += 2 * meio)
+            {
+                uint32_t k = i + meio;
+                // w·x[k] com w = cos - j·sen
+                int32_t tr = (c * g_re[k] + s * g_im[k] + (1 << 14)) >> 15;
+                int32_t ti = (c * g_im[k] - s * g_re[k] + (1 << 14)) >> 15;
+                int32_t ar = g_re[i], ai = g_im[i];
+                int32_t v[4] = {(ar + tr) >> escala, (ai + ti) >> escala,
+                                (ar - tr) >> escala, (ai - ti) >> escala};
+                g_re[i] = (int16_t)v[0];
+                g_im[i] = (int16_t)v[1];
+                g_re[k] = (int16_t)v[2];
+                g_im[k] = (int16_t)v[3];
+                for (int m = 0; m < 4; m++)
+                {
+                    int32_t a = v[m] < 0 ? -v[m] : v[m];
+                    if (a > maximo)
+                        maximo = a;
+                }
+            }
+        }
+    }
+    return expoente;
+}
+
+static void analisar_eixo(esp_analisador_t *esp, const int16_t *x, uint32_t eixo, esp_resultado_t *resultado)
+{
+    uint32_t n = esp->pontos;
+
+    // Remove o DC (a gravidade, no acelerômetro) antes da janela, para o vazamento
+    // dele não encobrir as bandas baixas
+    int32_t soma = 0;
+    for (uint32_t i = 0; i < n; i++)
+        soma += x[i];
+    int32_t media = soma / (int32_t)n;
+
+    int32_t maximo = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int32_t v = ((x[i] - media) * (int32_t)g_hann[i]) >> 15;
+        v = v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+        g_re[i] = (int16_t)v;
+        g_im[i] = 0;
+        int32_t a = v < 0 ? -v : v;
+        if (a > maximo)
+            maximo = a;
+    }
+    uint32_t expoente = fft(n, maximo);
+
+    // |X|² de cada bin da metade positiva (cabe em 32 bits: 2·2^30)
+    uint32_t maior = 0, k_pico = 1;
+    uint64_t energia[ESP_MAX_BANDAS] = {0};
+    uint32_t b = 0;
+    for (uint32_t k = 1; k < n / 2; k++)
+    {
+        uint32_t p = (uint32_t)((int32_t)g_re[k] * g_re[k]) + (uint32_t)((int32_t)g_im[k] * g_im[k]);
+        if (p > maior)
+        {
+            maior = p;
+            k_pico = k;
+        }
+        while (b < esp->num_bandas && k >= esp->bin_borda[b + 1])
+            b++;
+        if (b < esp->num_bandas && k >= esp->bin_borda[b])
+            energia[b] += p;
+    }
+
+    // Parseval com a saída escalada por 2^expoente e a metade negativa somada:
+    // média quadrática = 2·Σ|X|²·2^(2·expoente) / N². O fator 8/3 desfaz a
+    // atenuação de potência da janela de Hann.
+    int32_t desloc = 2 * (int32_t)esp->log2_pontos - 2 * (int32_t)expoente - 1;
+    for (uint32_t i = 0; i < esp->num_bandas; i++)
+    {
+        uint64_t e = energia[i] * 8 / 3;
+        e = desloc >= 0 ? e >> desloc : e << -desloc;
+        resultado->energia[eixo][i] = e > UINT32_MAX ? UINT32_MAX : (uint32_t)e;
+    }
+
+    // Interpolação parabólica entre os vizinhos do pico, para resolução abaixo de um bin:
+    // delta = (a - c) / (2·(a - 2p + c)) e freq = (k + delta)·ODR / N
+    int64_t a = 0, c = 0, p = maior;
+    if (k_pico > 1)
+        a = (int64_t)g_re[k_pico - 1] * g_re[k_pico - 1] + (int64_t)g_im[k_pico - 1] * g_im[k_pico - 1];
+    if (k_pico + 1 < n / 2)
+        c = (int64_t)g_re[k_pico + 1] * g_re[k_pico + 1] + (int64_t)g_im[k_pico + 1] * g_im[k_pico + 1];
+    int64_t curvatura = a - 2 * p + c;
+    uint32_t pico_dhz;
+    if (curvatura < 0)
+        pico_dhz = (uint32_t)(10 * (int64_t)esp->odr_hz * (2 * (int64_t)k_pico * curvatura + (a - c)) /
+                              (2 * curvatura * (int64_t)n));
+    else
+        pico_dhz = 10 * k_pico * esp->odr_hz / n;
+    resultado->pico_dhz[eixo] = maior ? (uint16_t)(pico_dhz > UINT16_MAX ? UINT16_MAX : pico_dhz) : 0;
+}
+
+void esp_calcular(esp_analisador_t *esp, esp_resultado_t *resultado)
+{
+    memset(resultado, 0, sizeof *resultado);
+    if (!esp->pendente)
+        return;
+    // O bloco pendente é o que não está sendo escrito
+    uint8_t bloco = esp->bloco_escrita ^ 1;
+    for (uint32_t e = 0; e < ESP_NUM_EIXOS; e++)
+        analisar_eixo(esp, esp->blocos[bloco][e], e, resultado);
+    esp->pendente = false;
+}
@@ -0,0 +1,57 @@
+// espectro.h
+#ifndef ESPECTRO_H
+#define ESPECTRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Eixos analisados: ax, ay, az
+#define ESP_NUM_EIXOS 3
+
+// Maior FFT suportada e maior número de bandas por eixo
+#define ESP_FFT_MAX 512
+#define ESP_MAX_BANDAS 6
+
+typedef struct
+{
+    uint16_t pontos;                          // Tamanho da FFT (potência de 2, 16 a ESP_FFT_MAX); 0 desliga
+    uint8_t num_bandas;                       // 1 a ESP_MAX_BANDAS
+    uint16_t bordas_hz[ESP_MAX_BANDAS + 1];   // Banda b vai de bordas_hz[b] a bordas_hz[b + 1]
+} esp_config_t;
+
+// Espectro de um bloco. A energia de cada banda é a contribuição dela à média
+// quadrática do sinal (LSB², já corrigida pela janela de Hann): sqrt(energia)
+// é o RMS da banda em LSB.
+typedef struct
+{
+    uint32_t energia[ESP_NUM_EIXOS][ESP_MAX_BANDAS];
+    uint16_t pico_dhz[ESP_NUM_EIXOS]; // Frequência do maior pico fora do DC, em décimos de Hz
+} esp_resultado_t;
+
+// Blocos de amostras com buffer duplo: o caminho de amostragem enche um bloco
+// enquanto o outro espera a FFT, que roda fora da IRQ.
+typedef struct
+{
+    uint32_t pontos;
+    uint32_t log2_pontos;
+    uint32_t odr_hz;
+    uint32_t num_bandas;
+    uint16_t bin_borda[ESP_MAX_BANDAS + 1];
+    uint32_t preenchidas;       // Amostras no bloco em enchimento
+    uint8_t bloco_escrita;      // Bloco em enchimento
+    volatile bool pendente;     // O outro bloco espera esp_calcular()
+    uint32_t blocos_perdidos;   // Blocos completos que encontraram a FFT ainda ocupada
+    int16_t blocos[2][ESP_NUM_EIXOS][ESP_FFT_MAX];
+} esp_analisador_t;
+
+// Prepara a análise para o ODR informado. Retorna false se a configuração for inválida.
+bool esp_iniciar(esp_analisador_t *esp, const esp_config_t *config, uint32_t odr_hz);
+
+// Guarda uma amostra dos eixos. Retorna true quando um bloco completou e ficou
+// pendente; se o anterior ainda não foi calculado, o novo é descartado.
+bool esp_adicionar(esp_analisador_t *esp, const int16_t eixos[ESP_NUM_EIXOS]);
+
+// Calcula o espectro do bloco pendente e o libera para o caminho de amostragem
+void esp_calcular(esp_analisador_t *esp, esp_resultado_t *resultado);
+
+#endif // ESPECTRO_H
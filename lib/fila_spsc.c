@@ -0,0 +1,59 @@
+#include "fila_spsc.h"
+#include <string.h>
+
+void fila_spsc_init(fila_spsc_t *fila, void *buffer, uint32_t tamanho_elemento, uint32_t capacidade)
+{
+    fila->dados = buffer;
+    fila->tamanho_elemento = tamanho_elemento;
+    fila->mascara = capacidade - 1;
+    fila->cabeca = 0;
+    fila->cauda = 0;
+    fila->maior_ocupacao = 0;
+    fila->descartes = 0;
+}
+
+bool fila_spsc_inserir(fila_spsc_t *fila, const void *elemento)
+{
+    uint32_t cabeca = fila->cabeca;
+    // Índices crescem livremente; a diferença sem sinal é a ocupação mesmo após o wrap de 32 bits
+    uint32_t ocupacao = cabeca - fila->cauda;
+    if (ocupacao > fila->mascara)
+    {
+        fila->descartes++;
+        return false;
+    }
+    if (ocupacao + 1 > fila->maior_ocupacao)
+        fila->maior_ocupacao = ocupacao + 1;
+
+    memcpy(&fila->dados[(cabeca & fila->mascara) * fila->tamanho_elemento], elemento, fila->tamanho_elemento);
+    // O elemento precisa estar visível para o outro core antes do novo índice
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    fila->cabeca = cabeca + 1;
+    return true;
+}
+
+bool fila_spsc_remover(fila_spsc_t *fila, void *elemento)
+{
+    uint32_t cauda = fila->cauda;
+    if (cauda == fila->cabeca)
+        return false;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    memcpy(elemento, &fila->dados[(cauda & fila->mascara) * fila->tamanho_elemento], fila->tamanho_elemento);
+    // A cópia precisa terminar antes de liberar a posição para o produtor
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    fila->cauda = cauda + 1;
+    return true;
+}
+
+uint32_t fila_spsc_ocupacao(const fila_spsc_t *fila)
+{
+    return fila->cabeca - fila->cauda;
+}
+
+void fila_spsc_limpar(fila_spsc_t *fila)
+{
+    fila->cauda = fila->cabeca;
+    fila->maior_ocupacao = 0;
+    fila->descartes = 0;
+}
@@ -0,0 +1,43 @@
+// fila_spsc.h
+#ifndef FILA_SPSC_H
+#define FILA_SPSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fila circular sem travas para exatamente um produtor e um consumidor
+// (ex.: IRQ de aquisição no core 1 -> loop principal no core 0). Cada lado
+// só escreve o próprio índice; os elementos são copiados por valor.
+typedef struct
+{
+    uint8_t *dados;
+    uint32_t tamanho_elemento;
+    uint32_t mascara;         // capacidade - 1 (capacidade potência de 2)
+    volatile uint32_t cabeca; // Próxima posição a escrever (só o produtor altera)
+    volatile uint32_t cauda;  // Próxima posição a ler (só o consumidor altera)
+    // Contadores do produtor: maior ocupação já vista e inserções recusadas por fila cheia
+    volatile uint32_t maior_ocupacao;
+    volatile uint32_t descartes;
+} fila_spsc_t;
+
+// 'buffer' deve ter capacidade * tamanho_elemento bytes; capacidade deve ser potência de 2
+void fila_spsc_init(fila_spsc_t *fila, void *buffer, uint32_t tamanho_elemento, uint32_t capacidade);
+
+// Lado produtor. Retorna false (e conta um descarte) se a fila estiver cheia.
+bool fila_spsc_inserir(fila_spsc_t *fila, const void *elemento);
+
+// Lado consumidor. Retorna false se a fila estiver vazia.
+bool fila_spsc_remover(fila_spsc_t *fila, void *elemento);
+
+// Elementos aguardando leitura (válido em qualquer um dos lados)
+uint32_t fila_spsc_ocupacao(const fila_spsc_t *fila);
+
+static inline uint32_t fila_spsc_capacidade(const fila_spsc_t *fila)
+{
+    return fila->mascara + 1;
+}
+
+// Descarta tudo e zera os contadores (só com o produtor parado)
+void fila_spsc_limpar(fila_spsc_t *fila);
+
+#endif // FILA_SPSC_H
@@ -0,0 +1,95 @@
+#include "formatacao.h"
+
+// "00" a "99": um acesso à tabela e uma divisão por 100 a cada dois dígitos
+static const char pares[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static int num_digitos(uint32_t v)
+{
+    if (v < 10000)
+        return v < 10 ? 1 : v < 100 ? 2 : v < 1000 ? 3 : 4;
+    if (v < 100000000)
+        return v < 100000 ? 5 : v < 1000000 ? 6 : v < 10000000 ? 7 : 8;
+    return v < 1000000000 ? 9 : 10;
+}
+
+// Escreve exatamente 'n' dígitos de 'v' (com zeros à esquerda) terminando em p + n
+static void escrever_digitos(char *p, uint32_t v, int n)
+{
+    char *fim = p + n;
+    while (n >= 2)
+    {
+        uint32_t par = (v % 100) * 2;
+        v /= 100;
+        fim -= 2;
+        fim[0] = pares[par];
+        fim[1] = pares[par + 1];
+        n -= 2;
+    }
+    if (n)
+        *--fim = (char)('0' + v % 10);
+}
+
+char *fmt_u32(char *p, uint32_t v)
+{
+    int n = num_digitos(v);
+    escrever_digitos(p, v, n);
+    return p + n;
+}
+
+char *fmt_i32(char *p, int32_t v)
+{
+    if (v < 0)
+    {
+        *p++ = '-';
+        return fmt_u32(p, 0u - (uint32_t)v);
+    }
+    return fmt_u32(p, (uint32_t)v);
+}
+
+// Divide por 10000 em quatro passos de 16 bits: o resto parcial é menor que 10000,
+// então cada dividendo cabe em 32 bits
+static uint64_t dividir_10000(uint64_t v, uint32_t *resto)
+{
+    uint32_t r = 0;
+    uint64_t q = 0;
+    for (int i = 48; i >= 0; i -= 16)
+    {
+        uint32_t parte = r << 16 | ((uint32_t)(v >> i) & 0xFFFFu);
+        q = q << 16 | parte / 10000;
+        r = parte % 10000;
+    }
+    *resto = r;
+    return q;
+}
+
+char *fmt_u64(char *p, uint64_t v)
+{
+    if (v <= UINT32_MAX)
+        return fmt_u32(p, (uint32_t)v);
+
+    // Grupos de 4 dígitos, do menos significativo, até o resto caber em 32 bits
+    uint32_t grupos[4];
+    int n = 0;
+    while (v > UINT32_MAX)
+        v = dividir_10000(v, &grupos[n++]);
+    p = fmt_u32(p, (uint32_t)v);
+    while (n)
+    {
+        escrever_digitos(p, grupos[--n], 4);
+        p += 4;
+    }
+    return p;
+}
+
+char *fmt_campos_i16(char *p, const int16_t *v, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        *p++ = ';';
+        p = fmt_i32(p, v[i]);
+    }
+    return p;
+}
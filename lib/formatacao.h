@@ -0,0 +1,27 @@
+// formatacao.h
+#ifndef FORMATACAO_H
+#define FORMATACAO_H
+
+#include <stdint.h>
+
+// Conversão de inteiros para ASCII sem printf, para as linhas do CSV. O número de
+// dígitos sai de comparações e os dígitos são escritos de trás para frente, dois a
+// dois, a partir de uma tabela de 200 bytes. No RP2040 as divisões de 32 bits vão
+// para o divisor de hardware; os valores de 64 bits (timestamps) são reduzidos por
+// divisões de 32 bits, sem a divisão de 64 bits em software que o %llu usa.
+//
+// Cada função escreve a partir de 'p', sem terminador, e retorna o fim do texto.
+// O chamador garante o espaço: FMT_MAX_U64 bytes bastam para qualquer valor.
+
+#define FMT_MAX_U32 10
+#define FMT_MAX_I32 11
+#define FMT_MAX_U64 20
+
+char *fmt_u32(char *p, uint32_t v);
+char *fmt_i32(char *p, int32_t v);
+char *fmt_u64(char *p, uint64_t v);
+
+// ';' seguido de cada um dos 'n' valores, como ";%d;%d..." (até 7 bytes por valor)
+char *fmt_campos_i16(char *p, const int16_t *v, int n);
+
+#endif // FORMATACAO_H
@@ -0,0 +1,162 @@
+#include "gatilho.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MASCARA (GAT_AMOSTRAS_MAX - 1)
+
+// Distância entre duas posições do anel, correta mesmo depois de os contadores darem a volta
+static inline int32_t diferenca(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static uint32_t raiz(uint32_t v)
+{
+    uint32_t r = 0;
+    for (uint32_t bit = 1u << 30; bit; bit >>= 2)
+    {
+        if (v >= r + bit)
+        {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+        {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+bool gat_iniciar(gat_captura_t *g, const gat_config_t *config, uint16_t um_g, uint8_t num_sensores)
+{
+    if (num_sensores == 0 || num_sensores > GAT_MAX_SENSORES)
+        return false;
+    if (config->canal >= GAT_NUM_CANAIS || config->pre_amostras * num_sensores >= GAT_AMOSTRAS_MAX)
+        return false;
+    if (config->tipo != GAT_DESLIGADO && config->limiar <= 0)
+        return false;
+    if (config->tipo == GAT_MAGNITUDE && config->canal != 0 && config->canal != 3)
+        return false;
+
+    // O anel não precisa ser limpo: só as posições já escritas são lidas
+    memset(g, 0, offsetof(gat_captura_t, anel));
+    g->config = *config;
+    g->um_g = config->canal == 0 ? um_g : 0;
+    g->num_sensores = num_sensores;
+    g->pre_posicoes = config->pre_amostras * num_sensores;
+    g->pos_posicoes = config->pos_amostras * num_sensores;
+
+    // Magnitude: fora da casca [1 g - limiar, 1 g + limiar] no accel (choque ou queda
+    // livre), acima do limiar no gyro. Comparado ao quadrado, sem raiz por amostra.
+    uint32_t acima = (uint32_t)g->um_g + (uint32_t)config->limiar;
+    g->limiar2_acima = acima > 65535 ? UINT32_MAX : acima * acima;
+    if (config->limiar < g->um_g)
+    {
+        uint32_t abaixo = (uint32_t)(g->um_g - config->limiar);
+        g->limiar2_abaixo = abaixo * abaixo;
+    }
+    return true;
+}
+
+static bool avaliar(gat_captura_t *g, const int16_t canais[GAT_NUM_CANAIS], uint8_t s, int32_t *valor)
+{
+    const gat_config_t *c = &g->config;
+    int32_t v;
+    switch (c->tipo)
+    {
+    case GAT_LIMIAR:
+        v = canais[c->canal];
+        *valor = v;
+        return (v < 0 ? -v : v) > c->limiar;
+    case GAT_INCLINACAO:
+        if (!(g->tem_anterior & (1u << s)))
+            return false;
+        v = canais[c->canal] - g->anterior[s][c->canal];
+        *valor = v;
+        return (v < 0 ? -v : v) > c->limiar;
+    case GAT_MAGNITUDE:
+    {
+        uint32_t m2 = 0;
+        for (int i = 0; i < 3; i++)
+            m2 += (uint32_t)((int32_t)canais[c->canal + i] * canais[c->canal + i]);
+        if (m2 <= g->limiar2_acima && m2 >= g->limiar2_abaixo)
+            return false;
+        // A raiz só é calculada no disparo
+        *valor = (int32_t)raiz(m2) - g->um_g;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool gat_adicionar(gat_captura_t *g, const gat_amostra_t *amostra, bool forcar, gat_evento_t *evento)
+{
+    uint32_t i = g->escritas;
+    g->anel[i & MASCARA] = *amostra;
+    g->escritas = i + 1;
+
+    // Anel cheio de amostras de evento ainda não publicadas: a mais antiga se perde
+    if (diferenca(g->fim_evento, g->publicadas) > 0 && diferenca(g->escritas, g->publicadas) > GAT_AMOSTRAS_MAX)
+    {
+        g->publicadas++;
+        g->perdidas++;
+    }
+
+    int32_t valor = 0;
+    uint8_t s = amostra->sensor < g->num_sensores ? amostra->sensor : 0;
+    bool disparou = avaliar(g, amostra->canais, s, &valor) || forcar;
+    memcpy(g->anterior[s], amostra->canais, sizeof g->anterior[s]);
+    g->tem_anterior |= (uint8_t)(1u << s);
+    if (!disparou)
+        return false;
+
+    // Dentro da janela posterior de um evento: só estende o evento
+    if (diferenca(i, g->fim_evento) < 0)
+    {
+        g->fim_evento = i + 1 + g->pos_posicoes;
+        return false;
+    }
+
+    // O início recua até pre_amostras de cada sensor, limitado ao que o anel ainda guarda
+    // e ao que já foi publicado (o fim do evento anterior)
+    uint32_t inicio = i - g->pre_posicoes;
+    if (diferenca(g->escritas - GAT_AMOSTRAS_MAX, inicio) > 0)
+        inicio = g->escritas - GAT_AMOSTRAS_MAX;
+    if (diferenca(g->publicadas, inicio) > 0)
+        inicio = g->publicadas;
+
+    g->publicadas = inicio;
+    g->fim_evento = i + 1 + g->pos_posicoes;
+    g->eventos++;
+
+    evento->numero = g->eventos;
+    evento->tipo = forcar ? GAT_DESLIGADO : (uint8_t)g->config.tipo;
+    evento->canal = g->config.canal;
+    evento->sensor = s;
+    evento->valor = valor;
+    evento->pre_amostras = (i - inicio) / g->num_sensores;
+    return true;
+}
+
+// Fim das amostras de evento já escritas no anel
+static uint32_t limite(const gat_captura_t *g)
+{
+    return diferenca(g->fim_evento, g->escritas) < 0 ? g->fim_evento : g->escritas;
+}
+
+bool gat_proxima(gat_captura_t *g, gat_amostra_t *amostra)
+{
+    if (diferenca(limite(g), g->publicadas) <= 0)
+        return false;
+    *amostra = g->anel[g->publicadas & MASCARA];
+    g->publicadas++;
+    return true;
+}
+
+uint32_t gat_pendentes(const gat_captura_t *g)
+{
+    int32_t n = diferenca(limite(g), g->publicadas);
+    return n > 0 ? (uint32_t)n : 0;
+}
@@ -0,0 +1,94 @@
+// gatilho.h
+#ifndef GATILHO_H
+#define GATILHO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Canais de cada amostra: ax, ay, az, gx, gy, gz, temp
+#define GAT_NUM_CANAIS 7
+
+// Amostras guardadas antes do disparo (potência de 2). Com 1024, ~1 s a 1 kHz ou
+// ~10 s a 100 Hz; cada amostra ocupa 32 bytes de RAM. Com vários sensores o anel
+// é dividido entre eles.
+#ifndef GAT_AMOSTRAS_MAX
+#define GAT_AMOSTRAS_MAX 1024
+#endif
+
+// Sensores avaliados pelo detector; as amostras de todos entram intercaladas no anel
+#define GAT_MAX_SENSORES 4
+
+typedef enum
+{
+    GAT_DESLIGADO = 0,
+    GAT_LIMIAR,     // |canal| acima do limiar
+    GAT_INCLINACAO, // |canal[n] - canal[n-1]| acima do limiar (LSB por amostra)
+    GAT_MAGNITUDE   // Vetor accel (canal 0, descontado 1 g) ou gyro (canal 3) acima do limiar
+} gat_tipo_t;
+
+typedef struct
+{
+    gat_tipo_t tipo;
+    uint8_t canal;         // 0 a 6; na magnitude, 0 = accel e 3 = gyro
+    int32_t limiar;        // LSB do canal
+    uint32_t pre_amostras; // Por sensor, gravadas antes do disparo (x sensores < GAT_AMOSTRAS_MAX)
+    uint32_t pos_amostras; // Por sensor, gravadas depois; um novo disparo dentro delas estende o evento
+} gat_config_t;
+
+// Amostra guardada no anel, com o quaternion do instante (Q14) para a orientação
+// sair junto quando ela for publicada
+typedef struct
+{
+    uint64_t timestamp_us;
+    int16_t canais[GAT_NUM_CANAIS];
+    int16_t q[4];
+    uint8_t sensor;
+} gat_amostra_t;
+
+// Descrição de um evento, publicada antes das amostras dele
+typedef struct
+{
+    uint32_t numero;       // 1, 2, ... dentro da sessão
+    uint8_t tipo;          // gat_tipo_t que disparou (GAT_DESLIGADO = disparo manual)
+    uint8_t canal;
+    uint8_t sensor;        // Sensor em que a condição foi atendida
+    int32_t valor;         // Valor que cruzou o limiar (magnitude em LSB, já sem a gravidade)
+    uint32_t pre_amostras; // Amostras anteriores ao disparo realmente disponíveis, por sensor
+} gat_evento_t;
+
+// Anel de pré-disparo e detector. As posições são contadores livres de 32 bits:
+// amostras de [publicadas, fim_evento) pertencem a um evento e ainda não saíram.
+// As janelas contam posições do anel (amostras por sensor x sensores); como os
+// sensores chegam intercalados, a borda de cada um erra por poucas amostras.
+typedef struct
+{
+    gat_config_t config;
+    uint32_t limiar2_acima, limiar2_abaixo; // Magnitude: |v|² fora de [abaixo, acima] dispara
+    uint16_t um_g;
+    uint8_t num_sensores;
+    uint8_t tem_anterior; // Bit por sensor
+    uint32_t pre_posicoes, pos_posicoes;
+    int16_t anterior[GAT_MAX_SENSORES][GAT_NUM_CANAIS];
+    uint32_t escritas;
+    uint32_t publicadas;
+    uint32_t fim_evento;
+    uint32_t eventos;
+    uint32_t perdidas; // Amostras de evento sobrescritas antes de sair do anel
+    gat_amostra_t anel[GAT_AMOSTRAS_MAX];
+} gat_captura_t;
+
+// 'um_g' é 1 g em LSB do acelerômetro, descontado na magnitude do accel (os sensores
+// usam o mesmo fundo de escala). Retorna false se a configuração for inválida.
+bool gat_iniciar(gat_captura_t *g, const gat_config_t *config, uint16_t um_g, uint8_t num_sensores);
+
+// Guarda a amostra e avalia a condição no sensor dela ('forcar' dispara sem avaliar). Retorna true
+// quando um novo evento começou, preenchendo 'evento'.
+bool gat_adicionar(gat_captura_t *g, const gat_amostra_t *amostra, bool forcar, gat_evento_t *evento);
+
+// Próxima amostra de evento a publicar, na ordem de captura. Retorna false se não houver.
+bool gat_proxima(gat_captura_t *g, gat_amostra_t *amostra);
+
+// Amostras de evento que ainda esperam no anel
+uint32_t gat_pendentes(const gat_captura_t *g);
+
+#endif // GATILHO_H
@@ -0,0 +1,234 @@
+#include "gravador.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// O arquivo por trás do gravador: o FIL do FatFs ou o destino de gravador_usar_destino
+static bool escrever(gravador_t *g, const void *dados, uint32_t len)
+{
+    UINT escritos = 0;
+    FRESULT fr = g->destino ? g->destino->escrever(g->destino->contexto, dados, len, &escritos)
+                            : f_write(g->arquivo, dados, len, &escritos);
+    return fr == FR_OK && escritos == len;
+}
+
+static bool posicionar(gravador_t *g, FSIZE_t posicao)
+{
+    return (g->destino ? g->destino->posicionar(g->destino->contexto, posicao) : f_lseek(g->arquivo, posicao)) == FR_OK;
+}
+
+static bool sincronizar(gravador_t *g)
+{
+    return (g->destino ? g->destino->sincronizar(g->destino->contexto) : f_sync(g->arquivo)) == FR_OK;
+}
+
+// Buffer cheio mais antigo: os prontos antecedem o ativo, em ordem circular
+static uint8_t mais_antigo(const gravador_t *g)
+{
+    return (uint8_t)((g->ativo + GRAV_NUM_BUFFERS - g->prontos) % GRAV_NUM_BUFFERS);
+}
+
+// O ponteiro do arquivo está sempre no primeiro byte do buffer mais antigo ainda
+// não gravado; um buffer que falhou é descartado para o gravador seguir adiante
+static bool gravar_mais_antigo(gravador_t *g)
+{
+    uint8_t i = mais_antigo(g);
+    bool ok = escrever(g, g->buffers[i], g->usados[i]);
+    if (ok)
+        g->escritas++;
+    else
+        g->falhas++;
+    g->usados[i] = 0;
+    g->prontos--;
+    return ok;
+}
+
+// O buffer ativo encheu: passa para a fila do cartão e o seguinte começa vazio
+static void trocar_ativo(gravador_t *g)
+{
+    g->posicao_ativo += g->usados[g->ativo];
+    g->prontos++;
+    g->ativo = (uint8_t)((g->ativo + 1) % GRAV_NUM_BUFFERS);
+    g->usados[g->ativo] = 0;
+    g->capacidade_ativo = GRAV_BLOCO_BYTES;
+}
+
+void gravador_iniciar(gravador_t *g, FIL *arquivo)
+{
+    memset(g->usados, 0, sizeof g->usados);
+    g->ativo = 0;
+    g->prontos = 0;
+    g->arquivo = arquivo;
+    g->destino = NULL;
+    g->posicao_ativo = f_tell(arquivo);
+    // Um arquivo que já tem dados raramente termina num setor: o primeiro bloco
+    // completa o setor corrente e os seguintes começam alinhados
+    g->capacidade_ativo = GRAV_BLOCO_BYTES - (uint32_t)(g->posicao_ativo % GRAV_SETOR);
+    g->pendente = false;
+    g->bytes = 0;
+    g->bytes_sincronizados = 0;
+    g->escritas = 0;
+    g->escritas_parciais = 0;
+    g->sincronizacoes = 0;
+    g->falhas = 0;
+}
+
+void gravador_usar_destino(gravador_t *g, const grav_destino_t *destino)
+{
+    g->destino = destino;
+}
+
+bool gravador_escrever(gravador_t *g, const void *dados, uint32_t len)
+{
+    const uint8_t *p = dados;
+    bool ok = true;
+    while (len)
+    {
+        uint32_t usados = g->usados[g->ativo];
+        uint32_t n = g->capacidade_ativo - usados;
+        if (n > len)
+            n = len;
+        memcpy(&g->buffers[g->ativo][usados], p, n);
+        g->usados[g->ativo] = usados + n;
+        g->bytes += n;
+        p += n;
+        len -= n;
+
+        if (g->usados[g->ativo] < g->capacidade_ativo)
+            break;
+        // Nenhum buffer livre: o cartão ficou para trás e a gravação acontece agora
+        if (g->prontos == GRAV_NUM_BUFFERS - 1 && !gravar_mais_antigo(g))
+            ok = false;
+        trocar_ativo(g);
+    }
+    g->pendente = true;
+    return ok;
+}
+
+char *gravador_reservar(gravador_t *g, uint32_t max, char *reserva)
+{
+    uint32_t usados = g->usados[g->ativo];
+    if (g->capacidade_ativo - usados < max)
+        return reserva;
+    return (char *)&g->buffers[g->ativo][usados];
+}
+
+bool gravador_confirmar(gravador_t *g, const char *inicio, uint32_t len)
+{
+    if (inicio != (const char *)&g->buffers[g->ativo][g->usados[g->ativo]])
+        return gravador_escrever(g, inicio, len);
+
+    // Já está no buffer: só avança, como gravador_escrever depois do memcpy
+    g->usados[g->ativo] += len;
+    g->bytes += len;
+    g->pendente = true;
+    if (g->usados[g->ativo] < g->capacidade_ativo)
+        return true;
+    bool ok = !(g->prontos == GRAV_NUM_BUFFERS - 1 && !gravar_mais_antigo(g));
+    trocar_ativo(g);
+    return ok;
+}
+
+int gravador_printf(gravador_t *g, const char *formato, ...)
+{
+    char linha[GRAV_LINHA_MAX];
+    va_list args;
+    va_start(args, formato);
+    int n = vsnprintf(linha, sizeof linha, formato, args);
+    va_end(args);
+    if (n < 0 || n >= (int)sizeof linha)
+    {
+        g->falhas++;
+        return -1;
+    }
+    return gravador_escrever(g, linha, (uint32_t)n) ? n : -1;
+}
+
+bool gravador_gravar_prontos(gravador_t *g, uint32_t max)
+{
+    bool ok = true;
+    for (; g->prontos && max; max--)
+        ok = gravar_mais_antigo(g) && ok;
+    return ok;
+}
+
+uint32_t gravador_bytes_na_ram(const gravador_t *g)
+{
+    uint32_t total = g->usados[g->ativo];
+    for (uint8_t n = 0, i = mais_antigo(g); n < g->prontos; n++, i = (uint8_t)((i + 1) % GRAV_NUM_BUFFERS))
+        total += g->usados[i];
+    return total;
+}
+
+// Grava os buffers cheios, o trecho do ativo e a cauda provisória; 'voltar' devolve o
+// ponteiro ao início do ativo
+static bool descarregar(gravador_t *g, bool voltar, const void *cauda, uint32_t len)
+{
+    bool prontos_ok = gravador_gravar_prontos(g, UINT32_MAX);
+    bool ok = true;
+    uint32_t n = g->usados[g->ativo];
+    if (n || len)
+    {
+        if (n)
+            ok = escrever(g, g->buffers[g->ativo], n);
+        if (len)
+            ok = escrever(g, cauda, len) && ok;
+        if (voltar)
+            ok = posicionar(g, g->posicao_ativo) && ok;
+        g->escritas_parciais++;
+    }
+    ok = sincronizar(g) && ok;
+    g->sincronizacoes++;
+    g->pendente = false;
+    g->bytes_sincronizados = g->bytes;
+    if (!ok)
+        g->falhas++;
+    return ok && prontos_ok;
+}
+
+bool gravador_sincronizar(gravador_t *g)
+{
+    if (!g->pendente)
+        return true;
+    return descarregar(g, true, NULL, 0);
+}
+
+bool gravador_sincronizar_cauda(gravador_t *g, const void *cauda, uint32_t len)
+{
+    return descarregar(g, true, cauda, len);
+}
+
+bool gravador_finalizar(gravador_t *g)
+{
+    bool ok = descarregar(g, false, NULL, 0);
+    g->posicao_ativo += g->usados[g->ativo];
+    g->usados[g->ativo] = 0;
+    return ok;
+}
+
+bool grav_politica_vencida(const grav_politica_t *p, uint32_t registros, uint32_t bytes, uint32_t ms)
+{
+    switch (p->modo)
+    {
+    case GRAV_SYNC_REGISTROS:
+        return registros >= p->limite;
+    case GRAV_SYNC_TEMPO:
+        return ms >= p->limite;
+    case GRAV_SYNC_BYTES:
+        return bytes >= p->limite * 1024u;
+    default:
+        return false;
+    }
+}
+
+const char *grav_nome_sync(grav_sync_t modo)
+{
+    static const char *const nomes[] = {"registros", "tempo", "bytes", "manual"};
+    return (unsigned)modo < sizeof nomes / sizeof nomes[0] ? nomes[modo] : "?";
+}
+
+const char *grav_unidade_sync(grav_sync_t modo)
+{
+    static const char *const unidades[] = {"registros", "ms", "KiB", ""};
+    return (unsigned)modo < sizeof unidades / sizeof unidades[0] ? unidades[modo] : "";
+}
@@ -0,0 +1,140 @@
+// gravador.h
+#ifndef GRAVADOR_H
+#define GRAVADOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+
+// Gravador em blocos alinhados a setores. As linhas do log são montadas na RAM, em
+// GRAV_NUM_BUFFERS buffers de GRAV_BLOCO_BYTES, e cada buffer cheio vai para o
+// cartão num único f_write de vários setores. Com o ponteiro do arquivo no início
+// de um setor e o tamanho múltiplo de 512, o FatFs passa o buffer direto ao driver,
+// sem copiar pelo buffer do FIL nem ler o setor antes.
+//
+// Enquanto um buffer espera a vez no cartão, as linhas seguintes enchem o outro.
+// Uma escrita lenta atrasa só a gravação; a formatação continua no laço seguinte.
+// f_sync só acontece em gravador_sincronizar: o FAT e a entrada do diretório deixam
+// de ser regravados a cada linha. Quando chamá-lo é decidido pela política abaixo.
+
+#define GRAV_SETOR 512
+
+#ifndef GRAV_BLOCO_BYTES
+#define GRAV_BLOCO_BYTES 4096 // 8 setores por escrita
+#endif
+
+#ifndef GRAV_NUM_BUFFERS
+#define GRAV_NUM_BUFFERS 2 // 2 = buffer duplo, 3 = triplo
+#endif
+
+// Maior linha aceita por gravador_printf
+#define GRAV_LINHA_MAX 256
+
+// Destino alternativo ao FIL, com a mesma semântica de f_write, f_lseek e f_sync
+// (ex.: os setores de um arquivo pré-alocado, em lib/prealocado.c)
+typedef struct
+{
+    FRESULT (*escrever)(void *contexto, const void *dados, UINT len, UINT *escritos);
+    FRESULT (*posicionar)(void *contexto, FSIZE_t posicao);
+    FRESULT (*sincronizar)(void *contexto);
+    void *contexto;
+} grav_destino_t;
+
+typedef struct
+{
+    // Primeiro campo: alinhado para o DMA do driver do cartão
+    uint8_t buffers[GRAV_NUM_BUFFERS][GRAV_BLOCO_BYTES] __attribute__((aligned(4)));
+    uint32_t usados[GRAV_NUM_BUFFERS];
+    uint32_t capacidade_ativo; // O primeiro buffer só vai até o próximo setor do arquivo
+    uint8_t ativo;             // Buffer sendo preenchido
+    uint8_t prontos;           // Buffers cheios esperando o cartão, a partir de 'proximo'
+    uint8_t proximo;
+    FIL *arquivo;
+    const grav_destino_t *destino; // NULL: f_write no 'arquivo'
+    FSIZE_t posicao_ativo;        // Posição no arquivo do primeiro byte do buffer ativo
+    bool pendente;                // Há bytes ainda não confirmados por f_sync
+    uint64_t bytes_sincronizados; // Valor de 'bytes' no último f_sync
+
+    // Estatísticas da sessão
+    uint64_t bytes;
+    uint32_t escritas;        // f_write de blocos completos
+    uint32_t escritas_parciais;
+    uint32_t sincronizacoes;
+    uint32_t falhas;
+} gravador_t;
+
+// Começa na posição atual do arquivo (aberto para escrita, em geral no fim)
+void gravador_iniciar(gravador_t *g, FIL *arquivo);
+
+// Passa a gravar por 'destino' em vez do FIL (logo depois de gravador_iniciar, que o desfaz)
+void gravador_usar_destino(gravador_t *g, const grav_destino_t *destino);
+
+// Copia 'len' bytes para os buffers, dividindo entre eles se preciso. Se todos
+// estiverem cheios, grava o mais antigo antes de continuar. Retorna false em erro
+// de escrita (os bytes que não couberam se perdem).
+bool gravador_escrever(gravador_t *g, const void *dados, uint32_t len);
+
+// Formata como printf e acrescenta a linha. Retorna o número de bytes ou -1.
+int gravador_printf(gravador_t *g, const char *formato, ...) __attribute__((format(printf, 2, 3)));
+
+// Escrita sem cópia: retorna onde montar até 'max' bytes, direto no buffer ativo. Se
+// ele não tem esse espaço até o fim, retorna 'reserva' (do chamador, com 'max' bytes),
+// e gravador_confirmar copia dela. Nenhuma outra escrita pode acontecer no meio.
+char *gravador_reservar(gravador_t *g, uint32_t max, char *reserva);
+
+// Acrescenta os 'len' bytes montados a partir do ponteiro de gravador_reservar
+bool gravador_confirmar(gravador_t *g, const char *inicio, uint32_t len);
+
+// Grava até 'max' buffers cheios. Retorna false em erro de escrita.
+bool gravador_gravar_prontos(gravador_t *g, uint32_t max);
+
+// Bytes ainda só na RAM (buffers cheios e o ativo)
+uint32_t gravador_bytes_na_ram(const gravador_t *g);
+
+// Leva tudo ao cartão e chama f_sync. O trecho final, que não completa um bloco, é
+// gravado e o ponteiro volta ao início dele: o bloco será regravado inteiro quando
+// encher, e as escritas seguintes continuam alinhadas.
+bool gravador_sincronizar(gravador_t *g);
+
+// Como gravador_sincronizar, mas grava também 'cauda' depois dos dados, sem guardá-la:
+// um bloco ainda aberto (ex.: do log binário) chega ao cartão inteiro e com CRC, e
+// o conteúdo seguinte o sobrescreve.
+bool gravador_sincronizar_cauda(gravador_t *g, const void *cauda, uint32_t len);
+
+// Grava o que restou, sem voltar o ponteiro, e chama f_sync. Depois disso o arquivo pode ser fechado.
+bool gravador_finalizar(gravador_t *g);
+
+// Bytes aceitos desde o último f_sync: sem ele o FAT não os alcança, e um corte de
+// energia os perde mesmo que já estejam nos setores do cartão
+static inline uint32_t gravador_bytes_sem_sync(const gravador_t *g)
+{
+    return (uint32_t)(g->bytes - g->bytes_sincronizados);
+}
+
+// Política de durabilidade: quando os arquivos abertos recebem f_sync. Cada f_sync
+// regrava o FAT e o diretório; mais espaçado rende mais, e o que se arrisca num corte
+// de energia é o que foi gravado desde o último.
+typedef enum
+{
+    GRAV_SYNC_REGISTROS = 0, // A cada 'limite' registros
+    GRAV_SYNC_TEMPO = 1,     // A cada 'limite' ms
+    GRAV_SYNC_BYTES = 2,     // A cada 'limite' KiB
+    GRAV_SYNC_MANUAL = 3     // Só no botão, no comando 'f' e ao parar
+} grav_sync_t;
+
+typedef struct
+{
+    grav_sync_t modo;
+    uint32_t limite; // Registros, ms ou KiB, conforme o modo
+} grav_politica_t;
+
+// true quando o que está sem f_sync chegou ao limite da política
+bool grav_politica_vencida(const grav_politica_t *p, uint32_t registros, uint32_t bytes, uint32_t ms);
+
+// "registros", "tempo", "bytes" ou "manual"
+const char *grav_nome_sync(grav_sync_t modo);
+
+// Unidade do limite de cada modo: "registros", "ms", "KiB" ou ""
+const char *grav_unidade_sync(grav_sync_t modo);
+
+#endif // GRAVADOR_H
@@ -0,0 +1,188 @@
+#include "i2c_dma.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#define I2C_DMA_IRQ DMA_IRQ_1
+
+// Uma instância por bloco I2C (i2c0, i2c1)
+static i2c_dma_t *instancias[2];
+
+static void __not_in_flash_func(i2c_dma_irq_handler)(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        i2c_dma_t *dma = instancias[i];
+        // Só o canal RX gera IRQ: se a recepção terminou, a transmissão também terminou
+        if (dma && dma_channel_get_irq1_status(dma->canal_rx))
+        {
+            dma_channel_acknowledge_irq1(dma->canal_rx);
+            dma->ocupado = false;
+            if (dma->callback)
+                dma->callback(dma->contexto);
+        }
+    }
+}
+
+bool i2c_dma_init(i2c_dma_t *dma, i2c_inst_t *i2c)
+{
+    static bool handler_instalado = false;
+
+    int tx = dma_claim_unused_channel(false);
+    int rx = dma_claim_unused_channel(false);
+    if (tx < 0 || rx < 0)
+    {
+        if (tx >= 0)
+            dma_channel_unclaim((uint)tx);
+        if (rx >= 0)
+            dma_channel_unclaim((uint)rx);
+        return false;
+    }
+
+    dma->i2c = i2c;
+    dma->canal_tx = (uint)tx;
+    dma->canal_rx = (uint)rx;
+    dma->ocupado = false;
+    dma->callback = NULL;
+    dma->abortos = 0;
+
+    // Os comandos de leitura só diferem no RESTART do primeiro byte e no STOP do
+    // último: a lista fica montada e cada leitura apenas troca o STOP de lugar
+    for (size_t i = 1; i <= I2C_DMA_MAX_LEN; i++)
+        dma->cmds[i] = I2C_IC_DATA_CMD_CMD_BITS | (i == 1 ? I2C_IC_DATA_CMD_RESTART_BITS : 0);
+    dma->len_cmds = 1;
+    dma->cmds[1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+
+    // TX: palavras de 32 bits da lista de comandos para IC_DATA_CMD, no ritmo da FIFO de transmissão
+    dma_channel_config c = dma_channel_get_default_config(dma->canal_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(i2c, true));
+    dma_channel_configure(dma->canal_tx, &c, &hw->data_cmd, dma->cmds, 0, false);
+
+    // RX: bytes recebidos de IC_DATA_CMD para o buffer, no ritmo da FIFO de recepção
+    c = dma_channel_get_default_config(dma->canal_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, i2c_get_dreq(i2c, false));
+    dma_channel_configure(dma->canal_rx, &c, NULL, &hw->data_cmd, 0, false);
+
+    instancias[i2c_get_index(i2c)] = dma;
+    dma_channel_set_irq1_enabled(dma->canal_rx, true);
+    if (!handler_instalado)
+    {
+        irq_add_shared_handler(I2C_DMA_IRQ, i2c_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(I2C_DMA_IRQ, true);
+        handler_instalado = true;
+    }
+
+    // Habilita as requisições de DMA do bloco I2C. As funções bloqueantes do SDK
+    // continuam funcionando enquanto nenhum canal estiver ativo.
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    return true;
+}
+
+// STOP no último byte lido; O(1) mesmo com o tamanho mudando a cada leitura (modo FIFO)
+static void preparar_comandos(i2c_dma_t *dma, size_t len)
+{
+    dma->cmds[dma->len_cmds] &= ~I2C_IC_DATA_CMD_STOP_BITS;
+    dma->cmds[len] |= I2C_IC_DATA_CMD_STOP_BITS;
+    dma->len_cmds = len;
+}
+
+void i2c_dma_cancelar(i2c_dma_t *dma)
+{
+    i2c_hw_t *hw = i2c_get_hw(dma->i2c);
+
+    // Sem desligar a IRQ, abortar o canal RX pode disparar uma conclusão falsa
+    dma_channel_set_irq1_enabled(dma->canal_rx, false);
+    dma_channel_abort(dma->canal_tx);
+    dma_channel_abort(dma->canal_rx);
+    dma_channel_acknowledge_irq1(dma->canal_rx);
+    dma_channel_set_irq1_enabled(dma->canal_rx, true);
+
+    // Libera a FIFO de transmissão travada pelo abort e descarta bytes que sobraram
+    (void)hw->clr_tx_abrt;
+    while (i2c_get_read_available(dma->i2c))
+        (void)hw->data_cmd;
+    dma->ocupado = false;
+}
+
+bool i2c_dma_ocupado(i2c_dma_t *dma)
+{
+    if (!dma->ocupado)
+        return false;
+
+    // Um NACK aborta a transmissão e o canal RX nunca completa: libera o barramento aqui
+    if (i2c_get_hw(dma->i2c)->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+    {
+        i2c_dma_cancelar(dma);
+        dma->abortos++;
+        return false;
+    }
+    return true;
+}
+
+// Envia 'n_cmds' comandos e recebe 'len' bytes em 'buf'
+static void __not_in_flash_func(iniciar)(i2c_dma_t *dma, uint8_t addr, const uint32_t *cmds, size_t n_cmds,
+                                         uint8_t *buf, size_t len, i2c_dma_callback_t callback, void *contexto)
+{
+    // O endereço do escravo só pode ser trocado com o bloco desabilitado
+    i2c_hw_t *hw = i2c_get_hw(dma->i2c);
+    hw->enable = 0;
+    hw->tar = addr;
+    hw->enable = 1;
+
+    dma->callback = callback;
+    dma->contexto = contexto;
+    dma->ocupado = true;
+
+    dma_channel_set_write_addr(dma->canal_rx, buf, false);
+    dma_channel_set_trans_count(dma->canal_rx, len, false);
+    dma_channel_set_read_addr(dma->canal_tx, cmds, false);
+    dma_channel_set_trans_count(dma->canal_tx, n_cmds, false);
+    dma_start_channel_mask((1u << dma->canal_tx) | (1u << dma->canal_rx));
+}
+
+bool __not_in_flash_func(i2c_dma_ler_registradores)(i2c_dma_t *dma, uint8_t addr, uint8_t reg,
+                                                     uint8_t *buf, size_t len,
+                                                     i2c_dma_callback_t callback, void *contexto)
+{
+    if (len == 0 || len > I2C_DMA_MAX_LEN)
+        return false;
+
+    if (i2c_dma_ocupado(dma))
+        return false;
+
+    if (dma->len_cmds != len)
+        preparar_comandos(dma, len);
+    dma->cmds[0] = reg;
+    iniciar(dma, addr, dma->cmds, len + 1, buf, len, callback, contexto);
+    return true;
+}
+
+bool __not_in_flash_func(i2c_dma_escrever_registrador)(i2c_dma_t *dma, uint8_t addr, uint8_t reg,
+                                                        const uint8_t *valores, size_t n, uint8_t *lido,
+                                                        i2c_dma_callback_t callback, void *contexto)
+{
+    if (n == 0 || n > I2C_DMA_MAX_ESCRITAS)
+        return false;
+
+    if (i2c_dma_ocupado(dma))
+        return false;
+
+    // Cada escrita termina em STOP; o comando seguinte já abre outra transação
+    uint32_t *c = dma->cmds_escrita;
+    for (size_t i = 0; i < n; i++)
+    {
+        *c++ = reg;
+        *c++ = valores[i] | I2C_IC_DATA_CMD_STOP_BITS;
+    }
+    *c++ = reg;
+    *c++ = I2C_IC_DATA_CMD_CMD_BITS | I2C_IC_DATA_CMD_RESTART_BITS | I2C_IC_DATA_CMD_STOP_BITS;
+    iniciar(dma, addr, dma->cmds_escrita, (size_t)(c - dma->cmds_escrita), lido, 1, callback, contexto);
+    return true;
+}
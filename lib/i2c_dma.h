@@ -0,0 +1,59 @@
+// i2c_dma.h
+#ifndef I2C_DMA_H
+#define I2C_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+// Maior leitura suportada: a FIFO inteira do MPU6050
+#define I2C_DMA_MAX_LEN 1024
+// Valores escritos de uma vez num registrador (i2c_dma_escrever_registrador)
+#define I2C_DMA_MAX_ESCRITAS 4
+
+// Chamado no contexto da IRQ de DMA quando a leitura termina
+typedef void (*i2c_dma_callback_t)(void *contexto);
+
+// Leitura de registradores sem bloquear a CPU. Um canal de DMA alimenta o
+// IC_DATA_CMD com o endereço do registrador e os comandos de leitura; outro
+// canal copia os bytes recebidos para o buffer de destino.
+typedef struct
+{
+    i2c_inst_t *i2c;
+    uint canal_tx;
+    uint canal_rx;
+    volatile bool ocupado;
+    i2c_dma_callback_t callback;
+    void *contexto;
+    uint32_t abortos; // Transferências canceladas por NACK
+    size_t len_cmds;  // Posição do STOP em 'cmds'
+    uint32_t cmds[I2C_DMA_MAX_LEN + 1];
+    uint32_t cmds_escrita[2 * I2C_DMA_MAX_ESCRITAS + 2];
+} i2c_dma_t;
+
+// Reserva os canais de DMA e registra o handler compartilhado de DMA_IRQ_1
+// (DMA_IRQ_0 fica para o driver do cartão SD)
+bool i2c_dma_init(i2c_dma_t *dma, i2c_inst_t *i2c);
+
+// Informa se há transferência em andamento. Uma transferência abortada por NACK
+// é cancelada aqui (e contada em 'abortos'), liberando o barramento.
+bool i2c_dma_ocupado(i2c_dma_t *dma);
+
+// Inicia a leitura de 'len' bytes a partir de 'reg'. Retorna false se a
+// transferência anterior ainda não terminou.
+bool i2c_dma_ler_registradores(i2c_dma_t *dma, uint8_t addr, uint8_t reg,
+                               uint8_t *buf, size_t len,
+                               i2c_dma_callback_t callback, void *contexto);
+
+// Escreve os 'n' valores em 'reg', um por transação, e relê o registrador em 'lido'.
+// A leitura no fim é o que gera a IRQ de conclusão: o canal TX termina quando o
+// último comando entra na FIFO, antes de ele sair no barramento.
+bool i2c_dma_escrever_registrador(i2c_dma_t *dma, uint8_t addr, uint8_t reg,
+                                  const uint8_t *valores, size_t n, uint8_t *lido,
+                                  i2c_dma_callback_t callback, void *contexto);
+
+// Cancela uma transferência pendente (usado ao parar a aquisição)
+void i2c_dma_cancelar(i2c_dma_t *dma);
+
+#endif // I2C_DMA_H
@@ -0,0 +1,51 @@
+// imu.h
+#ifndef IMU_H
+#define IMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fonte de amostras de um IMU. O MPU6050 (mpu6050_como_imu) é uma implementação;
+// a reprodução de arquivos gravados (imu_replay.c) é outra, e leva o processamento
+// para o PC. Os caminhos por DMA, FIFO e data-ready da aquisição falam direto com
+// os registradores do MPU6050 e ficam fora desta interface.
+
+// Uma amostra bruta, já convertida para int16 na ordem do host
+typedef struct
+{
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temp;
+} imu_dados_t;
+
+typedef struct imu imu_t;
+
+typedef struct
+{
+    // Reinicia a fonte (o chip, ou o arquivo desde o começo). Retorna false se ela não responder.
+    bool (*reset)(imu_t *imu);
+    // Próxima amostra. 'timestamp_us' chega com o instante da leitura; fontes com
+    // relógio próprio (o arquivo) o substituem. Retorna false sem amostra.
+    bool (*ler)(imu_t *imu, imu_dados_t *dados, uint64_t *timestamp_us);
+} imu_ops_t;
+
+struct imu
+{
+    const imu_ops_t *ops;
+    const void *contexto;     // Driver por trás da interface (o replay guarda o estado em volta dela)
+    uint32_t taxa_hz;         // Taxa de saída de dados
+    uint16_t escala_accel;    // LSB por g
+    uint16_t escala_gyro_x10; // LSB por °/s, multiplicado por 10
+};
+
+static inline bool imu_reset(imu_t *imu)
+{
+    return imu->ops->reset(imu);
+}
+
+static inline bool imu_ler(imu_t *imu, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    return imu->ops->ler(imu, dados, timestamp_us);
+}
+
+#endif // IMU_H
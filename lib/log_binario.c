@@ -0,0 +1,685 @@
+#include "log_binario.h"
+#include <string.h>
+
+// CRC-32 (o mesmo polinômio do zlib) com tabela de 16 entradas: metade das voltas do
+// cálculo bit a bit, sem gastar 1 KiB de RAM numa tabela de 256
+uint32_t lb_crc32(const void *dados, uint32_t tamanho)
+{
+    static const uint32_t tabela[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu, 0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu, 0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu};
+    const uint8_t *p = dados;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (tamanho--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ tabela[crc & 0x0F];
+        crc = (crc >> 4) ^ tabela[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static void escrever16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void escrever32(uint8_t *p, uint32_t v)
+{
+    escrever16(p, (uint16_t)v);
+    escrever16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void escrever64(uint8_t *p, uint64_t v)
+{
+    escrever32(p, (uint32_t)v);
+    escrever32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t ler16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t ler32(const uint8_t *p)
+{
+    return ler16(p) | (uint32_t)ler16(p + 2) << 16;
+}
+
+static uint64_t ler64(const uint8_t *p)
+{
+    return ler32(p) | (uint64_t)ler32(p + 4) << 32;
+}
+
+uint16_t lb_tamanho_registro(const lb_cabecalho_t *cab)
+{
+    uint16_t tamanho;
+    if (cab->tipo == LB_JANELAS)
+    {
+        tamanho = 12;
+        for (uint32_t e = 0; e < AG_NUM_ESTATISTICAS; e++)
+            if (cab->estatisticas & (1u << e))
+                tamanho += (1u << e) == AG_VARIANCIA ? 4 * AG_NUM_CANAIS : 2 * AG_NUM_CANAIS;
+    }
+    else
+    {
+        tamanho = 8 + 2 * AG_NUM_CANAIS;
+    }
+    if (cab->orientacao)
+        tamanho += 14;
+    return tamanho;
+}
+
+void lb_montar_cabecalho(const lb_cabecalho_t *cab, uint8_t bloco[LB_BLOCO])
+{
+    memset(bloco, 0, LB_BLOCO);
+    memcpy(bloco, LB_MAGICA, 4);
+    // Sem compressão continua a versão 1, que os leitores antigos entendem
+    bool comprimido = cab->comprimido && cab->tipo == LB_AMOSTRAS;
+    escrever16(&bloco[4], comprimido ? LB_VERSAO_COMPRIMIDA : LB_VERSAO);
+    escrever16(&bloco[6], lb_tamanho_registro(cab));
+    bloco[8] = cab->tipo;
+    bloco[9] = cab->estatisticas;
+    bloco[10] = cab->orientacao;
+    bloco[11] = cab->num_sensores;
+    bloco[12] = cab->dlpf;
+    bloco[13] = cab->filtro_decimacao;
+    escrever16(&bloco[14], cab->escala_accel);
+    escrever16(&bloco[16], cab->escala_gyro_x10);
+    escrever32(&bloco[20], cab->odr_hz);
+    escrever32(&bloco[24], cab->janela_amostras);
+    escrever32(&bloco[28], cab->fator_decimacao);
+    escrever64(&bloco[32], cab->inicio_us);
+    escrever16(&bloco[40], cab->ano);
+    bloco[42] = cab->mes;
+    bloco[43] = cab->dia;
+    bloco[44] = cab->hora;
+    bloco[45] = cab->minuto;
+    bloco[46] = cab->segundo;
+    bloco[47] = comprimido;
+    for (int i = 0; i < LB_MAX_SENSORES; i++)
+    {
+        bloco[48 + 4 * i] = cab->sensores[i].i2c;
+        bloco[49 + 4 * i] = cab->sensores[i].endereco_i2c;
+        bloco[50 + 4 * i] = cab->sensores[i].calibracao_gyro;
+    }
+    escrever32(&bloco[64], cab->sessao);
+    escrever16(&bloco[68], cab->parte);
+    escrever32(&bloco[LB_BLOCO - 4], lb_crc32(bloco, LB_BLOCO - 4));
+}
+
+bool lb_ler_cabecalho(const uint8_t bloco[LB_BLOCO], lb_cabecalho_t *cab)
+{
+    uint16_t versao = ler16(&bloco[4]);
+    if (memcmp(bloco, LB_MAGICA, 4) != 0 || (versao != LB_VERSAO && versao != LB_VERSAO_COMPRIMIDA) ||
+        lb_crc32(bloco, LB_BLOCO - 4) != ler32(&bloco[LB_BLOCO - 4]))
+        return false;
+    memset(cab, 0, sizeof *cab);
+    cab->tipo = bloco[8];
+    cab->estatisticas = bloco[9];
+    cab->orientacao = bloco[10];
+    cab->num_sensores = bloco[11];
+    cab->dlpf = bloco[12];
+    cab->filtro_decimacao = bloco[13];
+    cab->escala_accel = ler16(&bloco[14]);
+    cab->escala_gyro_x10 = ler16(&bloco[16]);
+    cab->odr_hz = ler32(&bloco[20]);
+    cab->janela_amostras = ler32(&bloco[24]);
+    cab->fator_decimacao = ler32(&bloco[28]);
+    cab->inicio_us = ler64(&bloco[32]);
+    cab->ano = ler16(&bloco[40]);
+    cab->mes = bloco[42];
+    cab->dia = bloco[43];
+    cab->hora = bloco[44];
+    cab->minuto = bloco[45];
+    cab->segundo = bloco[46];
+    cab->comprimido = versao == LB_VERSAO_COMPRIMIDA && bloco[47] && cab->tipo == LB_AMOSTRAS;
+    for (int i = 0; i < LB_MAX_SENSORES; i++)
+    {
+        cab->sensores[i].i2c = bloco[48 + 4 * i];
+        cab->sensores[i].endereco_i2c = bloco[49 + 4 * i];
+        cab->sensores[i].calibracao_gyro = bloco[50 + 4 * i];
+    }
+    cab->sessao = ler32(&bloco[64]);
+    cab->parte = ler16(&bloco[68]);
+    // Um registro maior que o bloco ou de outro tamanho não seria lido direito
+    return ler16(&bloco[6]) == lb_tamanho_registro(cab) && lb_tamanho_registro(cab) <= LB_DADOS_LEN;
+}
+
+uint16_t lb_marca_cabecalho(const uint8_t bloco[LB_BLOCO])
+{
+    return ler16(&bloco[LB_BLOCO - 4]);
+}
+
+uint16_t lb_marca_bloco(const uint8_t bloco[LB_BLOCO])
+{
+    return ler16(&bloco[LB_DADOS_LEN + 6]);
+}
+
+uint16_t lb_capacidade(const lb_cabecalho_t *cab)
+{
+    return cab->comprimido ? LB_MAX_REGISTROS : (uint16_t)(LB_DADOS_LEN / lb_tamanho_registro(cab));
+}
+
+// --- Compressão das amostras ---
+
+// Intervalos a partir deste viram chave: a variação entre dois deles cabe em 31 bits
+#define INTERVALO_MAX (1u << 30)
+#define TAMANHO_TAXA 14
+
+static uint32_t zigzag(int32_t v)
+{
+    return (uint32_t)v << 1 ^ (uint32_t)(v >> 31);
+}
+
+static int32_t desfazer_zigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint8_t largura(uint32_t v)
+{
+    return v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+}
+
+// O intervalo e os canais da amostra, depois a orientação
+static uint8_t num_campos(const lb_cabecalho_t *cab)
+{
+    return 1 + AG_NUM_CANAIS + (cab->orientacao ? 7 : 0);
+}
+
+static uint8_t bits_sensor(const lb_cabecalho_t *cab)
+{
+    return cab->num_sensores > 2 ? 2 : cab->num_sensores > 1 ? 1 : 0;
+}
+
+static void canais_da_amostra(const lb_cabecalho_t *cab, const lb_registro_t *r, int16_t v[])
+{
+    memcpy(v, r->canais, sizeof r->canais);
+    if (cab->orientacao)
+    {
+        memcpy(&v[AG_NUM_CANAIS], r->orientacao.q, sizeof r->orientacao.q);
+        memcpy(&v[AG_NUM_CANAIS + 4], r->orientacao.rpy_cdeg, sizeof r->orientacao.rpy_cdeg);
+    }
+}
+
+static void amostra_do_preditor(const lb_cabecalho_t *cab, uint8_t sensor, const lb_preditor_t *p, lb_registro_t *r)
+{
+    r->sensor = sensor;
+    r->timestamp_us = r->timestamp_fim_us = p->timestamp_us;
+    memcpy(r->canais, p->canais, sizeof r->canais);
+    if (cab->orientacao)
+    {
+        memcpy(r->orientacao.q, &p->canais[AG_NUM_CANAIS], sizeof r->orientacao.q);
+        memcpy(r->orientacao.rpy_cdeg, &p->canais[AG_NUM_CANAIS + 4], sizeof r->orientacao.rpy_cdeg);
+    }
+}
+
+// Intervalo até a amostra anterior do sensor; 0 se não houver ou se for longo demais
+static uint32_t intervalo(const lb_preditor_t *p, uint64_t t)
+{
+    return p->valido && t >= p->timestamp_us && t - p->timestamp_us < INTERVALO_MAX ? (uint32_t)(t - p->timestamp_us)
+                                                                                      : 0;
+}
+
+static void atualizar_preditor(lb_preditor_t *p, const lb_cabecalho_t *cab, const lb_registro_t *r)
+{
+    uint64_t t = r->timestamp_us & LB_TEMPO_MASCARA;
+    p->intervalo_us = intervalo(p, t);
+    p->timestamp_us = t;
+    canais_da_amostra(cab, r, p->canais);
+    p->valido = true;
+}
+
+// Campos em zigzag de uma amostra. false se ela tem de ir como chave: a primeira do
+// sensor no bloco, ou depois de uma lacuna longa ou de um relógio que voltou.
+static bool calcular_campos(const lb_escritor_t *e, const lb_registro_t *r, uint32_t campos[])
+{
+    const lb_preditor_t *p = &e->preditor[r->sensor];
+    uint64_t t = r->timestamp_us & LB_TEMPO_MASCARA;
+    if (!p->chave || t < p->timestamp_us || t - p->timestamp_us >= INTERVALO_MAX)
+        return false;
+    campos[0] = zigzag((int32_t)((uint32_t)(t - p->timestamp_us) - p->intervalo_us));
+    int16_t v[LB_MAX_CAMPOS - 1];
+    canais_da_amostra(&e->cab, r, v);
+    for (uint8_t c = 0; c + 1 < e->num_campos; c++)
+        campos[c + 1] = zigzag((int32_t)v[c] - p->canais[c]);
+    return true;
+}
+
+static uint16_t tamanho_chave(const lb_escritor_t *e)
+{
+    return (uint16_t)(14 + 2 * (e->num_campos - 1));
+}
+
+static uint16_t tamanho_grupo(const lb_escritor_t *e, uint8_t n, const uint8_t larguras[])
+{
+    if (!n)
+        return 0;
+    uint32_t bits = e->bits_sensor;
+    for (uint8_t f = 0; f < e->num_campos; f++)
+        bits += larguras[f];
+    return (uint16_t)(1 + (5u * e->num_campos + n * bits + 7) / 8);
+}
+
+// Bytes ocupados no bloco depois de acrescentar 'r', com o grupo aberto
+static uint32_t tamanho_com(const lb_escritor_t *e, const lb_registro_t *r)
+{
+    uint32_t grupo = tamanho_grupo(e, e->grupo_n, e->larguras);
+    if (r->sensor == LB_SENSOR_TAXA)
+        return e->usados + grupo + TAMANHO_TAXA;
+    uint32_t campos[LB_MAX_CAMPOS];
+    if (!calcular_campos(e, r, campos))
+        return e->usados + grupo + tamanho_chave(e);
+    bool novo = e->grupo_n == LB_GRUPO;
+    uint8_t larguras[LB_MAX_CAMPOS];
+    for (uint8_t f = 0; f < e->num_campos; f++)
+    {
+        uint8_t l = largura(campos[f]);
+        larguras[f] = !novo && e->larguras[f] > l ? e->larguras[f] : l;
+    }
+    return e->usados + (novo ? grupo : 0) + tamanho_grupo(e, novo ? 1 : e->grupo_n + 1, larguras);
+}
+
+// Bits a partir do menos significativo de cada byte
+typedef struct
+{
+    uint8_t *p;
+    uint32_t acumulador;
+    uint8_t bits;
+} bits_t;
+
+static void por_bits(bits_t *b, uint32_t v, uint8_t n)
+{
+    if (n > 24)
+    {
+        por_bits(b, v & 0xFFFFu, 16);
+        v >>= 16;
+        n -= 16;
+    }
+    b->acumulador |= v << b->bits;
+    b->bits += n;
+    while (b->bits >= 8)
+    {
+        *b->p++ = (uint8_t)b->acumulador;
+        b->acumulador >>= 8;
+        b->bits -= 8;
+    }
+}
+
+// Escreve o grupo aberto em 'destino' e retorna os bytes usados
+static uint16_t codificar_grupo(const lb_escritor_t *e, uint8_t *destino)
+{
+    bits_t b = {destino + 1, 0, 0};
+    destino[0] = e->grupo_n;
+    for (uint8_t f = 0; f < e->num_campos; f++)
+        por_bits(&b, e->larguras[f], 5);
+    for (uint8_t i = 0; i < e->grupo_n; i++)
+    {
+        por_bits(&b, e->grupo_sensor[i], e->bits_sensor);
+        for (uint8_t f = 0; f < e->num_campos; f++)
+            por_bits(&b, e->grupo[i][f], e->larguras[f]);
+    }
+    if (b.bits)
+        *b.p++ = (uint8_t)b.acumulador;
+    return (uint16_t)(b.p - destino);
+}
+
+static void fechar_grupo(lb_escritor_t *e)
+{
+    if (!e->grupo_n)
+        return;
+    e->usados += codificar_grupo(e, &e->bloco[e->usados]);
+    e->grupo_n = 0;
+    memset(e->larguras, 0, sizeof e->larguras);
+}
+
+static void adicionar_comprimido(lb_escritor_t *e, const lb_registro_t *r)
+{
+    uint64_t t = r->timestamp_us & LB_TEMPO_MASCARA;
+    if (r->sensor == LB_SENSOR_TAXA)
+    {
+        fechar_grupo(e);
+        uint8_t *p = &e->bloco[e->usados];
+        p[0] = LB_SENSOR_TAXA;
+        escrever64(p + 1, t);
+        escrever32(p + 9, r->odr_mhz);
+        p[13] = r->repouso;
+        e->usados += TAMANHO_TAXA;
+        return;
+    }
+
+    lb_preditor_t *pred = &e->preditor[r->sensor];
+    uint32_t campos[LB_MAX_CAMPOS];
+    if (calcular_campos(e, r, campos))
+    {
+        if (e->grupo_n == LB_GRUPO)
+            fechar_grupo(e);
+        for (uint8_t f = 0; f < e->num_campos; f++)
+        {
+            uint8_t l = largura(campos[f]);
+            if (l > e->larguras[f])
+                e->larguras[f] = l;
+            e->grupo[e->grupo_n][f] = campos[f];
+        }
+        e->grupo_sensor[e->grupo_n++] = r->sensor;
+    }
+    else
+    {
+        fechar_grupo(e);
+        uint8_t *p = &e->bloco[e->usados];
+        int16_t v[LB_MAX_CAMPOS - 1];
+        canais_da_amostra(&e->cab, r, v);
+        p[0] = LB_CHAVE;
+        p[1] = r->sensor;
+        escrever64(p + 2, t);
+        escrever32(p + 10, intervalo(pred, t));
+        p += 14;
+        for (uint8_t c = 0; c + 1 < e->num_campos; c++, p += 2)
+            escrever16(p, (uint16_t)v[c]);
+        e->usados += tamanho_chave(e);
+        pred->chave = true;
+    }
+    atualizar_preditor(pred, &e->cab, r);
+}
+
+// --- Escritor ---
+
+void lb_iniciar(lb_escritor_t *e, const lb_cabecalho_t *cab)
+{
+    e->cab = *cab;
+    e->cab.comprimido = cab->comprimido && cab->tipo == LB_AMOSTRAS;
+    e->tamanho_registro = lb_tamanho_registro(cab);
+    e->capacidade = lb_capacidade(&e->cab);
+    e->num_campos = num_campos(cab);
+    e->bits_sensor = bits_sensor(cab);
+    memset(e->preditor, 0, sizeof e->preditor);
+    // O mesmo cabeçalho que vai ao arquivo, só para tirar a marca
+    lb_montar_cabecalho(cab, e->bloco);
+    e->marca = lb_marca_cabecalho(e->bloco);
+    lb_novo_bloco(e);
+}
+
+bool lb_cabe(const lb_escritor_t *e, uint32_t sequencia, const lb_registro_t *r)
+{
+    if (e->registros == 0)
+        return true;
+    if (e->registros >= e->capacidade || sequencia != e->sequencia + e->registros)
+        return false;
+    return !e->cab.comprimido || tamanho_com(e, r) <= LB_DADOS_LEN;
+}
+
+static uint8_t *escrever_canais16(uint8_t *p, const void *canais)
+{
+    const uint16_t *v = canais;
+    for (int c = 0; c < AG_NUM_CANAIS; c++, p += 2)
+        escrever16(p, v[c]);
+    return p;
+}
+
+void lb_adicionar(lb_escritor_t *e, uint32_t sequencia, const lb_registro_t *r)
+{
+    if (e->registros == 0)
+        e->sequencia = sequencia;
+    if (e->cab.comprimido)
+    {
+        adicionar_comprimido(e, r);
+        e->registros++;
+        return;
+    }
+    uint8_t *p = &e->bloco[e->registros * e->tamanho_registro];
+    escrever64(p, (r->timestamp_us & LB_TEMPO_MASCARA) | (uint64_t)r->sensor << 56);
+    p += 8;
+
+    if (r->sensor == LB_SENSOR_TAXA)
+    {
+        memset(p, 0, e->tamanho_registro - 8);
+        escrever32(p, r->odr_mhz);
+        p[4] = r->repouso;
+        e->registros++;
+        return;
+    }
+
+    if (e->cab.tipo == LB_JANELAS)
+    {
+        escrever32(p, (uint32_t)(r->timestamp_fim_us - r->timestamp_us));
+        p += 4;
+        const ag_resultado_t *j = &r->janela;
+        if (e->cab.estatisticas & AG_MEDIA)
+            p = escrever_canais16(p, j->media);
+        if (e->cab.estatisticas & AG_MIN)
+            p = escrever_canais16(p, j->min);
+        if (e->cab.estatisticas & AG_MAX)
+            p = escrever_canais16(p, j->max);
+        if (e->cab.estatisticas & AG_RMS)
+            p = escrever_canais16(p, j->rms);
+        if (e->cab.estatisticas & AG_VARIANCIA)
+            for (int c = 0; c < AG_NUM_CANAIS; c++, p += 4)
+                escrever32(p, j->variancia[c]);
+    }
+    else
+    {
+        p = escrever_canais16(p, r->canais);
+    }
+
+    if (e->cab.orientacao)
+    {
+        for (int i = 0; i < 4; i++, p += 2)
+            escrever16(p, (uint16_t)r->orientacao.q[i]);
+        for (int i = 0; i < 3; i++, p += 2)
+            escrever16(p, (uint16_t)r->orientacao.rpy_cdeg[i]);
+    }
+    e->registros++;
+}
+
+const uint8_t *lb_fechar_bloco(lb_escritor_t *e)
+{
+    // O grupo aberto vai para o bloco sem ser fechado: se crescer, é reescrito no mesmo lugar
+    if (e->cab.comprimido && e->grupo_n)
+        codificar_grupo(e, &e->bloco[e->usados]);
+    uint8_t *rodape = &e->bloco[LB_DADOS_LEN];
+    escrever32(rodape, e->sequencia);
+    escrever16(rodape + 4, e->registros);
+    escrever16(rodape + 6, e->marca);
+    escrever32(rodape + 8, lb_crc32(e->bloco, LB_BLOCO - 4));
+    return e->bloco;
+}
+
+void lb_novo_bloco(lb_escritor_t *e)
+{
+    // Zerado para o trecho sem registros não levar restos do bloco anterior
+    memset(e->bloco, 0, sizeof e->bloco);
+    e->registros = 0;
+    // Cada bloco recomeça com uma chave por sensor
+    e->usados = 0;
+    e->grupo_n = 0;
+    memset(e->larguras, 0, sizeof e->larguras);
+    for (int s = 0; s < LB_MAX_SENSORES; s++)
+        e->preditor[s].chave = false;
+}
+
+uint16_t lb_bytes_no_bloco(const lb_escritor_t *e)
+{
+    if (e->cab.comprimido)
+        return e->usados + tamanho_grupo(e, e->grupo_n, e->larguras);
+    return (uint16_t)(e->registros * e->tamanho_registro);
+}
+
+bool lb_ler_bloco(const uint8_t bloco[LB_BLOCO], uint32_t *sequencia, uint16_t *registros)
+{
+    const uint8_t *rodape = &bloco[LB_DADOS_LEN];
+    if (lb_crc32(bloco, LB_BLOCO - 4) != ler32(rodape + 8))
+        return false;
+    *sequencia = ler32(rodape);
+    *registros = ler16(rodape + 4);
+    return true;
+}
+
+static const uint8_t *ler_canais16(const uint8_t *p, void *canais)
+{
+    uint16_t *v = canais;
+    for (int c = 0; c < AG_NUM_CANAIS; c++, p += 2)
+        v[c] = ler16(p);
+    return p;
+}
+
+void lb_ler_registro(const lb_cabecalho_t *cab, const uint8_t bloco[LB_BLOCO], uint16_t indice, lb_registro_t *r)
+{
+    const uint8_t *p = &bloco[indice * lb_tamanho_registro(cab)];
+    memset(r, 0, sizeof *r);
+    uint64_t t = ler64(p);
+    p += 8;
+    r->sensor = (uint8_t)(t >> 56);
+    r->timestamp_us = r->timestamp_fim_us = t & LB_TEMPO_MASCARA;
+
+    if (r->sensor == LB_SENSOR_TAXA)
+    {
+        r->odr_mhz = ler32(p);
+        r->repouso = p[4];
+        return;
+    }
+
+    if (cab->tipo == LB_JANELAS)
+    {
+        r->timestamp_fim_us = r->timestamp_us + ler32(p);
+        p += 4;
+        ag_resultado_t *j = &r->janela;
+        if (cab->estatisticas & AG_MEDIA)
+            p = ler_canais16(p, j->media);
+        if (cab->estatisticas & AG_MIN)
+            p = ler_canais16(p, j->min);
+        if (cab->estatisticas & AG_MAX)
+            p = ler_canais16(p, j->max);
+        if (cab->estatisticas & AG_RMS)
+            p = ler_canais16(p, j->rms);
+        if (cab->estatisticas & AG_VARIANCIA)
+            for (int c = 0; c < AG_NUM_CANAIS; c++, p += 4)
+                j->variancia[c] = ler32(p);
+        // A média faz as vezes da amostra para quem só quer uma série no tempo
+        memcpy(r->canais, j->media, sizeof r->canais);
+    }
+    else
+    {
+        p = ler_canais16(p, r->canais);
+    }
+
+    if (cab->orientacao)
+    {
+        for (int i = 0; i < 4; i++, p += 2)
+            r->orientacao.q[i] = (int16_t)ler16(p);
+        for (int i = 0; i < 3; i++, p += 2)
+            r->orientacao.rpy_cdeg[i] = (int16_t)ler16(p);
+    }
+}
+
+// --- Leitor ---
+
+void lb_leitor_iniciar(lb_leitor_t *l, const lb_cabecalho_t *cab, const uint8_t bloco[LB_BLOCO], uint16_t registros)
+{
+    memset(l, 0, sizeof *l);
+    l->cab = cab;
+    l->bloco = bloco;
+    l->registros = registros;
+    l->num_campos = num_campos(cab);
+    l->bits_sensor = bits_sensor(cab);
+}
+
+// Bytes além dos dados do bloco são lidos como zero; lb_ler_proximo recusa o registro
+static uint32_t tirar_bits(lb_leitor_t *l, uint8_t n)
+{
+    if (n > 24)
+    {
+        uint32_t baixo = tirar_bits(l, 16);
+        return baixo | tirar_bits(l, n - 16) << 16;
+    }
+    while (l->bits < n)
+    {
+        l->acumulador |= (uint32_t)(l->posicao < LB_DADOS_LEN ? l->bloco[l->posicao] : 0) << l->bits;
+        l->posicao++;
+        l->bits += 8;
+    }
+    uint32_t v = l->acumulador & ((1u << n) - 1);
+    l->acumulador >>= n;
+    l->bits -= n;
+    return v;
+}
+
+static bool ler_comprimido(lb_leitor_t *l, lb_registro_t *r)
+{
+    const uint8_t *p = &l->bloco[l->posicao];
+    if (!l->grupo_restante)
+    {
+        if (l->posicao >= LB_DADOS_LEN)
+            return false;
+        if (p[0] == LB_SENSOR_TAXA)
+        {
+            if (l->posicao + TAMANHO_TAXA > LB_DADOS_LEN)
+                return false;
+            r->sensor = LB_SENSOR_TAXA;
+            r->timestamp_us = r->timestamp_fim_us = ler64(p + 1);
+            r->odr_mhz = ler32(p + 9);
+            r->repouso = p[13];
+            l->posicao += TAMANHO_TAXA;
+            return true;
+        }
+        if (p[0] == LB_CHAVE)
+        {
+            uint16_t tamanho = (uint16_t)(14 + 2 * (l->num_campos - 1));
+            if (l->posicao + tamanho > LB_DADOS_LEN || p[1] >= LB_MAX_SENSORES)
+                return false;
+            lb_preditor_t *pred = &l->preditor[p[1]];
+            pred->timestamp_us = ler64(p + 2);
+            pred->intervalo_us = ler32(p + 10);
+            for (uint8_t c = 0; c + 1 < l->num_campos; c++)
+                pred->canais[c] = (int16_t)ler16(p + 14 + 2 * c);
+            pred->chave = true;
+            amostra_do_preditor(l->cab, p[1], pred, r);
+            l->posicao += tamanho;
+            return true;
+        }
+        if (p[0] == 0 || p[0] > LB_GRUPO)
+            return false;
+        l->grupo_restante = p[0];
+        l->posicao++;
+        l->acumulador = 0;
+        l->bits = 0;
+        for (uint8_t f = 0; f < l->num_campos; f++)
+            l->larguras[f] = (uint8_t)tirar_bits(l, 5);
+    }
+
+    uint8_t sensor = (uint8_t)tirar_bits(l, l->bits_sensor);
+    lb_preditor_t *pred = &l->preditor[sensor];
+    if (!pred->chave)
+        return false;
+    pred->intervalo_us = (uint32_t)((int32_t)pred->intervalo_us + desfazer_zigzag(tirar_bits(l, l->larguras[0])));
+    pred->timestamp_us += pred->intervalo_us;
+    for (uint8_t c = 0; c + 1 < l->num_campos; c++)
+        pred->canais[c] = (int16_t)(pred->canais[c] + desfazer_zigzag(tirar_bits(l, l->larguras[c + 1])));
+    // O que sobra do último byte do grupo é enchimento
+    if (--l->grupo_restante == 0)
+        l->bits = 0;
+    if (l->posicao > LB_DADOS_LEN)
+        return false;
+    amostra_do_preditor(l->cab, sensor, pred, r);
+    return true;
+}
+
+bool lb_ler_proximo(lb_leitor_t *l, lb_registro_t *r)
+{
+    if (l->lidos >= l->registros)
+        return false;
+    if (!l->cab->comprimido)
+    {
+        lb_ler_registro(l->cab, l->bloco, l->lidos++, r);
+        return true;
+    }
+    memset(r, 0, sizeof *r);
+    if (!ler_comprimido(l, r))
+    {
+        l->lidos = l->registros;
+        return false;
+    }
+    l->lidos++;
+    return true;
+}
@@ -0,0 +1,216 @@
+// log_binario.h
+#ifndef LOG_BINARIO_H
+#define LOG_BINARIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "agregacao.h"
+#include "orientacao.h"
+
+// Log binário compacto, alternativa ao CSV do arquivo principal. Tudo little-endian,
+// em blocos de 512 bytes (um setor do cartão):
+//
+//   Cabeçalho da sessão (1 bloco): mágica[4], versão u16, tamanho do registro u16,
+//   tipo, estatísticas, orientação, sensores, dlpf, filtro de decimação u8,
+//   escala_accel, escala_gyro_x10, 0 u16, odr_hz, janela_amostras, fator_decimacao u32,
+//   inicio_us u64, ano u16, mês, dia, hora, minuto, segundo, comprimido u8, e i2c, endereço,
+//   calibração, 0 u8 de cada sensor, sessão u32 e parte u16 do catálogo da placa;
+//   zeros até o CRC-32 nos 4 últimos bytes. Uma sessão nova no mesmo arquivo começa
+//   por outro cabeçalho.
+//
+//   Blocos de dados: registros de tamanho fixo a partir do byte 0 e um rodapé nos
+//   últimos LB_RODAPE_LEN bytes: sequência do primeiro registro u32, registros u16,
+//   marca u16, CRC-32 dos bytes anteriores u32. Os registros de um bloco têm sequências
+//   consecutivas; um registro descartado na fila fecha o bloco antes da hora. A marca
+//   repete os 16 bits baixos do CRC do cabeçalho (0 nos arquivos antigos): um bloco
+//   de outra sessão que tenha ficado no cartão não passa por um desta.
+//
+// Registros (o tamanho de cada sessão fica no cabeçalho):
+//   Amostra (22 bytes): timestamp_us u64, ax, ay, az, gx, gy, gz, temp i16
+//   Janela: t_inicio_us u64, duração u32 e, para cada estatística da máscara, os 7
+//     canais (média, mín e máx i16, RMS u16, variância u32)
+//   Com orientação, os dois terminam em qw, qx, qy, qz (Q14), roll, pitch, yaw (cdeg) i16.
+//
+// O byte mais alto do timestamp é o sensor (56 bits de µs bastam para 2000 anos).
+// Sensor LB_SENSOR_TAXA marca uma troca de taxa: odr_mhz u32 e repouso u8 logo depois
+// do timestamp, o restante zerado.
+//
+// Amostras comprimidas (versão LB_VERSAO_COMPRIMIDA, byte 47 do cabeçalho = 1): os
+// blocos mantêm o rodapé, mas os registros têm tamanho variável. Cada amostra vira
+// campos em relação à anterior do mesmo sensor, em zigzag (0, -1, 1, -2... viram 0, 1,
+// 2, 3...): a variação do intervalo entre timestamps e a diferença de cada canal (e da
+// orientação, se houver). Os campos vão em grupos de até LB_GRUPO amostras, cada
+// campo com o número de bits do maior valor do grupo:
+//
+//   Grupo: n u8 (1 a LB_GRUPO) e, em bits a partir do menos significativo, a largura
+//     de cada campo (5 bits) e, por amostra, o sensor (0 a 2 bits, conforme os
+//     sensores da sessão) e os campos; completa o último byte.
+//   Chave (LB_CHAVE u8): sensor u8, timestamp u64, intervalo até a amostra anterior
+//     u32 (0 se não houver) e os canais i16, sem diferenças. A primeira amostra de
+//     cada sensor em cada bloco é uma chave, então qualquer bloco se decodifica sozinho.
+//   Troca de taxa (LB_SENSOR_TAXA u8): timestamp u64, odr_mhz u32, repouso u8.
+
+#define LB_MAGICA "IMUL"
+#define LB_VERSAO 1
+#define LB_VERSAO_COMPRIMIDA 2
+#define LB_BLOCO 512
+#define LB_RODAPE_LEN 12
+#define LB_DADOS_LEN (LB_BLOCO - LB_RODAPE_LEN)
+#define LB_MAX_SENSORES 4
+#define LB_SENSOR_TAXA 0xFF
+#define LB_TEMPO_MASCARA 0x00FFFFFFFFFFFFFFull
+#define LB_GRUPO 16
+#define LB_CHAVE 0xFE
+#define LB_MAX_CAMPOS 15       // Intervalo, 7 canais e 7 de orientação
+#define LB_MAX_REGISTROS 1024  // Por bloco comprimido
+
+typedef enum
+{
+    LB_AMOSTRAS = 0, // Amostras brutas ou decimadas
+    LB_JANELAS = 1   // Estatísticas de janela
+} lb_tipo_t;
+
+// Configuração da sessão, gravada no cabeçalho
+typedef struct
+{
+    uint8_t tipo;         // lb_tipo_t
+    uint8_t estatisticas; // Máscara de ag_estatistica_t (só nas janelas)
+    bool orientacao;
+    uint8_t num_sensores;
+    uint8_t dlpf;
+    uint8_t filtro_decimacao;
+    bool comprimido;          // Só nas amostras (LB_AMOSTRAS)
+    uint16_t escala_accel;    // LSB/g
+    uint16_t escala_gyro_x10; // LSB/(°/s) x10
+    uint32_t odr_hz;
+    uint32_t janela_amostras;
+    uint32_t fator_decimacao;
+    uint64_t inicio_us; // Relógio da placa no início da sessão
+    uint32_t sessao;    // Número e parte no catálogo (sessoes.csv); 0 fora da placa
+    uint16_t parte;
+    // Data e hora do RTC no mesmo instante; ano 0 se o relógio não foi acertado
+    uint16_t ano;
+    uint8_t mes, dia, hora, minuto, segundo;
+    struct
+    {
+        uint8_t i2c, endereco_i2c;
+        bool calibracao_gyro;
+    } sensores[LB_MAX_SENSORES];
+} lb_cabecalho_t;
+
+// Um registro decodificado. Só os campos do tipo da sessão são preenchidos.
+typedef struct
+{
+    uint8_t sensor;           // LB_SENSOR_TAXA na troca de taxa
+    uint64_t timestamp_us;    // Amostra, troca de taxa ou início da janela
+    uint64_t timestamp_fim_us;
+    int16_t canais[AG_NUM_CANAIS];
+    ag_resultado_t janela;
+    ori_saida_t orientacao;
+    uint32_t odr_mhz;
+    bool repouso;
+} lb_registro_t;
+
+// Última amostra de um sensor, base das diferenças da próxima
+typedef struct
+{
+    uint64_t timestamp_us;
+    uint32_t intervalo_us;
+    int16_t canais[LB_MAX_CAMPOS - 1];
+    bool valido; // Há amostra anterior
+    bool chave;  // Já há uma chave deste sensor no bloco corrente
+} lb_preditor_t;
+
+// Escritor: monta o bloco corrente na RAM
+typedef struct
+{
+    uint8_t bloco[LB_BLOCO] __attribute__((aligned(4)));
+    lb_cabecalho_t cab;
+    uint16_t tamanho_registro;
+    uint16_t capacidade; // Registros por bloco
+    uint16_t registros;  // No bloco corrente
+    uint32_t sequencia;  // Do primeiro registro do bloco corrente
+    uint16_t marca;      // Do cabeçalho, repetida no rodapé
+
+    // Compressão: o grupo aberto fica em campos até fechar; 'usados' conta só os
+    // bytes já fechados no bloco
+    uint16_t usados;
+    uint8_t num_campos, bits_sensor;
+    uint8_t grupo_n;
+    uint8_t larguras[LB_MAX_CAMPOS];
+    uint8_t grupo_sensor[LB_GRUPO];
+    uint32_t grupo[LB_GRUPO][LB_MAX_CAMPOS];
+    lb_preditor_t preditor[LB_MAX_SENSORES];
+} lb_escritor_t;
+
+// Leitor de um bloco de dados, registro a registro, nos dois formatos
+typedef struct
+{
+    const lb_cabecalho_t *cab;
+    const uint8_t *bloco;
+    uint16_t registros, lidos;
+    uint16_t posicao; // Próximo byte (comprimido)
+    uint8_t grupo_restante;
+    uint8_t num_campos, bits_sensor;
+    uint8_t larguras[LB_MAX_CAMPOS];
+    uint32_t acumulador; // Bits lidos e ainda não usados do grupo
+    uint8_t bits;
+    lb_preditor_t preditor[LB_MAX_SENSORES];
+} lb_leitor_t;
+
+uint32_t lb_crc32(const void *dados, uint32_t tamanho);
+
+// Bytes de um registro com esta configuração
+uint16_t lb_tamanho_registro(const lb_cabecalho_t *cab);
+
+// Serializa o cabeçalho num bloco de LB_BLOCO bytes
+void lb_montar_cabecalho(const lb_cabecalho_t *cab, uint8_t bloco[LB_BLOCO]);
+
+// Lê um bloco de cabeçalho. Retorna false se a mágica, a versão ou o CRC não conferirem.
+bool lb_ler_cabecalho(const uint8_t bloco[LB_BLOCO], lb_cabecalho_t *cab);
+
+// Marca da sessão: a de um cabeçalho (16 bits baixos do CRC) e a do rodapé de um bloco
+uint16_t lb_marca_cabecalho(const uint8_t bloco[LB_BLOCO]);
+uint16_t lb_marca_bloco(const uint8_t bloco[LB_BLOCO]);
+
+// Registros que cabem num bloco de dados (o limite do formato, se comprimido)
+uint16_t lb_capacidade(const lb_cabecalho_t *cab);
+
+// Prepara o escritor; o cabeçalho é gravado à parte, com lb_montar_cabecalho
+void lb_iniciar(lb_escritor_t *e, const lb_cabecalho_t *cab);
+
+// false se o registro não pode entrar no bloco corrente: ele está cheio ou a
+// sequência não continua a do último registro. Nesse caso o bloco é fechado antes.
+bool lb_cabe(const lb_escritor_t *e, uint32_t sequencia, const lb_registro_t *r);
+
+// Acrescenta um registro ao bloco corrente (depois de lb_cabe)
+void lb_adicionar(lb_escritor_t *e, uint32_t sequencia, const lb_registro_t *r);
+
+static inline bool lb_bloco_cheio(const lb_escritor_t *e)
+{
+    return e->registros == e->capacidade;
+}
+
+// Completa o rodapé do bloco corrente, mesmo incompleto, e retorna o bloco pronto
+// para gravar. O bloco continua aberto: uma cópia incompleta vai ao cartão no f_sync
+// e é regravada quando ele encher.
+const uint8_t *lb_fechar_bloco(lb_escritor_t *e);
+
+// Esvazia o bloco corrente depois que ele foi gravado cheio
+void lb_novo_bloco(lb_escritor_t *e);
+
+// Bytes que o bloco corrente já ocupa (o grupo aberto entra pelo tamanho que teria)
+uint16_t lb_bytes_no_bloco(const lb_escritor_t *e);
+
+// Valida o rodapé de um bloco de dados. Retorna false se o CRC não conferir.
+bool lb_ler_bloco(const uint8_t bloco[LB_BLOCO], uint32_t *sequencia, uint16_t *registros);
+
+// Decodifica o registro 'indice' de um bloco de dados sem compressão
+void lb_ler_registro(const lb_cabecalho_t *cab, const uint8_t bloco[LB_BLOCO], uint16_t indice, lb_registro_t *r);
+
+// Percorre os 'registros' de um bloco validado por lb_ler_bloco, comprimido ou não.
+// lb_ler_proximo retorna false no fim ou num bloco mal formado.
+void lb_leitor_iniciar(lb_leitor_t *l, const lb_cabecalho_t *cab, const uint8_t bloco[LB_BLOCO], uint16_t registros);
+bool lb_ler_proximo(lb_leitor_t *l, lb_registro_t *r);
+
+#endif // LOG_BINARIO_H
@@ -0,0 +1,190 @@
+#include "mpu6050.h"
+
+// LSB/g para ±2, ±4, ±8 e ±16 g
+static const uint16_t escala_accel[4] = {16384, 8192, 4096, 2048};
+// LSB/(°/s) x10 para ±250, ±500, ±1000 e ±2000 °/s
+static const uint16_t escala_gyro_x10[4] = {1310, 655, 328, 164};
+
+static bool escrever_registrador(const mpu6050_t *mpu, uint8_t reg, uint8_t valor)
+{
+    uint8_t buf[] = {reg, valor};
+    return i2c_write_blocking(mpu->i2c, mpu->addr, buf, 2, false) == 2;
+}
+
+static bool ler_registradores(const mpu6050_t *mpu, uint8_t reg, uint8_t *buf, size_t len)
+{
+    // true para manter o controle do barramento (repeated start)
+    if (i2c_write_blocking(mpu->i2c, mpu->addr, &reg, 1, true) != 1)
+        return false;
+    return i2c_read_blocking(mpu->i2c, mpu->addr, buf, len, false) == (int)len;
+}
+
+bool mpu6050_configurar(const mpu6050_t *mpu)
+{
+    return escrever_registrador(mpu, MPU6050_REG_SMPLRT_DIV, mpu->smplrt_div) &&
+           escrever_registrador(mpu, MPU6050_REG_CONFIG, (uint8_t)mpu->dlpf & 0x07) &&
+           escrever_registrador(mpu, MPU6050_REG_GYRO_CONFIG, (uint8_t)(mpu->gyro_fs << 3)) &&
+           escrever_registrador(mpu, MPU6050_REG_ACCEL_CONFIG, (uint8_t)(mpu->accel_fs << 3));
+}
+
+bool mpu6050_reset(const mpu6050_t *mpu)
+{
+    // DEVICE_RESET
+    if (!escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_1, 0x80))
+        return false;
+    sleep_ms(100); // Allow device to reset and stabilize
+
+    // Sai do modo sleep usando o PLL do giroscópio X como clock (mais estável que o oscilador interno)
+    if (!escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_1, 0x01))
+        return false;
+    sleep_ms(10); // Allow stabilization after waking up
+
+    uint8_t who_am_i = 0;
+    if (!ler_registradores(mpu, MPU6050_REG_WHO_AM_I, &who_am_i, 1) || (who_am_i & 0x7E) != 0x68)
+        return false;
+
+    return mpu6050_configurar(mpu);
+}
+
+void mpu6050_decodificar(const uint8_t bloco[MPU6050_BLOCO_DADOS_LEN], mpu6050_dados_t *dados)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        dados->accel[i] = (int16_t)(bloco[i * 2] << 8 | bloco[(i * 2) + 1]);
+        dados->gyro[i] = (int16_t)(bloco[8 + i * 2] << 8 | bloco[8 + (i * 2) + 1]);
+    }
+    dados->temp = (int16_t)(bloco[6] << 8 | bloco[7]);
+}
+
+bool mpu6050_read_raw(const mpu6050_t *mpu, mpu6050_dados_t *dados)
+{
+    uint8_t bloco[MPU6050_BLOCO_DADOS_LEN];
+    if (!ler_registradores(mpu, MPU6050_REG_ACCEL_XOUT_H, bloco, sizeof bloco))
+        return false;
+    mpu6050_decodificar(bloco, dados);
+    return true;
+}
+
+bool mpu6050_fifo_iniciar(const mpu6050_t *mpu)
+{
+    // Desliga e reseta a FIFO antes de escolher as fontes, para começar alinhado em um quadro
+    bool overflow_antigo;
+    return escrever_registrador(mpu, MPU6050_REG_USER_CTRL, 0x04) &&  // FIFO_RESET
+           escrever_registrador(mpu, MPU6050_REG_FIFO_EN, 0xF8) &&    // TEMP, XG, YG, ZG, ACCEL
+           escrever_registrador(mpu, MPU6050_REG_INT_ENABLE, 0x10) && // FIFO_OFLOW_EN
+           mpu6050_fifo_transbordou(mpu, &overflow_antigo) &&         // limpa flags antigos
+           escrever_registrador(mpu, MPU6050_REG_USER_CTRL, 0x40);    // FIFO_EN
+}
+
+bool mpu6050_fifo_parar(const mpu6050_t *mpu)
+{
+    return escrever_registrador(mpu, MPU6050_REG_USER_CTRL, 0x00) &&
+           escrever_registrador(mpu, MPU6050_REG_FIFO_EN, 0x00) &&
+           escrever_registrador(mpu, MPU6050_REG_INT_ENABLE, 0x00) &&
+           escrever_registrador(mpu, MPU6050_REG_USER_CTRL, 0x04);
+}
+
+bool mpu6050_fifo_resetar(const mpu6050_t *mpu)
+{
+    return escrever_registrador(mpu, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET) &&
+           escrever_registrador(mpu, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+}
+
+bool mpu6050_fifo_contar(const mpu6050_t *mpu, uint16_t *bytes)
+{
+    uint8_t buf[2];
+    if (!ler_registradores(mpu, MPU6050_REG_FIFO_COUNTH, buf, 2))
+        return false;
+    *bytes = (uint16_t)(buf[0] << 8 | buf[1]);
+    return true;
+}
+
+bool mpu6050_fifo_transbordou(const mpu6050_t *mpu, bool *overflow)
+{
+    uint8_t status;
+    if (!ler_registradores(mpu, MPU6050_REG_INT_STATUS, &status, 1))
+        return false;
+    *overflow = (status & MPU6050_INT_FIFO_OFLOW) != 0;
+    return true;
+}
+
+bool mpu6050_fifo_ler(const mpu6050_t *mpu, uint8_t *buf, uint16_t quadros)
+{
+    // FIFO_R_W não auto-incrementa: toda a rajada sai do mesmo registrador
+    return ler_registradores(mpu, MPU6050_REG_FIFO_R_W, buf, (size_t)quadros * MPU6050_FIFO_QUADRO_LEN);
+}
+
+bool mpu6050_drdy_habilitar(const mpu6050_t *mpu, bool habilitar)
+{
+    // INT_RD_CLEAR: qualquer leitura limpa o status; sem LATCH_INT_EN o pino gera um pulso por amostra
+    return escrever_registrador(mpu, MPU6050_REG_INT_PIN_CFG, 0x10) &&
+           escrever_registrador(mpu, MPU6050_REG_INT_ENABLE, habilitar ? 0x01 : 0x00); // DATA_RDY_EN
+}
+
+bool mpu6050_definir_offsets_gyro(const mpu6050_t *mpu, const int16_t offsets[3])
+{
+    // Os seis registradores são contíguos (big-endian): uma única escrita com auto-incremento
+    uint8_t buf[7] = {MPU6050_REG_XG_OFFS_USRH};
+    for (int i = 0; i < 3; i++)
+    {
+        buf[1 + i * 2] = (uint8_t)((uint16_t)offsets[i] >> 8);
+        buf[2 + i * 2] = (uint8_t)offsets[i];
+    }
+    return i2c_write_blocking(mpu->i2c, mpu->addr, buf, sizeof buf, false) == (int)sizeof buf;
+}
+
+bool mpu6050_ciclo(const mpu6050_t *mpu, bool ligar, mpu6050_ciclo_t freq)
+{
+    if (ligar)
+    {
+        // Gyro em standby (STBY_XG/YG/ZG) e CYCLE com o oscilador interno: o PLL do gyro para
+        return escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_2, (uint8_t)(freq << 6) | 0x07) &&
+               escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_1, 0x20);
+    }
+    // Religa o gyro antes de voltar ao PLL do giroscópio X, como no reset
+    return escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_2, 0x00) &&
+           escrever_registrador(mpu, MPU6050_REG_PWR_MGMT_1, 0x01);
+}
+
+uint32_t mpu6050_ciclo_mhz(mpu6050_ciclo_t freq)
+{
+    static const uint32_t mhz[4] = {1250, 5000, 20000, 40000};
+    return mhz[freq & 3];
+}
+
+uint32_t mpu6050_taxa_amostragem_hz(const mpu6050_t *mpu)
+{
+    uint32_t taxa_gyro = (mpu->dlpf == MPU6050_DLPF_260HZ) ? 8000 : 1000;
+    return taxa_gyro / (1u + mpu->smplrt_div);
+}
+
+uint16_t mpu6050_escala_accel(const mpu6050_t *mpu)
+{
+    return escala_accel[mpu->accel_fs & 0x03];
+}
+
+uint16_t mpu6050_escala_gyro_x10(const mpu6050_t *mpu)
+{
+    return escala_gyro_x10[mpu->gyro_fs & 0x03];
+}
+
+static bool imu_reset_mpu6050(imu_t *imu)
+{
+    return mpu6050_reset(imu->contexto);
+}
+
+static bool imu_ler_mpu6050(imu_t *imu, imu_dados_t *dados, uint64_t *timestamp_us)
+{
+    (void)timestamp_us; // O instante é o da leitura, marcado por quem chama
+    return mpu6050_read_raw(imu->contexto, dados);
+}
+
+void mpu6050_como_imu(const mpu6050_t *mpu, imu_t *imu)
+{
+    static const imu_ops_t ops = {.reset = imu_reset_mpu6050, .ler = imu_ler_mpu6050};
+    imu->ops = &ops;
+    imu->contexto = mpu;
+    imu->taxa_hz = mpu6050_taxa_amostragem_hz(mpu);
+    imu->escala_accel = mpu6050_escala_accel(mpu);
+    imu->escala_gyro_x10 = mpu6050_escala_gyro_x10(mpu);
+}
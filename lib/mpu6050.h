@@ -0,0 +1,163 @@
+// mpu6050.h
+#ifndef MPU6050_H
+#define MPU6050_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "imu.h"
+
+// Mapa de registradores usados pelo driver
+#define MPU6050_REG_XG_OFFS_USRH 0x13 // Offsets do gyro (nota de aplicação de offsets da InvenSense)
+#define MPU6050_REG_SMPLRT_DIV 0x19
+#define MPU6050_REG_CONFIG 0x1A
+#define MPU6050_REG_GYRO_CONFIG 0x1B
+#define MPU6050_REG_ACCEL_CONFIG 0x1C
+#define MPU6050_REG_FIFO_EN 0x23
+#define MPU6050_REG_INT_PIN_CFG 0x37
+#define MPU6050_REG_INT_ENABLE 0x38
+#define MPU6050_REG_INT_STATUS 0x3A
+#define MPU6050_REG_ACCEL_XOUT_H 0x3B
+#define MPU6050_REG_USER_CTRL 0x6A
+#define MPU6050_REG_PWR_MGMT_1 0x6B
+#define MPU6050_REG_PWR_MGMT_2 0x6C
+#define MPU6050_REG_FIFO_COUNTH 0x72
+#define MPU6050_REG_FIFO_R_W 0x74
+#define MPU6050_REG_WHO_AM_I 0x75
+
+// Bits do modo FIFO
+#define MPU6050_INT_FIFO_OFLOW 0x10       // INT_STATUS
+#define MPU6050_USER_CTRL_FIFO_EN 0x40
+#define MPU6050_USER_CTRL_FIFO_RESET 0x04
+
+// int_gpio de um sensor sem o pino INT ligado
+#define MPU6050_SEM_INT -1
+
+// Bloco contíguo 0x3B..0x48: accel (6), temp (2), gyro (6)
+#define MPU6050_BLOCO_DADOS_LEN 14
+
+// FIFO interna de 1 KB. Com accel+temp+gyro habilitados cada quadro tem o
+// mesmo layout de 14 bytes do bloco 0x3B..0x48.
+#define MPU6050_FIFO_TAMANHO 1024
+#define MPU6050_FIFO_QUADRO_LEN MPU6050_BLOCO_DADOS_LEN
+#define MPU6050_FIFO_MAX_QUADROS (MPU6050_FIFO_TAMANHO / MPU6050_FIFO_QUADRO_LEN)
+
+// Fundo de escala do acelerômetro (AFS_SEL, bits 4:3 de ACCEL_CONFIG)
+typedef enum
+{
+    MPU6050_ACCEL_2G = 0,
+    MPU6050_ACCEL_4G = 1,
+    MPU6050_ACCEL_8G = 2,
+    MPU6050_ACCEL_16G = 3
+} mpu6050_accel_fs_t;
+
+// Fundo de escala do giroscópio (FS_SEL, bits 4:3 de GYRO_CONFIG)
+typedef enum
+{
+    MPU6050_GYRO_250DPS = 0,
+    MPU6050_GYRO_500DPS = 1,
+    MPU6050_GYRO_1000DPS = 2,
+    MPU6050_GYRO_2000DPS = 3
+} mpu6050_gyro_fs_t;
+
+// Filtro passa-baixa digital (DLPF_CFG, banda do accel). 260 Hz desliga o filtro
+// e leva a taxa interna do giroscópio para 8 kHz.
+typedef enum
+{
+    MPU6050_DLPF_260HZ = 0,
+    MPU6050_DLPF_184HZ = 1,
+    MPU6050_DLPF_94HZ = 2,
+    MPU6050_DLPF_44HZ = 3,
+    MPU6050_DLPF_21HZ = 4,
+    MPU6050_DLPF_10HZ = 5,
+    MPU6050_DLPF_5HZ = 6
+} mpu6050_dlpf_t;
+
+// Frequência de despertar do modo cíclico (LP_WAKE_CTRL, bits 7:6 de PWR_MGMT_2)
+typedef enum
+{
+    MPU6050_CICLO_1_25HZ = 0,
+    MPU6050_CICLO_5HZ = 1,
+    MPU6050_CICLO_20HZ = 2,
+    MPU6050_CICLO_40HZ = 3
+} mpu6050_ciclo_t;
+
+// Configuração e barramento de um sensor
+typedef struct
+{
+    i2c_inst_t *i2c;
+    uint8_t addr;              // 0x68 (AD0 baixo) ou 0x69 (AD0 alto)
+    int int_gpio;              // GPIO ligado ao pino INT (modo data-ready) ou MPU6050_SEM_INT
+    uint8_t smplrt_div;        // ODR = taxa do giroscópio / (1 + smplrt_div)
+    mpu6050_dlpf_t dlpf;
+    mpu6050_accel_fs_t accel_fs;
+    mpu6050_gyro_fs_t gyro_fs;
+} mpu6050_t;
+
+// Uma amostra bruta, já convertida para int16 na ordem do host
+typedef imu_dados_t mpu6050_dados_t;
+
+// Reseta o sensor, acorda com o PLL do giroscópio como clock e aplica
+// ODR, DLPF e fundos de escala. Retorna false se o sensor não responder.
+bool mpu6050_reset(const mpu6050_t *mpu);
+
+// Reaplica SMPLRT_DIV, CONFIG, GYRO_CONFIG e ACCEL_CONFIG sem resetar o chip
+bool mpu6050_configurar(const mpu6050_t *mpu);
+
+// Lê os 14 bytes de 0x3B..0x48 numa única transação I2C, garantindo que
+// accel, temp e gyro pertencem ao mesmo ciclo de atualização do sensor.
+bool mpu6050_read_raw(const mpu6050_t *mpu, mpu6050_dados_t *dados);
+
+// Converte um bloco big-endian no formato de 0x3B..0x48 para a estrutura
+void mpu6050_decodificar(const uint8_t bloco[MPU6050_BLOCO_DADOS_LEN], mpu6050_dados_t *dados);
+
+// Esvazia e habilita a FIFO com accel, temp e gyro (um quadro por amostra do ODR)
+bool mpu6050_fifo_iniciar(const mpu6050_t *mpu);
+
+// Desabilita a FIFO e volta à leitura direta dos registradores
+bool mpu6050_fifo_parar(const mpu6050_t *mpu);
+
+// Descarta o conteúdo da FIFO mantendo-a habilitada (ressincroniza os quadros)
+bool mpu6050_fifo_resetar(const mpu6050_t *mpu);
+
+// Número de bytes presentes na FIFO
+bool mpu6050_fifo_contar(const mpu6050_t *mpu, uint16_t *bytes);
+
+// Lê INT_STATUS (que limpa os flags) e informa se a FIFO transbordou desde a última consulta
+bool mpu6050_fifo_transbordou(const mpu6050_t *mpu, bool *overflow);
+
+// Lê 'quadros' quadros de 14 bytes da FIFO em uma única rajada
+bool mpu6050_fifo_ler(const mpu6050_t *mpu, uint8_t *buf, uint16_t quadros);
+
+// Liga/desliga o pulso de data-ready no pino INT (ativo alto, push-pull, 50 us)
+bool mpu6050_drdy_habilitar(const mpu6050_t *mpu, bool habilitar);
+
+// Grava XG/YG/ZG_OFFS_USR, que o sensor soma a cada leitura do giroscópio. A unidade
+// é 1 LSB a ±1000 °/s, qualquer que seja o fundo de escala. O reset do chip zera os offsets.
+bool mpu6050_definir_offsets_gyro(const mpu6050_t *mpu, const int16_t offsets[3]);
+
+// Modo cíclico de baixo consumo: o giroscópio fica em standby (lê zero) e o chip dorme
+// entre medidas do acelerômetro, feitas 'freq' vezes por segundo (10 a 110 µA contra
+// ~3,9 mA com tudo ligado). Ao desligar, o giroscópio leva ~30 ms para estabilizar.
+bool mpu6050_ciclo(const mpu6050_t *mpu, bool ligar, mpu6050_ciclo_t freq);
+
+// Frequência de despertar do modo cíclico, em mHz
+uint32_t mpu6050_ciclo_mhz(mpu6050_ciclo_t freq);
+
+// Taxa de saída de dados (Hz) resultante de DLPF e SMPLRT_DIV
+uint32_t mpu6050_taxa_amostragem_hz(const mpu6050_t *mpu);
+
+// Fatores de escala do fundo de escala configurado
+uint16_t mpu6050_escala_accel(const mpu6050_t *mpu);     // LSB por g
+uint16_t mpu6050_escala_gyro_x10(const mpu6050_t *mpu);  // LSB por °/s, multiplicado por 10
+
+// Preenche 'imu' com o sensor por trás da interface genérica: reset e leitura
+// direta dos registradores. 'mpu' precisa continuar válido enquanto 'imu' for usado.
+void mpu6050_como_imu(const mpu6050_t *mpu, imu_t *imu);
+
+// Tabela de sensores da placa, definida em hw_config.c no mesmo molde de sd_get_num/sd_get_by_num
+size_t mpu_get_num(void);
+mpu6050_t *mpu_get_by_num(size_t num);
+
+#endif // MPU6050_H
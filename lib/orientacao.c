@@ -0,0 +1,142 @@
+#include "orientacao.h"
+#include <math.h>
+#include <string.h>
+
+#define PI_F 3.14159265f
+
+// Lacunas maiores que isso não são integradas: o gyro perdeu a rotação do intervalo
+// e o acelerômetro reconverge sozinho
+#define ORI_DT_MAX_US 100000
+
+static void normalizar(float *v, int n)
+{
+    float norma2 = 0.0f;
+    for (int i = 0; i < n; i++)
+        norma2 += v[i] * v[i];
+    if (norma2 == 0.0f)
+        return;
+    float inv = 1.0f / sqrtf(norma2);
+    for (int i = 0; i < n; i++)
+        v[i] *= inv;
+}
+
+// Quaternion com o roll e o pitch medidos pela gravidade (yaw zero)
+static void alinhar_com_gravidade(ori_filtro_t *f, float ax, float ay, float az)
+{
+    float roll = atan2f(ay, az);
+    float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+    float cr = cosf(roll / 2), sr = sinf(roll / 2);
+    float cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+    f->q[0] = cr * cp;
+    f->q[1] = sr * cp;
+    f->q[2] = cr * sp;
+    f->q[3] = -sr * sp;
+}
+
+void ori_iniciar(ori_filtro_t *f, uint16_t escala_gyro_x10, uint32_t periodo_us, float kp, float ki)
+{
+    memset(f, 0, sizeof *f);
+    f->q[0] = 1.0f;
+    f->kp = kp;
+    f->ki = ki;
+    // LSB -> °/s -> rad/s
+    f->rad_por_lsb = 10.0f / (float)escala_gyro_x10 * (PI_F / 180.0f);
+    f->periodo_us = periodo_us;
+}
+
+void ori_atualizar(ori_filtro_t *f, const int16_t accel[3], const int16_t gyro[3], uint64_t timestamp_us)
+{
+    float a[3] = {(float)accel[0], (float)accel[1], (float)accel[2]};
+    bool gravidade_valida = accel[0] || accel[1] || accel[2];
+    if (gravidade_valida)
+        normalizar(a, 3);
+
+    if (!f->iniciado)
+    {
+        if (gravidade_valida)
+            alinhar_com_gravidade(f, a[0], a[1], a[2]);
+        f->iniciado = true;
+        f->ultimo_timestamp_us = timestamp_us;
+        return;
+    }
+
+    uint32_t dt_us = (uint32_t)(timestamp_us - f->ultimo_timestamp_us);
+    f->ultimo_timestamp_us = timestamp_us;
+    if (dt_us == 0 || dt_us > ORI_DT_MAX_US)
+        dt_us = f->periodo_us;
+    float dt = (float)dt_us * 1e-6f;
+
+    float g[3] = {gyro[0] * f->rad_por_lsb, gyro[1] * f->rad_por_lsb, gyro[2] * f->rad_por_lsb};
+    float q0 = f->q[0], q1 = f->q[1], q2 = f->q[2], q3 = f->q[3];
+
+    if (gravidade_valida)
+    {
+        // Gravidade prevista pelo quaternion (metade do vetor, o fator 2 entra no ganho)
+        float vx = q1 * q3 - q0 * q2;
+        float vy = q0 * q1 + q2 * q3;
+        float vz = q0 * q0 - 0.5f + q3 * q3;
+
+        // Erro = medida x prevista
+        float e[3] = {a[1] * vz - a[2] * vy, a[2] * vx - a[0] * vz, a[0] * vy - a[1] * vx};
+        for (int i = 0; i < 3; i++)
+        {
+            if (f->ki > 0.0f)
+            {
+                f->integral[i] += 2.0f * f->ki * e[i] * dt;
+                g[i] += f->integral[i];
+            }
+            g[i] += 2.0f * f->kp * e[i];
+        }
+    }
+
+    // q' = q + ½·q ⊗ (0, ω)·dt
+    float meio_dt = 0.5f * dt;
+    for (int i = 0; i < 3; i++)
+        g[i] *= meio_dt;
+    f->q[0] = q0 - q1 * g[0] - q2 * g[1] - q3 * g[2];
+    f->q[1] = q1 + q0 * g[0] + q2 * g[2] - q3 * g[1];
+    f->q[2] = q2 + q0 * g[1] - q1 * g[2] + q3 * g[0];
+    f->q[3] = q3 + q0 * g[2] + q1 * g[1] - q2 * g[0];
+    normalizar(f->q, 4);
+}
+
+static int16_t para_q14(float v)
+{
+    int32_t q = (int32_t)lroundf(v * 16384.0f);
+    return (int16_t)(q > INT16_MAX ? INT16_MAX : q < INT16_MIN ? INT16_MIN : q);
+}
+
+static int16_t para_cdeg(float rad)
+{
+    return (int16_t)lroundf(rad * (18000.0f / PI_F));
+}
+
+// Ângulos de Euler ZYX de um quaternion unitário
+static void angulos(float q0, float q1, float q2, float q3, int16_t rpy_cdeg[3])
+{
+    float seno_pitch = 2.0f * (q0 * q2 - q3 * q1);
+    seno_pitch = seno_pitch > 1.0f ? 1.0f : seno_pitch < -1.0f ? -1.0f : seno_pitch;
+    rpy_cdeg[0] = para_cdeg(atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)));
+    rpy_cdeg[1] = para_cdeg(asinf(seno_pitch));
+    rpy_cdeg[2] = para_cdeg(atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)));
+}
+
+void ori_obter_saida(const ori_filtro_t *f, ori_saida_t *saida)
+{
+    ori_quaternion_q14(f, saida->q);
+    angulos(f->q[0], f->q[1], f->q[2], f->q[3], saida->rpy_cdeg);
+}
+
+void ori_quaternion_q14(const ori_filtro_t *f, int16_t q[4])
+{
+    for (int i = 0; i < 4; i++)
+        q[i] = para_q14(f->q[i]);
+}
+
+void ori_saida_de_q14(const int16_t q[4], ori_saida_t *saida)
+{
+    const float escala = 1.0f / 16384.0f;
+    for (int i = 0; i < 4; i++)
+        saida->q[i] = q[i];
+    angulos(q[0] * escala, q[1] * escala, q[2] * escala, q[3] * escala, saida->rpy_cdeg);
+}
@@ -0,0 +1,56 @@
+// orientacao.h
+#ifndef ORIENTACAO_H
+#define ORIENTACAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Filtro de Mahony: o giroscópio integra a rotação e o acelerômetro corrige a
+// deriva de roll e pitch por um PI sobre o erro da direção da gravidade. Sem
+// magnetômetro, o yaw é relativo à posição inicial e deriva com o bias do gyro.
+//
+// As contas são em float. No RP2040, o pico_float do SDK desvia cada operação
+// para as rotinas otimizadas da ROM (~60 ciclos por soma ou produto). Orçamento
+// estimado: ~100 operações por amostra, ~6000 ciclos (≈50 µs a 125 MHz, ~5% do
+// core 1 a 1 kHz). Os ângulos de Euler (atan2/asin) custam outro tanto e só são
+// calculados quando alguém os lê. O atalho 'k' mede os valores reais.
+
+// Ganhos padrão: Kp alto converge rápido a partir da inclinação inicial; Ki = 0
+// dispensa o integrador (o bias do gyro é tratado na calibração)
+#define ORI_KP_PADRAO 1.0f
+#define ORI_KI_PADRAO 0.0f
+
+typedef struct
+{
+    float q[4];            // w, x, y, z (norma 1)
+    float integral[3];     // Termo integral do erro, em rad/s
+    float kp, ki;
+    float rad_por_lsb;     // Escala do giroscópio
+    uint32_t periodo_us;   // Intervalo usado na primeira amostra e após lacunas longas
+    uint64_t ultimo_timestamp_us;
+    bool iniciado;         // A primeira amostra alinha o quaternion com a gravidade
+} ori_filtro_t;
+
+// Saída compacta, gravada no log e mostrada no display
+typedef struct
+{
+    int16_t q[4];        // Quaternion w, x, y, z em Q14 (16384 = 1,0)
+    int16_t rpy_cdeg[3]; // Roll, pitch e yaw em centésimos de grau
+} ori_saida_t;
+
+// 'escala_gyro_x10' é o LSB/(°/s) x10 do fundo de escala (mpu6050_escala_gyro_x10)
+void ori_iniciar(ori_filtro_t *f, uint16_t escala_gyro_x10, uint32_t periodo_us, float kp, float ki);
+
+// Integra uma amostra bruta. O passo de tempo vem dos timestamps de captura.
+void ori_atualizar(ori_filtro_t *f, const int16_t accel[3], const int16_t gyro[3], uint64_t timestamp_us);
+
+// Quaternion e ângulos de Euler (convenção aeronáutica ZYX) do estado atual
+void ori_obter_saida(const ori_filtro_t *f, ori_saida_t *saida);
+
+// Só o quaternion em Q14, sem os ângulos: barato o bastante para guardar a cada amostra
+void ori_quaternion_q14(const ori_filtro_t *f, int16_t q[4]);
+
+// Saída completa a partir de um quaternion guardado com ori_quaternion_q14
+void ori_saida_de_q14(const int16_t q[4], ori_saida_t *saida);
+
+#endif // ORIENTACAO_H
@@ -0,0 +1,192 @@
+#include "prealocado.h"
+#include <string.h>
+#include "hw_config.h"
+
+// Flag interno de ff.c (FA_MODIFIED): faz f_sync regravar a entrada do diretório
+#define FA_MODIFICADO 0x40
+
+#define SETOR 512
+
+static FRESULT escrever_setores(prealocado_t *p, FSIZE_t posicao, const uint8_t *dados, uint32_t setores)
+{
+    int rc = p->sd->write_blocks(p->sd, dados, p->setor_inicial + posicao / SETOR, setores);
+    if (rc != SD_BLOCK_DEVICE_ERROR_NONE)
+    {
+        p->erros++;
+        return FR_DISK_ERR;
+    }
+    return FR_OK;
+}
+
+// Pedaço de um setor: o que já havia nele é lido antes; o que ainda não foi escrito fica zerado
+static FRESULT escrever_parcial(prealocado_t *p, const uint8_t *dados, uint32_t len)
+{
+    FSIZE_t inicio_setor = p->ponteiro - p->ponteiro % SETOR;
+    if (inicio_setor < p->tamanho)
+    {
+        if (p->sd->read_blocks(p->sd, p->setor, p->setor_inicial + inicio_setor / SETOR, 1) !=
+            SD_BLOCK_DEVICE_ERROR_NONE)
+        {
+            p->erros++;
+            return FR_DISK_ERR;
+        }
+    }
+    else
+    {
+        memset(p->setor, 0, sizeof p->setor);
+    }
+    memcpy(&p->setor[p->ponteiro % SETOR], dados, len);
+    return escrever_setores(p, inicio_setor, p->setor, 1);
+}
+
+static FRESULT destino_escrever(void *contexto, const void *dados, UINT len, UINT *escritos)
+{
+    prealocado_t *p = contexto;
+    const uint8_t *d = dados;
+    *escritos = 0;
+    if (p->ponteiro + len > p->reservado)
+        return FR_DENIED;
+
+    while (len)
+    {
+        uint32_t deslocamento = (uint32_t)(p->ponteiro % SETOR);
+        uint32_t n;
+        FRESULT fr;
+        if (deslocamento || len < SETOR)
+        {
+            n = SETOR - deslocamento < len ? SETOR - deslocamento : len;
+            fr = escrever_parcial(p, d, n);
+        }
+        else
+        {
+            // O caso comum: blocos inteiros do gravador, vários setores num comando só
+            n = len - len % SETOR;
+            fr = escrever_setores(p, p->ponteiro, d, n / SETOR);
+        }
+        if (fr != FR_OK)
+            return fr;
+        d += n;
+        len -= n;
+        *escritos += n;
+        p->ponteiro += n;
+        if (p->ponteiro > p->tamanho)
+            p->tamanho = p->ponteiro;
+    }
+    return FR_OK;
+}
+
+static FRESULT destino_posicionar(void *contexto, FSIZE_t posicao)
+{
+    prealocado_t *p = contexto;
+    if (posicao > p->reservado)
+        return FR_DENIED;
+    p->ponteiro = posicao;
+    return FR_OK;
+}
+
+static FRESULT destino_sincronizar(void *contexto)
+{
+    return prealocado_checkpoint(contexto);
+}
+
+void prealocado_como_destino(prealocado_t *p, grav_destino_t *destino)
+{
+    destino->escrever = destino_escrever;
+    destino->posicionar = destino_posicionar;
+    destino->sincronizar = destino_sincronizar;
+    destino->contexto = p;
+}
+
+FRESULT prealocado_checkpoint(prealocado_t *p)
+{
+    // O tamanho do diretório passa a cobrir os dados; a cadeia de clusters já está
+    // completa desde f_expand, então só a entrada do diretório é regravada
+    p->arquivo->obj.objsize = p->tamanho;
+    p->arquivo->flag |= FA_MODIFICADO;
+    FRESULT fr = f_sync(p->arquivo);
+    if (fr == FR_OK)
+    {
+        p->confirmado = p->tamanho;
+        p->checkpoints++;
+    }
+    return fr;
+}
+
+FRESULT prealocado_criar(prealocado_t *p, FIL *arquivo, const char *nome, FSIZE_t bytes)
+{
+    memset(p, 0, sizeof *p);
+    p->arquivo = arquivo;
+    FRESULT fr = f_open(arquivo, nome, FA_CREATE_NEW | FA_WRITE);
+    if (fr != FR_OK)
+        return fr;
+
+    fr = f_expand(arquivo, bytes, 1);
+    FATFS *fs = arquivo->obj.fs;
+    p->sd = fr == FR_OK ? sd_get_by_num(fs->pdrv) : NULL;
+    if (fr == FR_OK && !p->sd)
+        fr = FR_INT_ERR;
+    if (fr == FR_OK)
+    {
+        p->setor_inicial = fs->database + (LBA_t)fs->csize * (arquivo->obj.sclust - 2);
+        p->reservado = bytes;
+        fr = prealocado_checkpoint(p); // Começa com tamanho 0 no diretório
+    }
+    if (fr != FR_OK)
+    {
+        f_close(arquivo);
+        f_unlink(nome);
+    }
+    return fr;
+}
+
+FRESULT prealocado_fechar(prealocado_t *p)
+{
+    // f_truncate só libera o que estiver além do tamanho: a reserva inteira volta a
+    // contar como arquivo e o corte no fim dos dados devolve o resto
+    FIL *arquivo = p->arquivo;
+    arquivo->obj.objsize = p->reservado;
+    FRESULT fr = f_lseek(arquivo, p->tamanho);
+    if (fr == FR_OK)
+        fr = f_truncate(arquivo);
+    FRESULT fr_close = f_close(arquivo);
+    if (fr == FR_OK)
+    {
+        fr = fr_close;
+        p->confirmado = p->tamanho;
+    }
+    return fr;
+}
+
+FRESULT prealocado_reabrir(prealocado_t *p, FIL *arquivo, const char *nome, FSIZE_t bytes)
+{
+    memset(p, 0, sizeof *p);
+    p->arquivo = arquivo;
+    FRESULT fr = f_open(arquivo, nome, FA_READ | FA_WRITE);
+    if (fr != FR_OK)
+        return fr;
+
+    FATFS *fs = arquivo->obj.fs;
+    p->sd = sd_get_by_num(fs->pdrv);
+    p->tamanho = p->confirmado = p->ponteiro = f_size(arquivo);
+    // A reserva tem de caber no volume a partir do primeiro cluster; fora disso o
+    // arquivo não é o que prealocado_criar deixou
+    DWORD clusters = (DWORD)((bytes + (FSIZE_t)fs->csize * SETOR - 1) / ((FSIZE_t)fs->csize * SETOR));
+    if (!p->sd || arquivo->obj.sclust < 2 || arquivo->obj.sclust - 2 + clusters > fs->n_fatent - 2 ||
+        bytes < p->tamanho)
+        return FR_OK;
+    p->setor_inicial = fs->database + (LBA_t)fs->csize * (arquivo->obj.sclust - 2);
+    p->reservado = bytes;
+    return FR_OK;
+}
+
+FRESULT prealocado_ler(prealocado_t *p, FSIZE_t posicao, uint8_t setor[SETOR])
+{
+    if (posicao + SETOR > p->reservado)
+        return FR_DENIED;
+    if (p->sd->read_blocks(p->sd, setor, p->setor_inicial + posicao / SETOR, 1) != SD_BLOCK_DEVICE_ERROR_NONE)
+    {
+        p->erros++;
+        return FR_DISK_ERR;
+    }
+    return FR_OK;
+}
@@ -0,0 +1,62 @@
+// prealocado.h
+#ifndef PREALOCADO_H
+#define PREALOCADO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+#include "gravador.h"
+#include "sd_card.h"
+
+// Arquivo pré-alocado: f_expand reserva de uma vez uma faixa contígua de clusters e
+// os dados vão direto para os setores dela, pelo write_blocks do driver do SD. Não há
+// cadeia de clusters crescendo a cada escrita nem FAT regravado no caminho dos dados;
+// o FatFs só é chamado nos checkpoints (o tamanho no diretório alcança os dados) e
+// no fechamento (o que sobrou da reserva volta a ficar livre).
+//
+// Entre dois checkpoints os dados já estão no cartão, mas além do tamanho gravado
+// no diretório: num corte de energia eles ficam na reserva e podem ser recuperados.
+
+typedef struct
+{
+    FIL *arquivo;
+    sd_card_t *sd;
+    LBA_t setor_inicial; // Primeiro setor da reserva
+    FSIZE_t reservado;   // Bytes reservados por f_expand
+    FSIZE_t ponteiro;    // Próxima escrita, como o fptr do FIL
+    FSIZE_t tamanho;     // Fim dos dados já gravados
+    FSIZE_t confirmado;  // Tamanho no diretório, do último checkpoint
+    uint32_t checkpoints;
+    uint32_t erros;
+    uint8_t setor[512] __attribute__((aligned(4))); // Setor parcial, completado antes de ir ao cartão
+} prealocado_t;
+
+// Cria 'nome' (não pode existir) e reserva 'bytes' contíguos. Em erro o arquivo é
+// removido; FR_DENIED indica que não há espaço contíguo suficiente.
+FRESULT prealocado_criar(prealocado_t *p, FIL *arquivo, const char *nome, FSIZE_t bytes);
+
+// Destino para gravador_usar_destino: escritas em setores, f_sync vira checkpoint
+void prealocado_como_destino(prealocado_t *p, grav_destino_t *destino);
+
+// Atualiza o tamanho no diretório até o fim dos dados (um setor de diretório, sem FAT)
+FRESULT prealocado_checkpoint(prealocado_t *p);
+
+// Corta o arquivo no fim dos dados, libera o resto da reserva e fecha
+FRESULT prealocado_fechar(prealocado_t *p);
+
+// Reabre 'nome', criado por prealocado_criar com 'bytes' e nunca fechado (a placa
+// desligou antes), para ler a reserva além do tamanho no diretório. Os dados vão
+// até o tamanho no diretório; quem recupera mais ajusta 'tamanho' antes de
+// prealocado_fechar. Sem clusters (arquivo já cortado em 0) a reserva fica em 0.
+FRESULT prealocado_reabrir(prealocado_t *p, FIL *arquivo, const char *nome, FSIZE_t bytes);
+
+// Lê o setor da reserva que começa em 'posicao' (múltiplo de 512)
+FRESULT prealocado_ler(prealocado_t *p, FSIZE_t posicao, uint8_t setor[512]);
+
+// Bytes ainda livres na reserva
+static inline FSIZE_t prealocado_livre(const prealocado_t *p)
+{
+    return p->reservado - p->ponteiro;
+}
+
+#endif // PREALOCADO_H
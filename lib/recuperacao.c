@@ -0,0 +1,287 @@
+#include "recuperacao.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_binario.h"
+#include "prealocado.h"
+
+#define SETOR 512
+#define JANELA_CSV (4 * SETOR)         // Fim do CSV lido de uma vez: várias linhas inteiras
+#define LINHA_MAX 1024                 // Linha mais longa aceita (o trailer passa de GRAV_LINHA_MAX)
+#define PREFIXO_LINHA 48               // Basta para seq, sensor e timestamp
+#define SALTO_MAX_SEQUENCIA 65536u     // Registros descartados entre duas linhas seguidas
+#define SALTO_MAX_US 60000000ull       // Entre dois timestamps seguidos (janelas longas)
+#define RECUO_MAX_US 1000000ull        // Sensores diferentes levemente fora de ordem
+
+typedef struct
+{
+    FIL arquivo;
+    prealocado_t reserva;
+    bool com_reserva;
+    FSIZE_t tamanho; // No diretório
+    FSIZE_t limite;  // Até onde se pode ler: a reserva ou o tamanho
+    uint32_t setores_lidos;
+} leitura_t;
+
+// Última linha de dados aceita, base da seguinte
+typedef struct
+{
+    uint32_t sequencia;
+    uint64_t timestamp_us;
+    bool valida;
+} ancora_t;
+
+static leitura_t g_leitura;
+static uint8_t g_setor[SETOR] __attribute__((aligned(4)));
+static char g_janela[JANELA_CSV + SETOR + 1];
+
+// Setor em 'posicao' (múltiplo de 512): direto da reserva ou pelo FatFs até o tamanho
+static bool ler_setor(leitura_t *l, FSIZE_t posicao, uint8_t *setor)
+{
+    if (posicao >= l->limite)
+        return false;
+    l->setores_lidos++;
+    if (l->com_reserva)
+        return prealocado_ler(&l->reserva, posicao, setor) == FR_OK;
+    UINT n;
+    if (f_lseek(&l->arquivo, posicao) != FR_OK || f_read(&l->arquivo, setor, SETOR, &n) != FR_OK)
+        return false;
+    memset(setor + n, 0, SETOR - n);
+    return true;
+}
+
+// --- Binário ---
+
+// Bloco de dados desta sessão; com 'continuar', também seguindo a sequência até 'seq_fim'
+static bool bloco_valido(const uint8_t *bloco, uint16_t marca, uint32_t *seq_fim, bool continuar)
+{
+    uint32_t sequencia;
+    uint16_t registros;
+    if (!lb_ler_bloco(bloco, &sequencia, &registros) || lb_marca_bloco(bloco) != marca || registros == 0 ||
+        (continuar && (int32_t)(sequencia - *seq_fim) < 0))
+        return false;
+    *seq_fim = sequencia + registros;
+    return true;
+}
+
+static FSIZE_t recuperar_binario(leitura_t *l, const rec_arquivo_t *a, rec_resultado_t *res)
+{
+    lb_cabecalho_t cab;
+    if (!ler_setor(l, 0, g_setor) || !lb_ler_cabecalho(g_setor, &cab) ||
+        (a->sessao && (cab.sessao != a->sessao || cab.parte != a->parte)))
+        return l->tamanho;
+    res->identificado = true;
+    if (cab.ano)
+        snprintf(res->inicio, sizeof res->inicio, "%04u-%02u-%02u %02u:%02u:%02u", cab.ano, cab.mes, cab.dia,
+                 cab.hora, cab.minuto, cab.segundo);
+    uint16_t marca = lb_marca_cabecalho(g_setor);
+
+    // Para trás, do último bloco inteiro dentro do tamanho até um válido
+    FSIZE_t fim = l->tamanho - l->tamanho % SETOR;
+    uint32_t seq_fim = 0;
+    bool continuar = false;
+    for (uint32_t volta = 0; fim > SETOR; fim -= SETOR, volta++)
+    {
+        // Nada válido perto do fim não é um fim rasgado: o arquivo fica como está
+        if (volta == REC_MAX_SETORES_VOLTA || !ler_setor(l, fim - SETOR, g_setor))
+            return l->tamanho;
+        if (bloco_valido(g_setor, marca, &seq_fim, false))
+        {
+            continuar = true;
+            break;
+        }
+    }
+    if (fim < SETOR)
+        fim = SETOR; // Só o cabeçalho, vindo da reserva
+
+    // Para a frente, pela reserva, enquanto os blocos continuarem a sessão
+    while (l->com_reserva && ler_setor(l, fim, g_setor) && bloco_valido(g_setor, marca, &seq_fim, continuar))
+    {
+        continuar = true;
+        fim += SETOR;
+    }
+    return fim;
+}
+
+// --- CSV ---
+
+// "# sessao=N;parte=P;inicio=..." logo depois da linha de colunas
+static bool identificar_csv(leitura_t *l, const rec_arquivo_t *a, rec_resultado_t *res)
+{
+    if (!a->sessao || !ler_setor(l, 0, (uint8_t *)g_janela))
+        return false;
+    if (!ler_setor(l, SETOR, (uint8_t *)g_janela + SETOR))
+        memset(g_janela + SETOR, 0, SETOR);
+    g_janela[2 * SETOR] = '\0';
+    char esperado[48];
+    snprintf(esperado, sizeof esperado, "\n# sessao=%lu;parte=%lu;inicio=", (unsigned long)a->sessao,
+             (unsigned long)a->parte);
+    const char *p = strstr(g_janela, esperado);
+    if (!p)
+        return false;
+    p += strlen(esperado);
+    size_t n = strcspn(p, "\n");
+    if (p[n] == '\n' && n > 0 && n < sizeof res->inicio)
+    {
+        memcpy(res->inicio, p, n);
+        res->inicio[n] = '\0';
+    }
+    return true;
+}
+
+// Linha de dados: seq;sensor;timestamp;... só com dígitos, '-' e ';'
+static bool ler_linha(const char *linha, size_t len, uint32_t *sequencia, uint64_t *timestamp_us)
+{
+    for (size_t i = 0; i < len; i++)
+        if ((linha[i] < '0' || linha[i] > '9') && linha[i] != ';' && linha[i] != '-')
+            return false;
+    char *p;
+    *sequencia = strtoul(linha, &p, 10);
+    if (*p != ';')
+        return false;
+    strtoul(p + 1, &p, 10);
+    if (*p != ';')
+        return false;
+    *timestamp_us = strtoull(p + 1, &p, 10);
+    return p <= linha + len;
+}
+
+// Uma linha depois da âncora: metadados '#', ou a sequência e o tempo continuando
+static bool linha_continua(const char *linha, size_t len, ancora_t *ancora)
+{
+    if (linha[0] == '#')
+        return true;
+    uint32_t sequencia;
+    uint64_t t;
+    if (!ler_linha(linha, len, &sequencia, &t))
+        return false;
+    if (ancora->valida && (sequencia - ancora->sequencia - 1 >= SALTO_MAX_SEQUENCIA ||
+                           t + RECUO_MAX_US < ancora->timestamp_us || t > ancora->timestamp_us + SALTO_MAX_US))
+        return false;
+    *ancora = (ancora_t){.sequencia = sequencia, .timestamp_us = t, .valida = true};
+    return true;
+}
+
+static FSIZE_t recuperar_csv(leitura_t *l, const rec_arquivo_t *a, rec_resultado_t *res)
+{
+    res->identificado = identificar_csv(l, a, res);
+
+    // O fim do tamanho no diretório numa janela só: o fim fica na última linha completa
+    FSIZE_t inicio = l->tamanho > JANELA_CSV ? l->tamanho - JANELA_CSV : 0;
+    inicio -= inicio % SETOR;
+    uint32_t n = (uint32_t)(l->tamanho - inicio);
+    for (uint32_t i = 0; i < n; i += SETOR)
+        if (!ler_setor(l, inicio + i, (uint8_t *)g_janela + i))
+            return l->tamanho;
+    uint32_t nova_linha = n;
+    while (nova_linha && g_janela[nova_linha - 1] != '\n')
+        nova_linha--;
+    if (!nova_linha && inicio)
+        return l->tamanho; // Nenhuma quebra de linha no fim: não é um fim rasgado
+    FSIZE_t fim = inicio + nova_linha;
+
+    // Âncora: a última linha de dados antes do fim (a primeira da janela pode estar cortada)
+    ancora_t ancora = {0};
+    for (uint32_t f = nova_linha; f > 0 && !ancora.valida;)
+    {
+        uint32_t i = f - 1;
+        while (i && g_janela[i - 1] != '\n')
+            i--;
+        if (!i && inicio)
+            break;
+        if (g_janela[i] != '#')
+            ancora.valida = ler_linha(&g_janela[i], f - 1 - i, &ancora.sequencia, &ancora.timestamp_us);
+        f = i;
+    }
+    if (!l->com_reserva || !res->identificado)
+        return fim;
+
+    // Para a frente, pela reserva, linha a linha. Uma linha que atravessa o início de
+    // um setor pode ter o começo desta sessão e o resto de outra (o setor seguinte não
+    // chegou a ser gravado): ela só entra junto com a próxima, que começa nesse setor.
+    char linha[PREFIXO_LINHA + 1];
+    uint32_t len = 0;
+    bool primeira = fim == 0; // A linha de colunas, antes de qualquer dado
+    for (FSIZE_t setor = fim - fim % SETOR, pos = fim; ler_setor(l, setor, g_setor); setor += SETOR)
+    {
+        for (uint32_t i = (uint32_t)(pos - setor); i < SETOR; i++, pos++)
+        {
+            char c = (char)g_setor[i];
+            if (c == '\n')
+            {
+                uint32_t prefixo = len < PREFIXO_LINHA ? len : PREFIXO_LINHA;
+                linha[prefixo] = '\0';
+                if (len == 0 || !(primeira || linha_continua(linha, prefixo, &ancora)))
+                    return fim;
+                primeira = false;
+                if (len <= i)
+                    fim = pos + 1;
+                len = 0;
+            }
+            else if ((uint8_t)c < 0x20 || c == 0x7F || len == LINHA_MAX)
+                return fim; // Zeros depois do último setor parcial, ou lixo
+            else
+            {
+                if (len < PREFIXO_LINHA)
+                    linha[len] = c;
+                len++;
+            }
+        }
+    }
+    return fim;
+}
+
+FRESULT rec_recuperar(const char *nome, const rec_arquivo_t *a, rec_resultado_t *res)
+{
+    leitura_t *l = &g_leitura;
+    memset(res, 0, sizeof *res);
+    snprintf(res->inicio, sizeof res->inicio, "-");
+    l->com_reserva = false;
+    l->setores_lidos = 0;
+
+    FRESULT fr;
+    if (a->reservado)
+    {
+        fr = prealocado_reabrir(&l->reserva, &l->arquivo, nome, a->reservado);
+        l->com_reserva = fr == FR_OK && l->reserva.reservado;
+    }
+    else
+        fr = f_open(&l->arquivo, nome, FA_READ | FA_WRITE);
+    if (fr != FR_OK)
+        return fr;
+    l->tamanho = f_size(&l->arquivo);
+    l->limite = l->com_reserva ? l->reserva.reservado : l->tamanho;
+    res->tamanho_anterior = l->tamanho;
+
+    FSIZE_t fim = a->binario ? recuperar_binario(l, a, res) : recuperar_csv(l, a, res);
+    res->tamanho = fim;
+    res->setores_lidos = l->setores_lidos;
+
+    // Com reserva, o corte no fim recuperado também devolve o resto dela
+    if (l->com_reserva)
+    {
+        l->reserva.tamanho = fim;
+        fr = prealocado_fechar(&l->reserva);
+    }
+    else
+    {
+        fr = FR_OK;
+        if (fim < l->tamanho)
+        {
+            fr = f_lseek(&l->arquivo, fim);
+            if (fr == FR_OK)
+                fr = f_truncate(&l->arquivo);
+        }
+        FRESULT fr_close = f_close(&l->arquivo);
+        if (fr == FR_OK)
+            fr = fr_close;
+    }
+
+    // Uma parte sem nada (criada para a troca seguinte e nunca usada) não fica no cartão
+    if (fr == FR_OK && fim == 0 && a->sessao)
+    {
+        fr = f_unlink(nome);
+        res->removido = fr == FR_OK;
+    }
+    return fr;
+}
@@ -0,0 +1,48 @@
+// recuperacao.h
+#ifndef RECUPERACAO_H
+#define RECUPERACAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+
+// Recuperação de um arquivo de log que ficou aberto quando a placa desligou. Só o
+// fim do arquivo é lido, nunca ele inteiro:
+//
+//   - O fim rasgado (a última escrita pela metade) é cortado no último registro
+//     válido: no binário, o último bloco com CRC e a marca da sessão; no CSV, a
+//     última linha completa. Volta no máximo REC_MAX_SETORES_VOLTA setores.
+//   - Num arquivo pré-alocado (lib/prealocado.h), os dados gravados depois do
+//     último checkpoint estão na reserva, além do tamanho no diretório. Eles são
+//     lidos setor a setor enquanto continuarem a sessão (a marca e a sequência
+//     dos blocos; a sequência e o timestamp das linhas) e o tamanho passa a
+//     cobri-los. O resto da reserva é liberado.
+//
+// O cabeçalho da parte diz se a reserva é dela: o do binário traz a sessão e a
+// parte, o CSV traz a linha "# sessao=N;parte=P;inicio=...". Sem ele nada além do
+// tamanho no diretório é aproveitado.
+
+#define REC_MAX_SETORES_VOLTA 64 // 32 KiB: os dois buffers do gravador e folga
+
+typedef struct
+{
+    bool binario;       // Formato de lib/log_binario.h; senão CSV
+    uint32_t sessao;    // Sessão e parte esperadas no cabeçalho; sessão 0 = não conferir
+    uint32_t parte;     // (arquivos de espectro e de eventos: só o corte do fim)
+    FSIZE_t reservado;  // Bytes reservados por prealocado_criar; 0 sem reserva
+} rec_arquivo_t;
+
+typedef struct
+{
+    FSIZE_t tamanho_anterior; // No diretório, antes
+    FSIZE_t tamanho;          // Depois da recuperação
+    uint32_t setores_lidos;
+    bool identificado;        // O cabeçalho é da sessão e da parte esperadas
+    bool removido;            // Sem nenhum dado (parte criada antes da hora): apagado
+    char inicio[26];          // Data e hora do cabeçalho (campos de 16 e 8 bits), ou "-"
+} rec_resultado_t;
+
+// Recupera 'nome'. O arquivo não pode estar aberto. Retorna o erro do FatFs ou do cartão.
+FRESULT rec_recuperar(const char *nome, const rec_arquivo_t *a, rec_resultado_t *res);
+
+#endif // RECUPERACAO_H